@@ -0,0 +1,24 @@
+#include "anim_seq.h"
+
+void anim_seq_start(anim_seq *s, anim_seq_fn fn){
+    s->fn = fn;
+    s->line = 0;
+    s->wait = 0;
+    s->i = 0;
+    s->triggers = 0;
+}
+
+uint8_t anim_seq_step(anim_seq *s){
+    if (s->line == SEQ_LINE_DONE) return ANIM_SEQ_DONE;
+    if (s->wait && --s->wait) return ANIM_SEQ_RUNNING;
+
+    return s->fn(s);
+}
+
+uint8_t anim_seq_running(const anim_seq *s){
+    return s->line != SEQ_LINE_DONE;
+}
+
+void anim_seq_trigger(anim_seq *s, uint8_t bits){
+    s->triggers |= bits;
+}
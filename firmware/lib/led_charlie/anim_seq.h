@@ -0,0 +1,92 @@
+#ifndef ANIM_SEQ_H
+#define ANIM_SEQ_H
+#include <stdint.h>
+
+// Animation sequences as protothreads: a sequence is a function written
+// top to bottom with waits, loops and triggers in it, and every frame tick
+// resumes it where it left off. No stack of its own, the resume point is
+// a line number in anim_seq and the function is one switch on it, so a
+// sequence costs its anim_seq (12 bytes) and any number run side by side.
+//
+//   static uint8_t blink(anim_seq *s){
+//       SEQ_BEGIN(s);
+//       while (1) {
+//           led_on();
+//           SEQ_WAIT(s, 25);                  // 25 frame ticks
+//           led_off();
+//           SEQ_WAIT_TRIGGER(s, BUTTON);      // until anim_seq_trigger(s, BUTTON)
+//       }
+//       SEQ_END(s);
+//   }
+//
+// Locals don't survive a wait, keep state in statics or in s->i. The
+// sequence body can't contain a switch of its own around a wait, and
+// there is at most one SEQ_* wait per source line.
+
+#define ANIM_SEQ_DONE       0
+#define ANIM_SEQ_RUNNING    1
+
+typedef struct anim_seq anim_seq;
+typedef uint8_t (*anim_seq_fn)(anim_seq *s);
+
+struct anim_seq {
+    anim_seq_fn fn;
+    uint16_t line;      // resume point, 0 = from the top
+    uint16_t wait;      // frame ticks left of a SEQ_WAIT
+    uint16_t i;         // loop counter for the sequence
+    uint8_t triggers;   // anim_seq_trigger bits not taken yet
+};
+
+void anim_seq_start(anim_seq *s, anim_seq_fn fn);
+// One frame tick: counts down a SEQ_WAIT or resumes the sequence.
+// ANIM_SEQ_DONE once it has run off its end or SEQ_EXIT.
+uint8_t anim_seq_step(anim_seq *s);
+uint8_t anim_seq_running(const anim_seq *s);
+
+// Sets trigger bits, e.g. from the button or the accelerometer, or from
+// another sequence. A bit stays set until a wait takes it.
+void anim_seq_trigger(anim_seq *s, uint8_t bits);
+
+// Clears and returns the pending bits of bits, for conditions in a sequence
+static inline uint8_t anim_seq_take(anim_seq *s, uint8_t bits){
+    uint8_t hit = s->triggers & bits;
+
+    s->triggers &= ~hit;
+
+    return hit;
+}
+
+#define SEQ_LINE_DONE   0xFFFF
+
+// Resume points are case labels reached from the line before them too
+#define SEQ_FALLTHROUGH __attribute__((fallthrough))
+
+#define SEQ_BEGIN(s)    switch ((s)->line) { case 0:
+
+#define SEQ_END(s)      } (s)->line = SEQ_LINE_DONE; return ANIM_SEQ_DONE
+
+// Back on the next frame tick
+#define SEQ_YIELD(s) \
+    do { (s)->line = __LINE__; return ANIM_SEQ_RUNNING; case __LINE__:; } while (0)
+
+// Checked now and on every frame tick after, goes on as soon as cond holds
+#define SEQ_WAIT_UNTIL(s, cond) \
+    do { (s)->line = __LINE__; SEQ_FALLTHROUGH; case __LINE__: if (!(cond)) return ANIM_SEQ_RUNNING; } while (0)
+
+// Back after frames ticks, the ticks in between don't call the sequence
+#define SEQ_WAIT(s, frames) \
+    do { (s)->wait = (frames); if ((s)->wait) { (s)->line = __LINE__; return ANIM_SEQ_RUNNING; } \
+         SEQ_FALLTHROUGH; case __LINE__:; } while (0)
+
+// Until one of the trigger bits is set, takes them
+#define SEQ_WAIT_TRIGGER(s, bits)   SEQ_WAIT_UNTIL(s, anim_seq_take(s, bits))
+
+// Runs child (an anim_seq of the caller) from its top to its end, one step
+// per frame tick of s, starting with this one
+#define SEQ_RUN(s, child, child_fn) \
+    do { anim_seq_start(child, child_fn); SEQ_WAIT_UNTIL(s, anim_seq_step(child) == ANIM_SEQ_DONE); } while (0)
+
+#define SEQ_RESTART(s)  do { (s)->line = 0; return ANIM_SEQ_RUNNING; } while (0)
+#define SEQ_EXIT(s)     do { (s)->line = SEQ_LINE_DONE; return ANIM_SEQ_DONE; } while (0)
+
+#endif /* ANIM_SEQ_H */
@@ -1,9 +1,11 @@
 #include <ch32v00x.h>
 #include "animations.h"
-#include <stdlib.h>  // For rand()
+#include "charlie_topology.h"
+#include "fixmath.h"
+#include "sysclk.h"
 
-#define ANIM_NUM_LEDS       42      // Total number of LEDs in matrix
-#define ANIM_BITMASK_SIZE   2       // (42 + 31) / 32 = 2
+#define ANIM_NUM_LEDS       CHARLIE_NUM_LEDS      // Total number of LEDs in matrix
+#define ANIM_BITMASK_SIZE   CHARLIE_BITMASK_SIZE  // (LEDs + 31) / 32
 
 static uint32_t anim_pattern[ANIM_BITMASK_SIZE] = {0};
 static uint32_t anim_frame_counter = 0;
@@ -37,7 +39,8 @@ static void anim_clear_all(void){
     }
 }
 
-static void anim_set_all(void){
+// Only the commented out animations below use it
+__attribute__((unused)) static void anim_set_all(void){
     for (int i = 0; i < ANIM_BITMASK_SIZE; i++) {
         anim_pattern[i] = 0xFFFFFFFF;
     }
@@ -61,8 +64,9 @@ static uint8_t anim_count_leds_on(void){
     return count;
 }
 
-static uint8_t anim_random(uint8_t max){
-    return (uint8_t)(rand() % max);
+// max up to 256, anim_random(256) is a random byte
+static uint8_t anim_random(uint16_t max){
+    return fx_range8(fx_rand8(), max);
 }
 
 // Sparkle Animation
@@ -154,6 +158,21 @@ uint32_t* anim_sparkle_update(void){
     return anim_pattern;
 }
 
+uint8_t anim_sysclk(uint8_t anim){
+    switch (anim) {
+    case ANIM_TWINKLE:
+    case ANIM_SPARKLE: return SYSCLK_LOW;
+    case ANIM_BREATHE:
+    case ANIM_WAVE: return SYSCLK_HIGH;
+    case ANIM_LIFE:
+    case ANIM_FIRE:
+    case ANIM_RIPPLE:
+    case ANIM_MOTION:
+    case ANIM_SHOW: return SYSCLK_MID;
+    default: return SYSCLK_LOW;     // live frames, the stream asks for its clock
+    }
+}
+
 /* ===================================================================
  * ANIMATION: IMPULSE (Expanding wave effect)
  * =================================================================== */
@@ -367,7 +386,7 @@ uint32_t* anim_sparkle_update(void){
 //     anim_sparkle_init(8, 128);
     
 //     /* Enable multiplexing with initial pattern */
-//     extern void charlie_enable_multiplex(uint32_t *bitmask);
+//     extern void charlie_enable_multiplex(const uint32_t *bitmask);
 //     charlie_enable_multiplex(anim_sparkle_update());
     
 //     /* Update loop - call this every 20-50ms */
@@ -376,7 +395,7 @@ uint32_t* anim_sparkle_update(void){
 //         uint32_t *pattern = anim_sparkle_update();
         
 //         /* Update display */
-//         extern void charlie_update_multiplex_pattern(uint32_t *bitmask);
+//         extern void charlie_update_multiplex_pattern(const uint32_t *bitmask);
 //         charlie_update_multiplex_pattern(pattern);
         
 //         /* Delay between updates (adjust for desired animation speed) */
@@ -393,14 +412,14 @@ uint32_t* anim_sparkle_update(void){
 //         /* Initialize impulse from LED 0, medium speed, hold for 100 frames */
 //         anim_impulse_init(0, 2, 100);
         
-//         extern void charlie_enable_multiplex(uint32_t *bitmask);
+//         extern void charlie_enable_multiplex(const uint32_t *bitmask);
 //         charlie_enable_multiplex(anim_impulse_update());
         
 //         /* Animate expansion */
 //         while (!anim_impulse_is_complete()) {
 //             uint32_t *pattern = anim_impulse_update();
 //             if (pattern) {
-//                 extern void charlie_update_multiplex_pattern(uint32_t *bitmask);
+//                 extern void charlie_update_multiplex_pattern(const uint32_t *bitmask);
 //                 charlie_update_multiplex_pattern(pattern);
 //             }
             
@@ -417,7 +436,7 @@ uint32_t* anim_sparkle_update(void){
 //         while (anim_impulse_reverse_update() != NULL) {
 //             uint32_t *pattern = anim_impulse_reverse_update();
 //             if (pattern) {
-//                 extern void charlie_update_multiplex_pattern(uint32_t *bitmask);
+//                 extern void charlie_update_multiplex_pattern(const uint32_t *bitmask);
 //                 charlie_update_multiplex_pattern(pattern);
 //             }
             
@@ -429,53 +448,8 @@ uint32_t* anim_sparkle_update(void){
 //     }
 // }
 
-// /**
-//  * @brief Example: Combined effect - impulse then sparkle
-//  */
-// void anim_example_combined(void)
-// {
-//     extern void charlie_enable_multiplex(uint32_t *bitmask);
-//     extern void charlie_update_multiplex_pattern(uint32_t *bitmask);
-    
-//     while(1) {
-//         /* Impulse expands */
-//         anim_impulse_init(ANIM_NUM_LEDS / 2, 3, 0);
-//         charlie_enable_multiplex(anim_impulse_update());
-        
-//         while (!anim_impulse_is_complete()) {
-//             uint32_t *pattern = anim_impulse_update();
-//             if (pattern) {
-//                 charlie_update_multiplex_pattern(pattern);
-//             }
-//             for(volatile int i = 0; i < 20000; i++);
-//         }
-        
-//         /* Transition to sparkle */
-//         for(volatile int i = 0; i < 200000; i++);
-        
-//         /* Sparkle for a while */
-//         anim_sparkle_init(10, 180);
-//         charlie_update_multiplex_pattern(anim_sparkle_update());
-        
-//         for (int frame = 0; frame < 500; frame++) {
-//             charlie_update_multiplex_pattern(anim_sparkle_update());
-//             for(volatile int i = 0; i < 30000; i++);
-//         }
-        
-//         /* Collapse */
-//         anim_impulse_reverse_init(ANIM_NUM_LEDS / 2, 3);
-        
-//         while (anim_impulse_reverse_update() != NULL) {
-//             uint32_t *pattern = anim_impulse_reverse_update();
-//             if (pattern) {
-//                 charlie_update_multiplex_pattern(pattern);
-//             }
-//             for(volatile int i = 0; i < 20000; i++);
-//         }
-        
-//         for(volatile int i = 0; i < 500000; i++);
-//     }
-// }
+// Combined effect (impulse, sparkle for 500 frames, collapse): written as
+// a sequence without the delay loops, anim_show in animations_seq.c
 
 /* ===================================================================
  * NOTES
@@ -500,6 +474,7 @@ uint32_t* anim_sparkle_update(void){
  * - Run one animation to completion
  * - Then start another
  * - Can create complex sequences
+ * - Without blocking: anim_seq.h, one frame tick per step
  * 
  * PERFORMANCE:
  * - Animations are lightweight (just bitmask manipulation)
@@ -507,8 +482,8 @@ uint32_t* anim_sparkle_update(void){
  * - Hardware timer handles display - no blocking
  * 
  * RANDOM NUMBER GENERATION:
- * - Uses stdlib rand()
- * - IMPORTANT: Call srand() in your main() to seed it!
- * - Example: srand(SystemCoreClock) or srand(TIM2->CNT)
+ * - Uses fx_rand() from fixmath.h (xorshift, no multiply/modulo)
+ * - IMPORTANT: Call fx_srand() in your main() to seed it!
+ * - Example: fx_srand(TIM2->CNT)
  * - Without seeding, pattern will be same every power-on
  */
\ No newline at end of file
@@ -1,6 +1,30 @@
 #ifndef ANIMATIONS_H
 #define ANIMATIONS_H
 #include <stdint.h>
+#include "charlie_topology.h"
+#include "led_layout.h"
+
+// The animations on the physical layout (wave, automata, motion, show,
+// transitions) need led_layout of the same board, only the 42 LED star
+// has one. Other pin lists build without them.
+#define ANIM_LAYOUT     (LED_LAYOUT_NUM_LEDS == CHARLIE_NUM_LEDS)
+
+// Animation ids for STREAM_CMD_ANIM, 0 (STREAM_ANIM_LIVE) = host frames only
+#define ANIM_TWINKLE    1
+#define ANIM_SPARKLE    2
+#define ANIM_BREATHE    3
+#define ANIM_WAVE       4
+#define ANIM_LIFE       5
+#define ANIM_FIRE       6
+#define ANIM_RIPPLE     7
+#define ANIM_MOTION     8   // idle shimmer without the accelerometer
+#define ANIM_SHOW       9   // impulse, sparkle, collapse; the button flashes and skips
+#define ANIM_NUM        10
+
+// Core clock the frames of an animation need (sysclk_level), the display
+// requests its own on top: patterns only get by with it, levels every 20ms
+// need 48MHz
+uint8_t anim_sysclk(uint8_t anim);
 
 void anim_sparkle_init(uint8_t num_leds_on, uint8_t speed);
 uint32_t* anim_sparkle_update(void);
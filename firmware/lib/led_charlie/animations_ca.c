@@ -0,0 +1,278 @@
+#include "animations_ca.h"
+#include "animations.h"
+#include "charlie_topology.h"
+#include "fixmath.h"
+#include "led_layout.h"
+
+// Only for the pin list led_layout is of, see animations.h
+#if ANIM_LAYOUT
+
+#if LED_LAYOUT_MAX_NEIGHBOURS > 7
+#error "neighbour counts need more than 3 bit planes"
+#endif
+
+#define CA_WORDS        LED_LAYOUT_WORDS
+#define CA_PLANES       ANIM_CA_PLANES
+#define CA_STUCK_GENS   64      // life: generations before a spark is forced
+
+typedef uint32_t ca_bits[CA_WORDS];
+
+// Levels of the visible states
+#define CA_LEVEL_ON     255
+#define CA_LEVEL_TRAIL  96
+#define CA_LEVEL_FADE   24
+
+static ca_bits ca_pattern = {0};
+
+// --- Word-parallel helpers ---
+
+// Bits of existing LEDs in word w
+static inline uint32_t ca_valid(int w){
+    int rest = LED_LAYOUT_NUM_LEDS - 32 * w;
+
+    return rest >= 32 ? 0xFFFFFFFF : (rest > 0 ? (1UL << rest) - 1 : 0);
+}
+
+// Bit i of out = bit i+shift of in, 0 past either end
+static inline void ca_shift(ca_bits out, const ca_bits in, int8_t shift){
+    int s = shift < 0 ? -shift : shift;
+    int ws = s >> 5;
+    int bs = s & 31;
+
+    for (int w = 0; w < CA_WORDS; w++) {
+        if (shift > 0) {
+            uint32_t lo = (w + ws < CA_WORDS) ? in[w + ws] : 0;
+            uint32_t hi = (w + ws + 1 < CA_WORDS) ? in[w + ws + 1] : 0;
+            out[w] = bs ? (lo >> bs) | (hi << (32 - bs)) : lo;
+        } else {
+            uint32_t hi = (w - ws >= 0) ? in[w - ws] : 0;
+            uint32_t lo = (w - ws - 1 >= 0) ? in[w - ws - 1] : 0;
+            out[w] = bs ? (hi << bs) | (lo >> (32 - bs)) : hi;
+        }
+    }
+}
+
+// One half adder chain per graph shift
+void anim_ca_count(uint32_t count[CA_PLANES][CA_WORDS], const uint32_t *state){
+    ca_bits nb;
+
+    for (int w = 0; w < CA_WORDS; w++) {
+        count[0][w] = count[1][w] = count[2][w] = 0;
+    }
+
+    for (int k = 0; k < LED_LAYOUT_NUM_SHIFTS; k++) {
+        const led_layout_shift *sh = &led_layout_shifts[k];
+
+        ca_shift(nb, state, sh->shift);
+        for (int w = 0; w < CA_WORDS; w++) {
+            uint32_t x = nb[w] & sh->mask[w];
+            uint32_t carry = count[0][w] & x;
+
+            count[0][w] ^= x;
+            x = count[1][w] & carry;
+            count[1][w] ^= carry;
+            count[2][w] |= x;
+        }
+    }
+}
+
+// LEDs with at least one neighbour in state
+static void ca_any(ca_bits out, const ca_bits state){
+    ca_bits nb;
+
+    for (int w = 0; w < CA_WORDS; w++) out[w] = 0;
+
+    for (int k = 0; k < LED_LAYOUT_NUM_SHIFTS; k++) {
+        const led_layout_shift *sh = &led_layout_shifts[k];
+
+        ca_shift(nb, state, sh->shift);
+        for (int w = 0; w < CA_WORDS; w++) out[w] |= nb[w] & sh->mask[w];
+    }
+}
+
+// LEDs whose count is in rule (bit n = count n)
+static void ca_match(ca_bits out, uint32_t count[CA_PLANES][CA_WORDS], uint8_t rule){
+    for (int w = 0; w < CA_WORDS; w++) {
+        uint32_t m = 0;
+
+        for (uint8_t n = 0; n < 8; n++) {
+            if (!(rule & (1 << n))) continue;
+            m |= ((n & 1) ? count[0][w] : ~count[0][w]) &
+                 ((n & 2) ? count[1][w] : ~count[1][w]) &
+                 ((n & 4) ? count[2][w] : ~count[2][w]);
+        }
+        out[w] = m;
+    }
+}
+
+// Random bits, each set with 1 / 2^shift
+static void ca_random(ca_bits out, uint8_t shift){
+    for (int w = 0; w < CA_WORDS; w++) {
+        uint32_t r = 0xFFFFFFFF;
+
+        for (uint8_t i = 0; i < shift; i++) r &= fx_rand();
+        out[w] = r;
+    }
+}
+
+static inline void ca_set(ca_bits b, uint8_t led){
+    b[led >> 5] |= 1UL << (led & 31);
+}
+
+static inline uint8_t ca_get(const ca_bits b, uint8_t led){
+    return (b[led >> 5] >> (led & 31)) & 1;
+}
+
+static inline uint8_t ca_random_led(void){
+    return fx_range8(fx_rand8(), LED_LAYOUT_NUM_LEDS);
+}
+
+// Pattern = on, levels from up to three planes (on > trail > fade)
+static uint32_t* ca_output(const ca_bits on, const ca_bits trail, const ca_bits fade, uint8_t *levels){
+    for (int w = 0; w < CA_WORDS; w++) ca_pattern[w] = on[w];
+
+    if (levels) {
+        for (uint8_t led = 0; led < LED_LAYOUT_NUM_LEDS; led++) {
+            uint8_t level = 0;
+
+            if (ca_get(on, led)) level = CA_LEVEL_ON;
+            else if (trail && ca_get(trail, led)) level = CA_LEVEL_TRAIL;
+            else if (fade && ca_get(fade, led)) level = CA_LEVEL_FADE;
+            levels[led] = level;
+            if (level) ca_set(ca_pattern, led);
+        }
+    }
+
+    return ca_pattern;
+}
+
+// --- Game of Life ---
+
+static struct {
+    ca_bits cells;
+    ca_bits prev;
+    uint8_t birth;
+    uint8_t survive;
+    uint8_t quiet;      // generations since the last spark
+} life;
+
+void anim_life_init(uint8_t birth, uint8_t survive){
+    life.birth = birth ? birth : (1 << 2);
+    life.survive = survive ? survive : (1 << 2) | (1 << 3);
+    life.quiet = 0;
+
+    // about a quarter of the star alive
+    ca_random(life.cells, 2);
+    for (int w = 0; w < CA_WORDS; w++) {
+        life.cells[w] &= ca_valid(w);
+        life.prev[w] = 0;
+    }
+}
+
+uint32_t* anim_life_update(uint8_t *levels){
+    uint32_t count[CA_PLANES][CA_WORDS];
+    ca_bits born, keep, next;
+    uint32_t changed = 0, changed2 = 0, alive = 0;
+
+    anim_ca_count(count, life.cells);
+    ca_match(born, count, life.birth);
+    ca_match(keep, count, life.survive);
+
+    for (int w = 0; w < CA_WORDS; w++) {
+        next[w] = ((~life.cells[w] & born[w]) | (life.cells[w] & keep[w])) & ca_valid(w);
+        changed |= next[w] ^ life.cells[w];
+        changed2 |= next[w] ^ life.prev[w];
+        alive |= next[w];
+    }
+
+    // dead, still or blinking (or just quiet for long): drop in a few cells
+    if (!alive || !changed || !changed2 || ++life.quiet >= CA_STUCK_GENS) {
+        for (int i = 0; i < 3; i++) ca_set(next, ca_random_led());
+        life.quiet = 0;
+    }
+
+    for (int w = 0; w < CA_WORDS; w++) {
+        life.prev[w] = life.cells[w];
+        life.cells[w] = next[w];
+    }
+
+    // cells that just died fade out
+    ca_bits died;
+    for (int w = 0; w < CA_WORDS; w++) died[w] = life.prev[w] & ~life.cells[w];
+
+    return ca_output(life.cells, 0, died, levels);
+}
+
+// --- Forest fire ---
+
+static struct {
+    ca_bits trees;
+    ca_bits burning;
+    ca_bits embers;
+    uint8_t growth_shift;
+    uint8_t lightning;
+} fire;
+
+void anim_fire_init(uint8_t growth_shift, uint8_t lightning){
+    fire.growth_shift = growth_shift;
+    fire.lightning = lightning;
+    ca_random(fire.trees, 1);
+    for (int w = 0; w < CA_WORDS; w++) {
+        fire.trees[w] &= ca_valid(w);
+        fire.burning[w] = fire.embers[w] = 0;
+    }
+}
+
+uint32_t* anim_fire_update(uint8_t *levels){
+    ca_bits near, grow, spark = {0};
+
+    ca_any(near, fire.burning);
+    ca_random(grow, fire.growth_shift);
+    if (fx_rand8() < fire.lightning) ca_set(spark, ca_random_led());
+
+    for (int w = 0; w < CA_WORDS; w++) {
+        uint32_t empty = ~fire.trees[w] & ~fire.burning[w];
+        uint32_t ignite = fire.trees[w] & (near[w] | spark[w]);
+
+        fire.embers[w] = fire.burning[w];
+        fire.trees[w] = (fire.trees[w] & ~ignite) | (empty & grow[w] & ca_valid(w));
+        fire.burning[w] = ignite;
+    }
+
+    return ca_output(fire.burning, fire.embers, 0, levels);
+}
+
+// --- Ripples (Greenberg-Hastings) ---
+
+static struct {
+    ca_bits excited;
+    ca_bits refractory1;
+    ca_bits refractory2;
+    uint8_t drops;
+} ripple;
+
+void anim_ripple_init(uint8_t drops){
+    ripple.drops = drops;
+    for (int w = 0; w < CA_WORDS; w++) {
+        ripple.excited[w] = ripple.refractory1[w] = ripple.refractory2[w] = 0;
+    }
+}
+
+uint32_t* anim_ripple_update(uint8_t *levels){
+    ca_bits near, drop = {0};
+
+    ca_any(near, ripple.excited);
+    if (fx_rand8() < ripple.drops) ca_set(drop, ca_random_led());
+
+    for (int w = 0; w < CA_WORDS; w++) {
+        uint32_t rest = ~(ripple.excited[w] | ripple.refractory1[w] | ripple.refractory2[w]);
+
+        ripple.refractory2[w] = ripple.refractory1[w];
+        ripple.refractory1[w] = ripple.excited[w];
+        ripple.excited[w] = rest & (near[w] | drop[w]);
+    }
+
+    return ca_output(ripple.excited, ripple.refractory1, ripple.refractory2, levels);
+}
+
+#endif /* ANIM_LAYOUT */
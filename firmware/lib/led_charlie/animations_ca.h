@@ -0,0 +1,39 @@
+#ifndef ANIMATIONS_CA_H
+#define ANIMATIONS_CA_H
+#include <stdint.h>
+#include "charlie_topology.h"
+
+// Cellular automata on the physical neighbour graph of the star
+// (led_layout_shifts). A generation works on whole pattern words: the
+// neighbour states are gathered with one shift and mask per entry of the
+// graph and summed in bit-slice counters, no per LED loops. Nothing is
+// stored but the current state, so the animations never repeat.
+//
+// Same conventions as animations_wave.h: `levels` may be 0, then the
+// pattern alone shows the effect. Only filling `levels` walks the LEDs.
+
+// Game of Life, birth / survive are masks of neighbour counts,
+// e.g. (1 << 2) and (1 << 2) | (1 << 3) for B2/S23 (the default with 0, 0).
+// Dead or stuck boards get a few random cells.
+void anim_life_init(uint8_t birth, uint8_t survive);
+uint32_t* anim_life_update(uint8_t *levels);
+
+// Forest fire: fire spreads to neighbouring trees and leaves embers,
+// trees regrow with 1 / 2^growth_shift per frame, lightning / 256 per
+// frame sets a random tree on fire
+void anim_fire_init(uint8_t growth_shift, uint8_t lightning);
+uint32_t* anim_fire_update(uint8_t *levels);
+
+// Excitable medium: drops / 256 per frame start a ring that runs outward
+// over the star, followed by a fading trail
+void anim_ripple_init(uint8_t drops);
+uint32_t* anim_ripple_update(uint8_t *levels);
+
+// Neighbour count of every LED of state (a pattern), count[b] holds bit b
+// of all the counts. The core of a generation, checked against a per LED
+// count by sim/star_sim --ca.
+#define ANIM_CA_PLANES  3       // bit-slice counter, counts 0..7
+
+void anim_ca_count(uint32_t count[ANIM_CA_PLANES][CHARLIE_BITMASK_SIZE], const uint32_t *state);
+
+#endif /* ANIMATIONS_CA_H */
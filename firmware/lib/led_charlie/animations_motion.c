@@ -0,0 +1,78 @@
+#include "animations_motion.h"
+#include "animations.h"
+#include "charlie_topology.h"
+#include "fixmath.h"
+#include "led_layout.h"
+
+// Only for the pin list led_layout is of, see animations.h
+#if ANIM_LAYOUT
+
+#define MOTION_BASE_LEVEL       80      // flat star
+#define MOTION_SHIMMER_SHIFT    3       // shimmer amplitude, 127 >> 3
+#define MOTION_SPARKS_PER_SHAKE 4
+#define MOTION_SPARK_FADE       24      // per frame, ~10 frames from full
+#define MOTION_TILT_SHIFT       2       // tilt follows the input over ~4 frames
+
+static struct {
+    int16_t tilt_x;                     // Q2
+    int16_t tilt_y;
+    uint8_t phase;
+    uint8_t spark[CHARLIE_NUM_LEDS];
+} motion_anim;
+
+static uint32_t motion_pattern[CHARLIE_BITMASK_SIZE];
+
+// a * b / 128 for |a| <= 128, |b| <= 127, on fx_mul8
+static inline int16_t motion_smul(int16_t a, int8_t b){
+    uint8_t ua = a < 0 ? -a : a;
+    uint8_t ub = b < 0 ? -b : b;
+    int16_t p = (int16_t)(fx_mul8(ua, ub) >> 7);
+
+    return ((a < 0) != (b < 0)) ? -p : p;
+}
+
+void anim_motion_init(void){
+    motion_anim.tilt_x = 0;
+    motion_anim.tilt_y = 0;
+    motion_anim.phase = 0;
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) motion_anim.spark[led] = 0;
+}
+
+uint32_t* anim_motion_update(int8_t tilt_x, int8_t tilt_y, uint8_t intensity,
+                             uint8_t shakes, uint8_t *levels){
+    // input arrives in batches, the gradient glides between them
+    motion_anim.tilt_x += ((tilt_x << MOTION_TILT_SHIFT) - motion_anim.tilt_x) >> MOTION_TILT_SHIFT;
+    motion_anim.tilt_y += ((tilt_y << MOTION_TILT_SHIFT) - motion_anim.tilt_y) >> MOTION_TILT_SHIFT;
+    motion_anim.phase += 1 + (intensity >> 4);
+
+    int8_t tx = (int8_t)(motion_anim.tilt_x >> MOTION_TILT_SHIFT);
+    int8_t ty = (int8_t)(motion_anim.tilt_y >> MOTION_TILT_SHIFT);
+
+    // bursts on shakes, single sparks now and then while moving
+    uint8_t sparks = shakes > 4 ? 4 * MOTION_SPARKS_PER_SHAKE : shakes * MOTION_SPARKS_PER_SHAKE;
+    if (fx_rand8() < (intensity >> 2)) sparks++;
+    while (sparks--) motion_anim.spark[fx_range8(fx_rand8(), CHARLIE_NUM_LEDS)] = 255;
+
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) motion_pattern[i] = 0;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        // position along the downhill direction, -254..254
+        int16_t along = motion_smul((int16_t)led_layout[led].x - 128, tx) +
+                        motion_smul((int16_t)led_layout[led].y - 128, ty);
+        int16_t shimmer = fx_sin8((uint8_t)((led_layout_angle[led] << 1) - motion_anim.phase)) >> MOTION_SHIMMER_SHIFT;
+        int16_t base = MOTION_BASE_LEVEL + along + shimmer;
+        uint8_t level = base < 0 ? 0 : (base > 255 ? 255 : (uint8_t)base);
+        uint8_t spark = motion_anim.spark[led];
+
+        level = fx_ease_in8(level);
+        if (spark > level) level = spark;
+        motion_anim.spark[led] = spark > MOTION_SPARK_FADE ? spark - MOTION_SPARK_FADE : 0;
+
+        if (levels) levels[led] = level;
+        if (levels ? level != 0 : level > 127) motion_pattern[led >> 5] |= 1UL << (led & 31);
+    }
+
+    return motion_pattern;
+}
+
+#endif /* ANIM_LAYOUT */
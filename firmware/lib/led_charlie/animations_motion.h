@@ -0,0 +1,20 @@
+#ifndef ANIMATIONS_MOTION_H
+#define ANIMATIONS_MOTION_H
+#include <stdint.h>
+
+// Motion reactive animation, driven by motion.h (SC7A20) or any other
+// source of the same inputs. Light pools on the downhill side of the star
+// (LED positions from led_layout), a shimmer runs around it faster the
+// more the star moves, shakes set off sparkle bursts.
+//
+// Same conventions as animations_wave.h: with levels == 0 the pattern
+// alone carries the effect.
+
+// Tilt = downhill direction in board axes, +-127 at full tilt.
+// Intensity 0..255 scales the shimmer speed and the idle sparkles,
+// shakes = shake peaks since the last call, one burst each.
+void anim_motion_init(void);
+uint32_t* anim_motion_update(int8_t tilt_x, int8_t tilt_y, uint8_t intensity,
+                             uint8_t shakes, uint8_t *levels);
+
+#endif /* ANIMATIONS_MOTION_H */
@@ -0,0 +1,104 @@
+#include "animations_seq.h"
+#include "animations.h"
+#include "anim_seq.h"
+#include "charlie_topology.h"
+#include "fixmath.h"
+#include "led_layout.h"
+
+// Only for the pin list led_layout is of, see animations.h
+#if ANIM_LAYOUT
+
+#define SHOW_RINGS          32      // impulse steps, radius 8 each
+#define SHOW_HOLD_FRAMES    25
+#define SHOW_SPARKLE_FRAMES 500
+#define SHOW_SPARKLE_TICKS  2       // sparkle frame every 40ms
+#define SHOW_PAUSE_FRAMES   50
+#define SHOW_LEVEL          160     // levels between pulses
+#define SHOW_PULSE_STEP     16      // 16 frames per pulse
+
+// Trigger bits
+#define SHOW_FLASH          0x01    // pulse sequence: one pulse
+#define SHOW_SKIP           0x02    // show: end the sparkle
+
+static anim_seq show_seq;
+static anim_seq pulse_seq;
+static uint32_t show_pattern[CHARLIE_BITMASK_SIZE];
+static uint32_t *show_frame = show_pattern;
+static uint8_t show_level = SHOW_LEVEL;
+
+// LEDs closer to the centre than ring
+static void show_ring(uint16_t ring){
+    uint16_t radius = ring << 3;
+
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) show_pattern[i] = 0;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        if (led_layout_radius[led] < radius) show_pattern[led >> 5] |= 1UL << (led & 31);
+    }
+}
+
+static uint8_t show_run(anim_seq *s){
+    SEQ_BEGIN(s);
+    while (1) {
+        show_frame = show_pattern;
+        for (s->i = 0; s->i <= SHOW_RINGS; s->i++) {
+            show_ring(s->i);
+            SEQ_YIELD(s);
+        }
+        anim_seq_trigger(&pulse_seq, SHOW_FLASH);
+        SEQ_WAIT(s, SHOW_HOLD_FRAMES);
+
+        anim_sparkle_init(10, 180);
+        anim_seq_take(s, SHOW_SKIP);    // only presses from now on
+        for (s->i = 0; s->i < SHOW_SPARKLE_FRAMES; s->i++) {
+            if (anim_seq_take(s, SHOW_SKIP)) break;
+            show_frame = anim_sparkle_update();
+            SEQ_WAIT(s, SHOW_SPARKLE_TICKS);
+        }
+
+        show_frame = show_pattern;
+        s->i = SHOW_RINGS;
+        do {
+            show_ring(s->i);
+            SEQ_YIELD(s);
+        } while (s->i--);
+        SEQ_WAIT(s, SHOW_PAUSE_FRAMES);
+    }
+    SEQ_END(s);
+}
+
+static uint8_t show_pulse(anim_seq *s){
+    SEQ_BEGIN(s);
+    while (1) {
+        show_level = SHOW_LEVEL;
+        SEQ_WAIT_TRIGGER(s, SHOW_FLASH);
+        for (s->i = 0; s->i < 256; s->i += SHOW_PULSE_STEP) {
+            show_level = SHOW_LEVEL + fx_scale8(255 - SHOW_LEVEL, fx_triangle8(s->i));
+            SEQ_YIELD(s);
+        }
+    }
+    SEQ_END(s);
+}
+
+void anim_show_init(void){
+    show_frame = show_pattern;
+    show_level = SHOW_LEVEL;
+    anim_seq_start(&show_seq, show_run);
+    anim_seq_start(&pulse_seq, show_pulse);
+}
+
+uint32_t* anim_show_update(uint8_t *levels){
+    anim_seq_step(&show_seq);
+    anim_seq_step(&pulse_seq);
+
+    for (uint8_t led = 0; levels && led < CHARLIE_NUM_LEDS; led++) levels[led] = show_level;
+
+    return show_frame;
+}
+
+void anim_show_trigger(void){
+    anim_seq_trigger(&pulse_seq, SHOW_FLASH);
+    anim_seq_trigger(&show_seq, SHOW_SKIP);
+}
+
+#endif /* ANIM_LAYOUT */
@@ -0,0 +1,17 @@
+#ifndef ANIMATIONS_SEQ_H
+#define ANIMATIONS_SEQ_H
+#include <stdint.h>
+
+// Sequenced animations on anim_seq.h, conventions of animations_wave.h.
+//
+// The show: an impulse from the star centre out to the tips, a hold,
+// sparkle for 500 frames, the collapse back to the centre and a pause,
+// over and over. A second sequence runs next to it and pulses the levels
+// when triggered, by the show once the impulse has filled the star or by
+// anim_show_trigger(), which also skips the rest of the sparkle.
+// Written for one update every 20ms.
+void anim_show_init(void);
+uint32_t* anim_show_update(uint8_t *levels);
+void anim_show_trigger(void);
+
+#endif /* ANIMATIONS_SEQ_H */
@@ -1,9 +1,10 @@
 #include <ch32v00x.h>
-#include <stdlib.h>
 #include "animations_simple.h"
+#include "charlie_topology.h"
+#include "fixmath.h"
 
 #define TWINKLE_NUM_FRAMES      10
-#define TWINKLE_BITMASK_SIZE    2       // For 42 LEDs
+#define TWINKLE_BITMASK_SIZE    CHARLIE_BITMASK_SIZE    // frames cover the first 42 LEDs
 
 static const uint32_t twinkle_frames[TWINKLE_NUM_FRAMES][TWINKLE_BITMASK_SIZE] = {
     // Frame 0: LEDs 0, 5, 12, 18, 25, 31, 37, 40
@@ -40,13 +41,13 @@ static const uint32_t twinkle_frames[TWINKLE_NUM_FRAMES][TWINKLE_BITMASK_SIZE] =
 static uint8_t current_frame = 0;
 
 void twinkle_init(void){
-    srand(TIM2->CNT);
+    fx_srand(TIM2->CNT);
     
-    current_frame = rand() % TWINKLE_NUM_FRAMES;
+    current_frame = fx_range8(fx_rand8(), TWINKLE_NUM_FRAMES);
 }
 
 uint32_t* twinkle_next_frame(void){
-    current_frame = rand() % TWINKLE_NUM_FRAMES;
+    current_frame = fx_range8(fx_rand8(), TWINKLE_NUM_FRAMES);
     
     /* Return pointer to that frame's pattern */
     return (uint32_t*)twinkle_frames[current_frame];
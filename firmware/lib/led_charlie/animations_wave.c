@@ -0,0 +1,71 @@
+#include "animations_wave.h"
+#include "animations.h"
+#include "charlie_topology.h"
+#include "fixmath.h"
+#include "led_layout.h"
+
+typedef struct {
+    uint8_t phase;      // 8 bit angle
+    uint8_t speed;
+    uint8_t spread;
+} WaveState;
+
+static WaveState breathe_state = {0};
+static uint32_t wave_pattern[CHARLIE_BITMASK_SIZE] = {0};
+
+// Sets the pattern bit for every LED bright enough, see header
+static uint32_t* wave_output(const uint8_t *level_of, uint8_t *levels){
+    uint8_t threshold = levels ? 0 : 127;
+
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) wave_pattern[i] = 0;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        if (level_of[led] > threshold) wave_pattern[led >> 5] |= 1UL << (led & 31);
+        if (levels) levels[led] = level_of[led];
+    }
+
+    return wave_pattern;
+}
+
+void anim_breathe_init(uint8_t speed){
+    breathe_state.phase = 0;
+    breathe_state.speed = speed;
+}
+
+uint32_t* anim_breathe_update(uint8_t *levels){
+    static uint8_t level_of[CHARLIE_NUM_LEDS];
+
+    breathe_state.phase += breathe_state.speed;
+
+    // eased in and out, then squared for a roughly linear look to the eye
+    uint8_t level = fx_ease_in8(fx_ease_sine8(fx_triangle8(breathe_state.phase)));
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) level_of[led] = level;
+
+    return wave_output(level_of, levels);
+}
+
+// Only for the pin list led_layout is of, see animations.h
+#if ANIM_LAYOUT
+static WaveState wave_state = {0};
+
+void anim_wave_init(uint8_t speed, uint8_t spread){
+    wave_state.phase = 0;
+    wave_state.speed = speed;
+    wave_state.spread = spread;
+}
+
+uint32_t* anim_wave_update(uint8_t *levels){
+    static uint8_t level_of[CHARLIE_NUM_LEDS];
+
+    wave_state.phase -= wave_state.speed;   // minus: crest moves to +x
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        uint8_t angle = wave_state.phase + fx_scale8(led_layout[led].x, wave_state.spread);
+
+        level_of[led] = fx_ease_in8((uint8_t)(fx_sin8(angle) + 128));
+    }
+
+    return wave_output(level_of, levels);
+}
+#endif /* ANIM_LAYOUT */
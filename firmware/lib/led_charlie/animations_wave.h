@@ -0,0 +1,19 @@
+#ifndef ANIMATIONS_WAVE_H
+#define ANIMATIONS_WAVE_H
+#include <stdint.h>
+
+// Smooth animations on fixmath.h. The update functions fill `levels`
+// (one byte per LED, e.g. charlie_levels_back_buffer()) and return the
+// pattern of LEDs to light. With levels == 0 the pattern alone carries
+// the effect: LEDs above half brightness are lit.
+
+// Whole star breathing, speed = phase step per frame (1 = 256 frames per breath)
+void anim_breathe_init(uint8_t speed);
+uint32_t* anim_breathe_update(uint8_t *levels);
+
+// Sine wave travelling across the star from left to right, speed as above,
+// spread = part of a period across the star (255 = one full period)
+void anim_wave_init(uint8_t speed, uint8_t spread);
+uint32_t* anim_wave_update(uint8_t *levels);
+
+#endif /* ANIMATIONS_WAVE_H */
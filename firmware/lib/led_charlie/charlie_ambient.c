@@ -0,0 +1,70 @@
+#include "charlie_ambient.h"
+#include "fixmath.h"
+
+uint8_t ambient_log(uint16_t ticks){
+    uint8_t octave = 0;
+
+    if (ticks < 2) return 0;
+    while (ticks >> (octave + 1)) octave++;
+
+    // 4 bits below the top one as the fraction of the octave
+    uint8_t frac = octave >= 4 ? (ticks >> (octave - 4)) & 15 : (ticks << (4 - octave)) & 15;
+
+    return (uint8_t)(octave * 16 + frac);
+}
+
+void ambient_init(ambient_state *a){
+    ambient_calibrate(a, AMBIENT_BRIGHT_TICKS, AMBIENT_DARK_TICKS);
+    a->readings = 0;
+    a->next = 0;
+    a->light = 255;
+    a->scale = 255;
+}
+
+void ambient_calibrate(ambient_state *a, uint16_t bright_ticks, uint16_t dark_ticks){
+    a->bright_log = ambient_log(bright_ticks);
+    a->dark_log = ambient_log(dark_ticks);
+    if (a->dark_log <= a->bright_log) a->dark_log = a->bright_log + 1;
+
+    // only divide, once per calibration
+    a->gain = (uint16_t)((255UL << 8) / (a->dark_log - a->bright_log));
+}
+
+static inline uint8_t ambient_median3(const uint8_t *h){
+    uint8_t lo = h[0] < h[1] ? h[0] : h[1];
+    uint8_t hi = h[0] < h[1] ? h[1] : h[0];
+
+    return h[2] < lo ? lo : (h[2] > hi ? hi : h[2]);
+}
+
+uint8_t ambient_update(ambient_state *a, uint16_t ticks){
+    uint8_t reading = ambient_log(ticks);
+
+    // the first reading fills the filters, no ramp up from nothing
+    if (a->readings == 0) {
+        a->history[0] = a->history[1] = reading;
+        a->level = (uint16_t)reading << 8;
+    }
+    a->history[a->next] = reading;
+    a->next = a->next == 2 ? 0 : a->next + 1;
+    if (a->readings < 255) a->readings++;
+
+    int32_t target = (int32_t)ambient_median3(a->history) << 8;
+
+    a->level += (int16_t)((target - a->level) >> AMBIENT_FILTER_SHIFT);
+
+    // log scale to light between the two references
+    uint8_t steps = (uint8_t)((a->level + 128) >> 8);
+    uint32_t light = 0;
+
+    if (steps <= a->bright_log) light = 255;
+    else if (steps < a->dark_log) light = 255 - (fx_mul8(a->gain, steps - a->bright_log) >> 8);
+    a->light = (uint8_t)light;
+
+    uint8_t scale = AMBIENT_MIN_SCALE + fx_scale8(255 - AMBIENT_MIN_SCALE, a->light);
+    uint8_t diff = scale > a->scale ? scale - a->scale : a->scale - scale;
+
+    if (diff > AMBIENT_HYSTERESIS || (diff && (scale == 255 || scale == AMBIENT_MIN_SCALE))) a->scale = scale;
+
+    return a->scale;
+}
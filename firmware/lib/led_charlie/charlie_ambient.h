@@ -0,0 +1,56 @@
+#ifndef CHARLIE_AMBIENT_H
+#define CHARLIE_AMBIENT_H
+#include <stdint.h>
+
+// Auto-brightness from the ambient light an LED of the star sees, measured
+// by the driver as the discharge time of the reverse biased LED
+// (charlie_sense_start / charlie_sense_read). No hardware access in here,
+// sim/star_sim --ambient checks it with synthetic timings.
+//
+// Light goes with 1 / time, so readings are taken on a log scale, 16 steps
+// per octave of discharge time. A median of three drops single odd readings
+// (a hand passing by, the star reflected on something), a low pass follows
+// the rest and the brightness scale only moves by more than
+// AMBIENT_HYSTERESIS, so it doesn't pump on a steady light.
+//
+// The reference times are per board: LED type, pin capacitance and the
+// antiparallel partner of the sensing LED, which clamps its reverse bias,
+// all shift them. Override with -D or call ambient_calibrate().
+
+#ifndef AMBIENT_LED
+#define AMBIENT_LED             0       // sensing LED
+#endif
+#ifndef AMBIENT_BRIGHT_TICKS
+#define AMBIENT_BRIGHT_TICKS    4       // discharge time in a lit room, 10us
+#endif
+#ifndef AMBIENT_DARK_TICKS
+#define AMBIENT_DARK_TICKS      1024    // in the dark, 2.5ms
+#endif
+#define AMBIENT_MIN_SCALE       48      // brightness scale in the dark, still readable
+#define AMBIENT_FILTER_SHIFT    1       // low pass, half the way per reading
+#define AMBIENT_HYSTERESIS      12      // scale steps
+#define AMBIENT_PERIOD_MS       3000    // charlie_sense_start period of the main loop
+
+typedef struct {
+    uint8_t bright_log;     // calibration, reference times on the log scale
+    uint8_t dark_log;
+    uint16_t gain;          // light per log step, Q8
+    uint8_t history[3];     // last readings, log scale
+    uint8_t next;           // history slot of the next one
+    uint8_t readings;       // up to 255
+    uint16_t level;         // filtered reading, Q8 log scale
+    uint8_t light;          // 255 at the bright reference and above, 0 in the dark
+    uint8_t scale;          // brightness scale, AMBIENT_MIN_SCALE..255
+} ambient_state;
+
+// Discharge time on the log scale: 16 * log2(ticks), 0 for 0 and 1 tick
+uint8_t ambient_log(uint16_t ticks);
+
+// Default calibration, full scale until the first reading
+void ambient_init(ambient_state *a);
+void ambient_calibrate(ambient_state *a, uint16_t bright_ticks, uint16_t dark_ticks);
+
+// One measurement, returns the brightness scale
+uint8_t ambient_update(ambient_state *a, uint16_t ticks);
+
+#endif /* CHARLIE_AMBIENT_H */
@@ -0,0 +1,131 @@
+#include "charlie_perf.h"
+
+#ifdef CHARLIE_PERF
+
+#include <stdio.h>
+
+volatile uint32_t perf_isr_count = 0;
+
+static perf_data perf = {0};
+static uint32_t perf_last_scan = 0;
+static uint32_t perf_scans_at_frame = 0;
+static uint32_t perf_presents = 0;      // charlie_present_pattern() calls counted
+
+static const char * const perf_names[PERF_NUM_STATS] = {
+    "isr", "scan", "frame", "update"
+};
+static const uint8_t perf_hist_shift[PERF_NUM_STATS] = PERF_HIST_SHIFTS;
+
+// Free running SysTick on HCLK, counts up on the V003
+void perf_init(void){
+    SysTick->CTLR = 0;
+    SysTick->CMP = 0xFFFFFFFF;
+    SysTick->CNT = 0;
+    SysTick->CTLR = (1 << 2) | (1 << 0);   // STCLK = HCLK, STE
+
+    perf_reset();
+}
+
+void perf_reset(void){
+    __disable_irq();
+
+    for (int i = 0; i < PERF_NUM_STATS; i++) {
+        perf_stat *s = &perf.stat[i];
+
+        s->count = 0;
+        s->min = 0xFFFFFFFF;
+        s->max = 0;
+        s->total = 0;
+        for (int b = 0; b < PERF_HIST_BINS; b++) s->hist[b] = 0;
+    }
+
+    perf_isr_count = 0;
+    perf.frames = 0;
+    perf.frames_dropped = 0;
+    perf.scans = 0;
+    perf.start = perf_now();
+    perf_last_scan = perf.start;
+    perf_scans_at_frame = 0;
+
+    __enable_irq();
+}
+
+// Called from ISR and main loop, a few compares and adds, no divide
+void perf_record(perf_id id, uint32_t cycles){
+    perf_stat *s = &perf.stat[id];
+    uint32_t bin = cycles >> perf_hist_shift[id];
+
+    if (bin >= PERF_HIST_BINS) bin = PERF_HIST_BINS - 1;
+
+    s->count++;
+    s->total += cycles;
+    if (cycles < s->min) s->min = cycles;
+    if (cycles > s->max) s->max = cycles;
+    s->hist[bin]++;
+}
+
+// Frames presented by the main loop are counted here, in the ISR like the
+// ones from the command ring, so perf.frames has a single writer
+void perf_scan_done(uint32_t presents){
+    uint32_t now = perf_now();
+
+    while (perf_presents != presents) {
+        perf_presents++;
+        perf_frame_done();
+    }
+    perf.scans++;
+    perf_record(PERF_SCAN, now - perf_last_scan);
+    perf_last_scan = now;
+}
+
+// A frame counts as dropped when the previous one never made it through a
+// full scan. Display ISR only.
+void perf_frame_done(void){
+    uint32_t scans = perf.scans;
+
+    if (perf.frames && scans == perf_scans_at_frame) {
+        perf.frames_dropped++;
+    }
+    perf.frames++;
+    perf_scans_at_frame = scans;
+}
+
+void perf_snapshot(perf_data *out){
+    __disable_irq();
+    *out = perf;
+    out->isr_count = perf_isr_count;
+    __enable_irq();
+}
+
+void perf_report(void){
+    perf_data d;
+
+    perf_snapshot(&d);
+
+    uint32_t elapsed = perf_now() - d.start;
+    uint32_t ms = elapsed / (SystemCoreClock / 1000);
+
+    printf("perf: %lu ms, %lu isr, %lu scans, %lu frames, %lu dropped\r\n",
+           (unsigned long)ms, (unsigned long)d.isr_count, (unsigned long)d.scans,
+           (unsigned long)d.frames, (unsigned long)d.frames_dropped);
+    if (ms) {
+        printf("perf: isr rate %lu/s\r\n", (unsigned long)(d.isr_count / ms * 1000));
+    }
+
+    for (int i = 0; i < PERF_NUM_STATS; i++) {
+        perf_stat *s = &d.stat[i];
+
+        if (!s->count) continue;
+
+        printf("%-8s n=%lu min=%lu avg=%lu max=%lu | %lu:", perf_names[i],
+               (unsigned long)s->count, (unsigned long)s->min,
+               (unsigned long)(s->total / s->count), (unsigned long)s->max,
+               1UL << perf_hist_shift[i]);
+        for (int b = 0; b < PERF_HIST_BINS; b++) {
+            printf(" %lu", (unsigned long)s->hist[b]);
+        }
+        printf("\r\n");
+    }
+}
+
+#endif /* CHARLIE_PERF */
@@ -0,0 +1,75 @@
+#ifndef CHARLIE_PERF_H
+#define CHARLIE_PERF_H
+#include <stdint.h>
+
+// Runtime performance counters, enabled with -DCHARLIE_PERF.
+// Without it all PERF_* macros are empty and nothing is compiled in.
+//
+// Timestamps are SysTick cycles (HCLK), so the SDK Delay_* functions,
+// which reprogram SysTick, can't be used together with the counters.
+
+typedef enum {
+    PERF_ISR = 0,       // display ISR duration (TIM2, or TIM1 with CHARLIE_HW_PWM)
+    PERF_SCAN,          // time for one pass over all lit LEDs (jitter = max - min)
+    PERF_TASK_FRAME,    // main loop: computing the next animation frame
+    PERF_TASK_UPDATE,   // main loop: handing the frame to the driver
+    PERF_NUM_STATS
+} perf_id;
+
+// Histogram bins are 1 << shift cycles wide per stat, the last one is open
+// ended: isr 16 (a 48MHz tick is 120), scan 64k, frame 16k, update 256
+#define PERF_HIST_BINS      8
+#define PERF_HIST_SHIFTS    {4, 16, 14, 8}
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t total;
+    uint32_t hist[PERF_HIST_BINS];
+} perf_stat;
+
+typedef struct {
+    perf_stat stat[PERF_NUM_STATS];
+    uint32_t isr_count;
+    uint32_t frames;
+    uint32_t frames_dropped;    // pattern replaced before it was fully scanned once
+    uint32_t scans;
+    uint32_t start;             // cycle stamp of the last reset
+} perf_data;
+
+#ifdef CHARLIE_PERF
+
+#include <ch32v00x.h>
+
+static inline uint32_t perf_now(void){
+    return (uint32_t)SysTick->CNT;
+}
+
+void perf_init(void);
+void perf_reset(void);
+void perf_record(perf_id id, uint32_t cycles);
+void perf_scan_done(uint32_t presents);
+void perf_frame_done(void);
+void perf_snapshot(perf_data *out);
+void perf_report(void);
+
+extern volatile uint32_t perf_isr_count;
+
+#define PERF_START(stamp)       uint32_t stamp = perf_now()
+#define PERF_END(id, stamp)     perf_record((id), perf_now() - (stamp))
+#define PERF_ISR_TICK()         (perf_isr_count++)
+#define PERF_SCAN_DONE(presents) perf_scan_done(presents)
+#define PERF_FRAME_DONE()       perf_frame_done()
+
+#else
+
+#define PERF_START(stamp)
+#define PERF_END(id, stamp)
+#define PERF_ISR_TICK()
+#define PERF_SCAN_DONE(presents)
+#define PERF_FRAME_DONE()
+
+#endif /* CHARLIE_PERF */
+
+#endif /* CHARLIE_PERF_H */
@@ -0,0 +1,232 @@
+/* Generated by tools/gen_charlie_topology.py - do not edit.
+ * Source: custom_charlie_pins = PC0 PC1 PC2 PC3 PC5 PC6 PC7 */
+#ifndef CHARLIE_TOPOLOGY_H
+#define CHARLIE_TOPOLOGY_H
+
+#define CHARLIE_NUM_PINS        7
+#define CHARLIE_NUM_LEDS        42
+#define CHARLIE_BITMASK_SIZE    2
+#define CHARLIE_NUM_PORTS       1
+
+#endif /* CHARLIE_TOPOLOGY_H */
+
+// Tables are only pulled in by the driver
+#if defined(CHARLIE_TOPOLOGY_TABLES) && !defined(CHARLIE_TOPOLOGY_TABLES_H)
+#define CHARLIE_TOPOLOGY_TABLES_H
+
+#define CHARLIE_RCC_PERIPH      (RCC_APB2Periph_GPIOC)
+
+// Port tables read by the scan ISR every tick, the driver can place them in SRAM
+#ifndef CHARLIE_ISR_TABLE
+#define CHARLIE_ISR_TABLE(name)
+#endif
+
+typedef struct {
+    uint8_t port;       // index into charlie_ports
+    uint16_t pin;
+} charlie_pin_config;
+
+typedef struct {
+    uint8_t anode;      // index into charlie_pins
+    uint8_t cathode;
+} charlie_led_config;
+
+// Port register values to light one LED: CFGLR bits of all charlie pins
+// (anode + cathode push-pull, rest floating) and the BSHR write
+typedef struct {
+    uint32_t cfglr[CHARLIE_NUM_PORTS];
+    uint32_t bshr[CHARLIE_NUM_PORTS];
+} charlie_led_regs;
+
+static GPIO_TypeDef * const charlie_ports[CHARLIE_NUM_PORTS] CHARLIE_ISR_TABLE(ports) = {GPIOC};
+
+// CFGLR bits owned by charlie pins
+static const uint32_t charlie_cfg_mask[CHARLIE_NUM_PORTS] CHARLIE_ISR_TABLE(cfg_mask) = {0xFFF0FFFF};
+// CFGLR bits with all charlie pins floating
+static const uint32_t charlie_cfg_tri[CHARLIE_NUM_PORTS] CHARLIE_ISR_TABLE(cfg_tri) = {0x44404444};
+
+static const charlie_pin_config charlie_pins[CHARLIE_NUM_PINS] = {
+    {0, GPIO_Pin_0}, // CHARLIE_PIN_0 PC0
+    {0, GPIO_Pin_1}, // CHARLIE_PIN_1 PC1
+    {0, GPIO_Pin_2}, // CHARLIE_PIN_2 PC2
+    {0, GPIO_Pin_3}, // CHARLIE_PIN_3 PC3
+    {0, GPIO_Pin_5}, // CHARLIE_PIN_4 PC5
+    {0, GPIO_Pin_6}, // CHARLIE_PIN_5 PC6
+    {0, GPIO_Pin_7}, // CHARLIE_PIN_6 PC7
+};
+
+static const charlie_led_config full_charlie_matrix[CHARLIE_NUM_LEDS] = {
+    {6, 0}, // D1,2
+    {0, 6}, // D3,4
+    {5, 0}, // D5,6
+    {0, 5}, // D7,8
+    {4, 0}, // D9,10
+    {0, 4}, // D11,12
+    {3, 0}, // D13,14
+    {0, 3}, // D15,16
+    {2, 0}, // D17,18
+    {0, 2}, // D19,20
+    {1, 0}, // D21,22
+    {0, 1}, // D23,24
+    {6, 1}, // D25,26
+    {1, 6}, // D27,28
+    {5, 1}, // D29,30
+    {1, 5}, // D31,32
+    {4, 1}, // D33,34
+    {1, 4}, // D35,36
+    {3, 1}, // D37,38
+    {1, 3}, // D39,40
+    {2, 1}, // D41,42
+    {1, 2}, // D43,44
+    {6, 2}, // D45,46
+    {2, 6}, // D47,48
+    {5, 2}, // D49,50
+    {2, 5}, // D51,52
+    {4, 2}, // D53,54
+    {2, 4}, // D55,56
+    {3, 2}, // D57,58
+    {2, 3}, // D59,60
+    {6, 3}, // D61,62
+    {3, 6}, // D63,64
+    {5, 3}, // D65,66
+    {3, 5}, // D67,68
+    {4, 3}, // D69,70
+    {3, 4}, // D71,72
+    {6, 4}, // D73,74
+    {4, 6}, // D75,76
+    {5, 4}, // D77,78
+    {4, 5}, // D79,80
+    {6, 5}, // D81,82
+    {5, 6}, // D83,84
+};
+
+static const charlie_led_regs charlie_led_regs_table[CHARLIE_NUM_LEDS] = {
+    {{0x34404443}, {0x00010080}}, // D1,2 PC7+ PC0-
+    {{0x34404443}, {0x00800001}}, // D3,4 PC0+ PC7-
+    {{0x43404443}, {0x00010040}}, // D5,6 PC6+ PC0-
+    {{0x43404443}, {0x00400001}}, // D7,8 PC0+ PC6-
+    {{0x44304443}, {0x00010020}}, // D9,10 PC5+ PC0-
+    {{0x44304443}, {0x00200001}}, // D11,12 PC0+ PC5-
+    {{0x44403443}, {0x00010008}}, // D13,14 PC3+ PC0-
+    {{0x44403443}, {0x00080001}}, // D15,16 PC0+ PC3-
+    {{0x44404343}, {0x00010004}}, // D17,18 PC2+ PC0-
+    {{0x44404343}, {0x00040001}}, // D19,20 PC0+ PC2-
+    {{0x44404433}, {0x00010002}}, // D21,22 PC1+ PC0-
+    {{0x44404433}, {0x00020001}}, // D23,24 PC0+ PC1-
+    {{0x34404434}, {0x00020080}}, // D25,26 PC7+ PC1-
+    {{0x34404434}, {0x00800002}}, // D27,28 PC1+ PC7-
+    {{0x43404434}, {0x00020040}}, // D29,30 PC6+ PC1-
+    {{0x43404434}, {0x00400002}}, // D31,32 PC1+ PC6-
+    {{0x44304434}, {0x00020020}}, // D33,34 PC5+ PC1-
+    {{0x44304434}, {0x00200002}}, // D35,36 PC1+ PC5-
+    {{0x44403434}, {0x00020008}}, // D37,38 PC3+ PC1-
+    {{0x44403434}, {0x00080002}}, // D39,40 PC1+ PC3-
+    {{0x44404334}, {0x00020004}}, // D41,42 PC2+ PC1-
+    {{0x44404334}, {0x00040002}}, // D43,44 PC1+ PC2-
+    {{0x34404344}, {0x00040080}}, // D45,46 PC7+ PC2-
+    {{0x34404344}, {0x00800004}}, // D47,48 PC2+ PC7-
+    {{0x43404344}, {0x00040040}}, // D49,50 PC6+ PC2-
+    {{0x43404344}, {0x00400004}}, // D51,52 PC2+ PC6-
+    {{0x44304344}, {0x00040020}}, // D53,54 PC5+ PC2-
+    {{0x44304344}, {0x00200004}}, // D55,56 PC2+ PC5-
+    {{0x44403344}, {0x00040008}}, // D57,58 PC3+ PC2-
+    {{0x44403344}, {0x00080004}}, // D59,60 PC2+ PC3-
+    {{0x34403444}, {0x00080080}}, // D61,62 PC7+ PC3-
+    {{0x34403444}, {0x00800008}}, // D63,64 PC3+ PC7-
+    {{0x43403444}, {0x00080040}}, // D65,66 PC6+ PC3-
+    {{0x43403444}, {0x00400008}}, // D67,68 PC3+ PC6-
+    {{0x44303444}, {0x00080020}}, // D69,70 PC5+ PC3-
+    {{0x44303444}, {0x00200008}}, // D71,72 PC3+ PC5-
+    {{0x34304444}, {0x00200080}}, // D73,74 PC7+ PC5-
+    {{0x34304444}, {0x00800020}}, // D75,76 PC5+ PC7-
+    {{0x43304444}, {0x00200040}}, // D77,78 PC6+ PC5-
+    {{0x43304444}, {0x00400020}}, // D79,80 PC5+ PC6-
+    {{0x33404444}, {0x00400080}}, // D81,82 PC7+ PC6-
+    {{0x33404444}, {0x00800040}}, // D83,84 PC6+ PC7-
+};
+
+// Scan by pins (charlie_set_scan_order): the next LED is the one with the
+// fewest pin changes from the last one gone off, software PWM keeps the
+// anode of a released LED driven. Pin changes per full scan:
+#ifndef CHARLIE_HW_PWM
+// 168 in LED order, 92 by pins
+static const uint8_t charlie_scan_order[CHARLIE_NUM_LEDS] = {
+    0, 12, 22, 30, 36, 40, 1, 3, 5, 7, 9, 11, 2, 14,
+    24, 32, 38, 41, 15, 10, 13, 17, 19, 21, 16, 4, 26, 34,
+    37, 39, 27, 8, 20, 23, 25, 29, 28, 6, 18, 31, 33, 35,
+};
+#endif
+#ifdef CHARLIE_HW_PWM
+// 123 in LED order, 115 by pins
+static const uint8_t charlie_scan_order[CHARLIE_NUM_LEDS] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+    15, 14, 16, 17, 18, 19, 21, 20, 22, 23, 25, 24, 26, 27,
+    28, 29, 31, 30, 32, 33, 34, 35, 36, 37, 39, 38, 40, 41,
+};
+#endif
+// CFGLR bits of each charlie pin
+static const uint32_t charlie_pin_cfg[CHARLIE_NUM_PINS] CHARLIE_ISR_TABLE(pin_cfg) = {0x0000000F, 0x000000F0, 0x00000F00, 0x0000F000, 0x00F00000, 0x0F000000, 0xF0000000};
+
+// Hardware PWM (CHARLIE_HW_PWM): TIM1 drives the on-time through a channel
+// pin of each LED, 36 of 42 LEDs have one with this remap. The others
+// are lit as usual and switched off by the CH4 compare interrupt.
+#define CHARLIE_HW_REMAP        GPIO_PartialRemap1_TIM1
+#define CHARLIE_HW_FALLBACK_CH  3
+
+#ifdef CHARLIE_HW_PWM
+// Same as charlie_led_regs with the channel pin in alternate function mode,
+// ccer enables its output (0 = no channel pin) and ch picks the CHxCVR
+typedef struct {
+    uint32_t cfglr[CHARLIE_NUM_PORTS];
+    uint32_t bshr[CHARLIE_NUM_PORTS];
+    uint16_t ccer;
+    uint8_t ch;
+} charlie_hw_regs;
+
+static const charlie_hw_regs charlie_hw_regs_table[CHARLIE_NUM_LEDS] = {
+    {{0xB4404443}, {0x00010000}, 0x0010, 1}, // D1,2 PC7+ PC0- CH2 on PC7
+    {{0x3440444B}, {0x00800000}, 0x0100, 2}, // D3,4 PC0+ PC7- CH3 on PC0
+    {{0x4B404443}, {0x00010000}, 0x0001, 0}, // D5,6 PC6+ PC0- CH1 on PC6
+    {{0x4340444B}, {0x00400000}, 0x0100, 2}, // D7,8 PC0+ PC6- CH3 on PC0
+    {{0x4430444B}, {0x00000020}, 0x0300, 2}, // D9,10 PC5+ PC0- CH3 on PC0
+    {{0x4430444B}, {0x00200000}, 0x0100, 2}, // D11,12 PC0+ PC5- CH3 on PC0
+    {{0x4440B443}, {0x00010000}, 0x0004, 0}, // D13,14 PC3+ PC0- CH1N on PC3
+    {{0x4440344B}, {0x00080000}, 0x0100, 2}, // D15,16 PC0+ PC3- CH3 on PC0
+    {{0x4440434B}, {0x00000004}, 0x0300, 2}, // D17,18 PC2+ PC0- CH3 on PC0
+    {{0x4440434B}, {0x00040000}, 0x0100, 2}, // D19,20 PC0+ PC2- CH3 on PC0
+    {{0x4440443B}, {0x00000002}, 0x0300, 2}, // D21,22 PC1+ PC0- CH3 on PC0
+    {{0x4440443B}, {0x00020000}, 0x0100, 2}, // D23,24 PC0+ PC1- CH3 on PC0
+    {{0xB4404434}, {0x00020000}, 0x0010, 1}, // D25,26 PC7+ PC1- CH2 on PC7
+    {{0xB4404434}, {0x00000002}, 0x0030, 1}, // D27,28 PC1+ PC7- CH2 on PC7
+    {{0x4B404434}, {0x00020000}, 0x0001, 0}, // D29,30 PC6+ PC1- CH1 on PC6
+    {{0x4B404434}, {0x00000002}, 0x0003, 0}, // D31,32 PC1+ PC6- CH1 on PC6
+    {{0x44304434}, {0x00020020}, 0x0000, 3}, // D33,34 PC5+ PC1- CC4 irq
+    {{0x44304434}, {0x00200002}, 0x0000, 3}, // D35,36 PC1+ PC5- CC4 irq
+    {{0x4440B434}, {0x00020000}, 0x0004, 0}, // D37,38 PC3+ PC1- CH1N on PC3
+    {{0x4440B434}, {0x00000002}, 0x000C, 0}, // D39,40 PC1+ PC3- CH1N on PC3
+    {{0x44404334}, {0x00020004}, 0x0000, 3}, // D41,42 PC2+ PC1- CC4 irq
+    {{0x44404334}, {0x00040002}, 0x0000, 3}, // D43,44 PC1+ PC2- CC4 irq
+    {{0xB4404344}, {0x00040000}, 0x0010, 1}, // D45,46 PC7+ PC2- CH2 on PC7
+    {{0xB4404344}, {0x00000004}, 0x0030, 1}, // D47,48 PC2+ PC7- CH2 on PC7
+    {{0x4B404344}, {0x00040000}, 0x0001, 0}, // D49,50 PC6+ PC2- CH1 on PC6
+    {{0x4B404344}, {0x00000004}, 0x0003, 0}, // D51,52 PC2+ PC6- CH1 on PC6
+    {{0x44304344}, {0x00040020}, 0x0000, 3}, // D53,54 PC5+ PC2- CC4 irq
+    {{0x44304344}, {0x00200004}, 0x0000, 3}, // D55,56 PC2+ PC5- CC4 irq
+    {{0x4440B344}, {0x00040000}, 0x0004, 0}, // D57,58 PC3+ PC2- CH1N on PC3
+    {{0x4440B344}, {0x00000004}, 0x000C, 0}, // D59,60 PC2+ PC3- CH1N on PC3
+    {{0xB4403444}, {0x00080000}, 0x0010, 1}, // D61,62 PC7+ PC3- CH2 on PC7
+    {{0x3440B444}, {0x00800000}, 0x0004, 0}, // D63,64 PC3+ PC7- CH1N on PC3
+    {{0x4B403444}, {0x00080000}, 0x0001, 0}, // D65,66 PC6+ PC3- CH1 on PC6
+    {{0x4340B444}, {0x00400000}, 0x0004, 0}, // D67,68 PC3+ PC6- CH1N on PC3
+    {{0x4430B444}, {0x00000020}, 0x000C, 0}, // D69,70 PC5+ PC3- CH1N on PC3
+    {{0x4430B444}, {0x00200000}, 0x0004, 0}, // D71,72 PC3+ PC5- CH1N on PC3
+    {{0xB4304444}, {0x00200000}, 0x0010, 1}, // D73,74 PC7+ PC5- CH2 on PC7
+    {{0xB4304444}, {0x00000020}, 0x0030, 1}, // D75,76 PC5+ PC7- CH2 on PC7
+    {{0x4B304444}, {0x00200000}, 0x0001, 0}, // D77,78 PC6+ PC5- CH1 on PC6
+    {{0x4B304444}, {0x00000020}, 0x0003, 0}, // D79,80 PC5+ PC6- CH1 on PC6
+    {{0xB3404444}, {0x00400000}, 0x0010, 1}, // D81,82 PC7+ PC6- CH2 on PC7
+    {{0x3B404444}, {0x00800000}, 0x0001, 0}, // D83,84 PC6+ PC7- CH1 on PC6
+};
+#endif /* CHARLIE_HW_PWM */
+
+#endif /* CHARLIE_TOPOLOGY_TABLES */
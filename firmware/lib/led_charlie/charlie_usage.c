@@ -0,0 +1,110 @@
+#include "charlie_usage.h"
+
+#ifdef CHARLIE_USAGE
+
+#include <stdio.h>
+#include <ch32v00x.h>
+#include "led_charlie.h"
+
+#define USAGE_BAR_WIDTH     20
+
+volatile uint32_t usage_ticks = 0;
+volatile uint32_t usage_slots = 0;
+volatile uint32_t usage_on[CHARLIE_NUM_LEDS];
+
+void usage_reset(void){
+    __disable_irq();
+
+    usage_ticks = 0;
+    usage_slots = 0;
+    for (int i = 0; i < CHARLIE_NUM_LEDS; i++) usage_on[i] = 0;
+
+    __enable_irq();
+}
+
+void usage_snapshot(usage_data *out){
+    __disable_irq();
+
+    out->ticks = usage_ticks;
+    out->slots = usage_slots;
+    for (int i = 0; i < CHARLIE_NUM_LEDS; i++) out->on[i] = usage_on[i];
+
+    __enable_irq();
+}
+
+void usage_pin_load(const usage_data *d, usage_pins *out){
+    for (int p = 0; p < CHARLIE_NUM_PINS; p++) {
+        out->source[p] = 0;
+        out->sink[p] = 0;
+    }
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        uint8_t anode, cathode;
+
+        charlie_led_pins(led, &anode, &cathode);
+        out->source[anode] += d->on[led];
+        out->sink[cathode] += d->on[led];
+    }
+}
+
+// Duty in 1/1000 of the accounted time
+static uint32_t usage_permille(uint32_t on, uint32_t ticks){
+    return ticks ? (uint32_t)((uint64_t)on * 1000 / ticks) : 0;
+}
+
+static void usage_bar(uint32_t permille, uint32_t max){
+    uint32_t n = max ? permille * USAGE_BAR_WIDTH / max : 0;
+
+    printf(" ");
+    for (uint32_t i = 0; i < n; i++) printf("#");
+    printf("\r\n");
+}
+
+// Heatmap on the debug UART: duty of every LED and pin in 1/1000 since the
+// last reset, bars scaled to the hottest one, LEDs that were never lit
+// counted at the end
+void usage_report(void){
+    static usage_data d;
+    usage_pins pins;
+    uint32_t max = 0, unused = 0, total = 0;
+
+    usage_snapshot(&d);
+    usage_pin_load(&d, &pins);
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        uint32_t pm = usage_permille(d.on[led], d.ticks);
+
+        if (pm > max) max = pm;
+        if (!d.on[led]) unused++;
+        total += d.on[led];
+    }
+
+    printf("usage: %lu ticks, %lu slots, average %lu/1000 LEDs lit\r\n",
+           (unsigned long)d.ticks, (unsigned long)d.slots, (unsigned long)usage_permille(total, d.ticks));
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        uint32_t pm = usage_permille(d.on[led], d.ticks);
+
+        printf("D%u,%u\t%3lu", led * 2 + 1, led * 2 + 2, (unsigned long)pm);
+        usage_bar(pm, max);
+    }
+
+    max = 0;
+    for (uint8_t p = 0; p < CHARLIE_NUM_PINS; p++) {
+        uint32_t pm = usage_permille(pins.source[p] + pins.sink[p], d.ticks);
+
+        if (pm > max) max = pm;
+    }
+
+    for (uint8_t p = 0; p < CHARLIE_NUM_PINS; p++) {
+        uint32_t src = usage_permille(pins.source[p], d.ticks);
+        uint32_t sink = usage_permille(pins.sink[p], d.ticks);
+
+        printf("pin %u\tsource %3lu sink %3lu", p, (unsigned long)src, (unsigned long)sink);
+        usage_bar(src + sink, max);
+    }
+
+    printf("usage: %lu LEDs never lit\r\n", (unsigned long)unused);
+}
+
+#endif /* CHARLIE_USAGE */
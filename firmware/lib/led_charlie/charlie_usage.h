@@ -0,0 +1,56 @@
+#ifndef CHARLIE_USAGE_H
+#define CHARLIE_USAGE_H
+#include <stdint.h>
+#include "charlie_topology.h"
+
+// Per LED on-time accounting, enabled with -DCHARLIE_USAGE.
+// The display ISR adds the on-time of the LED it shows once per slot, so
+// every lit LED costs one add per scan, nothing per PWM tick. Counters are
+// PWM ticks (2.5us) since the last usage_reset(): the debug command of
+// main.c resets them after its report, `star_stream.py PORT usage --reset`
+// over the stream. usage_ticks wraps after about 3h, so a report covers
+// less than that.
+//
+// Pin load is the sum over the LEDs a pin drives: as anode it sources
+// the LED current, as cathode it sinks it.
+
+typedef struct {
+    uint32_t ticks;                     // PWM ticks accounted, the time base
+    uint32_t slots;                     // LED slots (PWM periods) shown
+    uint32_t on[CHARLIE_NUM_LEDS];      // PWM ticks every LED was lit
+} usage_data;
+
+typedef struct {
+    uint32_t source[CHARLIE_NUM_PINS];  // on-ticks as anode
+    uint32_t sink[CHARLIE_NUM_PINS];    // on-ticks as cathode
+} usage_pins;
+
+#ifdef CHARLIE_USAGE
+
+extern volatile uint32_t usage_ticks;
+extern volatile uint32_t usage_slots;
+extern volatile uint32_t usage_on[CHARLIE_NUM_LEDS];
+
+// Display ISR, start of a slot: led is lit while the PWM counter is below
+// level, so for level ticks of the period (all of them in 64-step mode
+// above 63). The software PWM passes level rounded up to its step.
+static inline void usage_slot(uint8_t led, uint16_t level, uint16_t period){
+    usage_ticks += period;
+    usage_slots++;
+    if (led < CHARLIE_NUM_LEDS) usage_on[led] += level < period ? level : period;
+}
+
+void usage_reset(void);
+void usage_snapshot(usage_data *out);
+void usage_pin_load(const usage_data *d, usage_pins *out);
+void usage_report(void);
+
+#define USAGE_SLOT(led, level, period)  usage_slot((led), (level), (period))
+
+#else
+
+#define USAGE_SLOT(led, level, period)
+
+#endif /* CHARLIE_USAGE */
+
+#endif /* CHARLIE_USAGE_H */
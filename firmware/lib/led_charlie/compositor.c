@@ -0,0 +1,77 @@
+#include "compositor.h"
+
+typedef struct {
+    comp_frame_fn frame;
+    uint8_t op;
+    uint8_t enabled;
+} CompLayer;
+
+static CompLayer comp_layers[COMP_NUM_LAYERS] = {0};
+static uint32_t comp_pattern[CHARLIE_BITMASK_SIZE] = {0};
+
+void comp_init(void){
+    for (uint8_t i = 0; i < COMP_NUM_LAYERS; i++) {
+        comp_clear_layer(i);
+    }
+
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        comp_pattern[i] = 0;
+    }
+}
+
+void comp_set_layer(uint8_t layer, comp_frame_fn frame, comp_op op){
+    if (layer >= COMP_NUM_LAYERS) return;
+
+    comp_layers[layer].frame = frame;
+    comp_layers[layer].op = op;
+    comp_layers[layer].enabled = (frame != 0);
+}
+
+void comp_clear_layer(uint8_t layer){
+    comp_set_layer(layer, 0, COMP_OP_OR);
+}
+
+void comp_enable_layer(uint8_t layer, uint8_t enable){
+    if (layer >= COMP_NUM_LAYERS) return;
+
+    comp_layers[layer].enabled = enable && comp_layers[layer].frame;
+}
+
+// Every layer is stepped even when its result gets masked away,
+// so animations keep their own timing independent of the stack
+uint32_t* comp_next_frame(void){
+    uint32_t out[CHARLIE_BITMASK_SIZE] = {0};
+
+    for (uint8_t l = 0; l < COMP_NUM_LAYERS; l++) {
+        if (!comp_layers[l].enabled) continue;
+
+        uint32_t *src = comp_layers[l].frame();
+        if (!src) continue;  // animation finished, layer is transparent
+
+        switch (comp_layers[l].op) {
+            case COMP_OP_OR:
+                for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) out[i] |= src[i];
+                break;
+            case COMP_OP_MASK:
+                for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) out[i] &= src[i];
+                break;
+            case COMP_OP_XOR:
+                for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) out[i] ^= src[i];
+                break;
+            default:
+                for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) out[i] = src[i];
+                break;
+        }
+    }
+
+    /* XOR can set bits beyond the last LED */
+    if (CHARLIE_NUM_LEDS % 32) {
+        out[CHARLIE_BITMASK_SIZE - 1] &= (1UL << (CHARLIE_NUM_LEDS % 32)) - 1;
+    }
+
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        comp_pattern[i] = out[i];
+    }
+
+    return comp_pattern;
+}
@@ -0,0 +1,27 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+#include <stdint.h>
+#include "charlie_topology.h"
+
+#define COMP_NUM_LAYERS     4
+
+// Any animation update function, e.g. anim_sparkle_update or twinkle_next_frame
+typedef uint32_t* (*comp_frame_fn)(void);
+
+typedef enum {
+    COMP_OP_OR = 0,     // add the layer's LEDs
+    COMP_OP_MASK,       // keep only LEDs lit in the layer (AND)
+    COMP_OP_XOR,        // invert where the layer is lit
+    COMP_OP_REPLACE     // discard layers below
+} comp_op;
+
+// Layers are applied in order 0..COMP_NUM_LAYERS-1 on top of an empty frame
+void comp_init(void);
+void comp_set_layer(uint8_t layer, comp_frame_fn frame, comp_op op);
+void comp_clear_layer(uint8_t layer);
+void comp_enable_layer(uint8_t layer, uint8_t enable);
+
+// Advances all layer animations by one frame, returns the composed bitpattern
+uint32_t* comp_next_frame(void);
+
+#endif /* COMPOSITOR_H */
@@ -0,0 +1,104 @@
+#include "fixmath.h"
+
+// First quarter of a sine, 65 points so the interpolation has an end
+static const int8_t fx_sin8_lut[65] = {
+    0, 3, 6, 9, 12, 16, 19, 22, 25, 28, 31, 34, 37, 40, 43, 46,
+    49, 51, 54, 57, 60, 63, 65, 68, 71, 73, 76, 78, 81, 83, 85, 88,
+    90, 92, 94, 96, 98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+    117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+    127
+};
+
+static const int16_t fx_sin16_lut[65] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767
+};
+
+static uint32_t fx_rand_state = 0x2545F491;
+
+int8_t fx_sin8(uint8_t angle){
+    uint8_t idx = angle & 63;
+
+    if (angle & 64) idx = 64 - idx;     // 2nd and 4th quarter mirror
+
+    int8_t v = fx_sin8_lut[idx];
+
+    return (angle & 128) ? -v : v;
+}
+
+// 256 steps per quarter, linear between the table points
+int16_t fx_sin16(uint16_t angle){
+    uint16_t pos = angle & 0x3FFF;
+
+    if (angle & 0x4000) pos = 0x4000 - pos;
+
+    uint8_t idx = pos >> 8;
+    uint8_t frac = pos & 0xFF;
+    int16_t v = fx_sin16_lut[idx];
+
+    if (frac) {
+        v += (int16_t)(fx_mul8(fx_sin16_lut[idx + 1] - v, frac) >> 8);
+    }
+
+    return (angle & 0x8000) ? -v : v;
+}
+
+void fx_srand(uint32_t seed){
+    fx_rand_state = seed ? seed : 0x2545F491;   // xorshift is stuck at 0
+}
+
+uint32_t fx_rand(void){
+    uint32_t x = fx_rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fx_rand_state = x;
+
+    return x;
+}
+
+#ifdef CHARLIE_PERF
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "charlie_perf.h"
+
+#define FX_BENCH_N      256
+
+static volatile int32_t fx_bench_sink;
+
+// Average cycles per call over FX_BENCH_N calls, loop overhead included
+#define FX_BENCH(label, expr) do {                              \
+        uint32_t t0 = perf_now();                               \
+        for (uint32_t i = 0; i < FX_BENCH_N; i++) {             \
+            fx_bench_sink = (int32_t)(expr);                    \
+        }                                                       \
+        printf("%-24s %5lu cycles\r\n", label,                  \
+               (unsigned long)((perf_now() - t0) / FX_BENCH_N));\
+    } while (0)
+
+// Cycles of the libc / soft float calls against their replacements,
+// printed at boot by the CHARLIE_PERF builds
+void fx_bench_report(void){
+    volatile uint8_t n = 42;
+    volatile float step = 6.2831853f / 256;
+
+    FX_BENCH("fx_sin8", fx_sin8(i));
+    FX_BENCH("fx_sin16", fx_sin16(i << 8 | i));
+    FX_BENCH("sinf * 127", sinf(i * step) * 127);
+    FX_BENCH("fx_scale8", fx_scale8(i, n));
+    FX_BENCH("u8 * u8 >> 8 (__mulsi3)", (i * n) >> 8);
+    FX_BENCH("fx_range8(fx_rand8)", fx_range8(fx_rand8(), n));
+    FX_BENCH("rand() % n", rand() % n);
+}
+
+#endif /* CHARLIE_PERF */
@@ -0,0 +1,85 @@
+#ifndef FIXMATH_H
+#define FIXMATH_H
+#include <stdint.h>
+
+// Fixed point helpers for the CH32V003 (RV32EC: no FPU, no multiply,
+// no divide). Multiplies are short shift-add loops over an 8 bit
+// operand, nothing here pulls in libgcc's __mulsi3/__udivsi3.
+//
+// Angles: 8 bit = 256 per turn, 16 bit = 65536 per turn.
+// Q8 values are 0..255 meaning 0..1.
+
+// a * b for an 8 bit b, 8 rounds at most
+static inline uint32_t fx_mul8(uint32_t a, uint8_t b){
+    uint32_t acc = 0;
+
+    for (; b; b >>= 1, a <<= 1) {
+        if (b & 1) acc += a;
+    }
+
+    return acc;
+}
+
+// a * b / 256 with b = 255 meaning 1.0, scale8(a, 255) == a
+static inline uint8_t fx_scale8(uint8_t a, uint8_t b){
+    return (uint8_t)((fx_mul8(a, b) + a) >> 8);
+}
+
+// Uniform 0..n-1 from a random byte, n up to 256, no modulo
+static inline uint8_t fx_range8(uint8_t r, uint16_t n){
+    return (uint8_t)(fx_mul8(n, r) >> 8);
+}
+
+static inline uint8_t fx_lerp8(uint8_t a, uint8_t b, uint8_t t){
+    return (b >= a) ? a + fx_scale8(b - a, t) : a - fx_scale8(a - b, t);
+}
+
+int8_t fx_sin8(uint8_t angle);      // -127..127
+int16_t fx_sin16(uint16_t angle);   // Q15, -32767..32767
+
+static inline int8_t fx_cos8(uint8_t angle){
+    return fx_sin8(angle + 64);
+}
+
+static inline int16_t fx_cos16(uint16_t angle){
+    return fx_sin16(angle + 16384);
+}
+
+// Easing curves, Q8 in and out, 0 -> 0 and 255 -> 255
+static inline uint8_t fx_ease_in8(uint8_t t){
+    return fx_scale8(t, t);
+}
+
+static inline uint8_t fx_ease_out8(uint8_t t){
+    return 255 - fx_ease_in8(255 - t);
+}
+
+static inline uint8_t fx_ease_inout8(uint8_t t){
+    if (t < 128) return fx_ease_in8(t << 1) >> 1;
+    return 255 - (fx_ease_in8((255 - t) << 1) >> 1);
+}
+
+// Half a cosine period, the softest start and stop
+static inline uint8_t fx_ease_sine8(uint8_t t){
+    return (uint8_t)(127 - fx_cos8(t >> 1)) + (t >> 7);
+}
+
+// 0..255..0 over one 8 bit period
+static inline uint8_t fx_triangle8(uint8_t phase){
+    return (phase < 128) ? (phase << 1) : (uint8_t)(255 - (phase << 1));
+}
+
+// xorshift32, replaces rand() which on newlib is a 64 bit LCG multiply
+void fx_srand(uint32_t seed);
+uint32_t fx_rand(void);
+
+static inline uint8_t fx_rand8(void){
+    return (uint8_t)(fx_rand() >> 24);
+}
+
+#ifdef CHARLIE_PERF
+// Cycle counts of these helpers against float and libgcc, printed on USART1
+void fx_bench_report(void);
+#endif
+
+#endif /* FIXMATH_H */
@@ -1,126 +1,159 @@
 #include "led_charlie.h"
+#include "charlie_perf.h"
+#include "charlie_usage.h"
+#include "fixmath.h"
 #include <ch32v00x.h>
 
-#define CHARLIE_GPIO_PORT   GPIOC
-#define CHARLIE_RCC_PERIPH  RCC_APB2Periph_GPIOC
-
-#define CHARLIE_PIN_0       GPIO_Pin_0
-#define CHARLIE_PIN_1       GPIO_Pin_1
-#define CHARLIE_PIN_2       GPIO_Pin_2
-#define CHARLIE_PIN_3       GPIO_Pin_3
-#define CHARLIE_PIN_4       GPIO_Pin_5
-#define CHARLIE_PIN_5       GPIO_Pin_6
-#define CHARLIE_PIN_6       GPIO_Pin_7
-
-#define CHARLIE_NUM_PINS    7
-#define CHARLIE_NUM_LEDS    42
-#define CHARLIE_BITMASK_SIZE 2
-
-static const uint16_t charlie_pins[CHARLIE_NUM_PINS] = {
-    CHARLIE_PIN_0,
-    CHARLIE_PIN_1,
-    CHARLIE_PIN_2,
-    CHARLIE_PIN_3,
-    CHARLIE_PIN_4,
-    CHARLIE_PIN_5,
-    CHARLIE_PIN_6
-};
-
-typedef struct {
-    uint16_t anode;
-    uint16_t cathode;
-} charlie_led_config;
-
-static const charlie_led_config full_charlie_matrix[CHARLIE_NUM_LEDS] = {
-    {CHARLIE_PIN_6, CHARLIE_PIN_0}, // D1,2
-    {CHARLIE_PIN_0, CHARLIE_PIN_6}, // D3,4
-    {CHARLIE_PIN_5, CHARLIE_PIN_0}, // D5,6
-    {CHARLIE_PIN_0, CHARLIE_PIN_5}, // D7,8
-    {CHARLIE_PIN_4, CHARLIE_PIN_0}, // D9,10
-    {CHARLIE_PIN_0, CHARLIE_PIN_4}, // D11,12
-    {CHARLIE_PIN_3, CHARLIE_PIN_0}, // D13,14
-    {CHARLIE_PIN_0, CHARLIE_PIN_3}, // D15,16
-    {CHARLIE_PIN_2, CHARLIE_PIN_0}, // D17,18
-    {CHARLIE_PIN_0, CHARLIE_PIN_2}, // D19,20
-    {CHARLIE_PIN_1, CHARLIE_PIN_0}, // D21,22
-    {CHARLIE_PIN_0, CHARLIE_PIN_1}, // D23,24
-    {CHARLIE_PIN_6, CHARLIE_PIN_1}, // D25,26
-    {CHARLIE_PIN_1, CHARLIE_PIN_6}, // D27,28
-    {CHARLIE_PIN_5, CHARLIE_PIN_1}, // D29,30
-    {CHARLIE_PIN_1, CHARLIE_PIN_5}, // D31,32
-    {CHARLIE_PIN_4, CHARLIE_PIN_1}, // D33,34
-    {CHARLIE_PIN_1, CHARLIE_PIN_4}, // D35,36
-    {CHARLIE_PIN_3, CHARLIE_PIN_1}, // D37,38
-    {CHARLIE_PIN_1, CHARLIE_PIN_3}, // D39,40
-    {CHARLIE_PIN_2, CHARLIE_PIN_1}, // D41,42
-    {CHARLIE_PIN_1, CHARLIE_PIN_2}, // D43,44
-    {CHARLIE_PIN_6, CHARLIE_PIN_2}, // D45,46
-    {CHARLIE_PIN_2, CHARLIE_PIN_6}, // D47,48
-    {CHARLIE_PIN_5, CHARLIE_PIN_2}, // D49,50
-    {CHARLIE_PIN_2, CHARLIE_PIN_5}, // D51,52
-    {CHARLIE_PIN_4, CHARLIE_PIN_2}, // D53,54
-    {CHARLIE_PIN_2, CHARLIE_PIN_4}, // D55,56
-    {CHARLIE_PIN_3, CHARLIE_PIN_2}, // D57,58
-    {CHARLIE_PIN_2, CHARLIE_PIN_3}, // D59,60
-    {CHARLIE_PIN_6, CHARLIE_PIN_3}, // D61,62
-    {CHARLIE_PIN_3, CHARLIE_PIN_6}, // D63,64
-    {CHARLIE_PIN_5, CHARLIE_PIN_3}, // D65,66
-    {CHARLIE_PIN_3, CHARLIE_PIN_5}, // D67,68
-    {CHARLIE_PIN_4, CHARLIE_PIN_3}, // D69,70
-    {CHARLIE_PIN_3, CHARLIE_PIN_4}, // D71,72
-    {CHARLIE_PIN_6, CHARLIE_PIN_4}, // D73,74
-    {CHARLIE_PIN_4, CHARLIE_PIN_6}, // D75,76
-    {CHARLIE_PIN_5, CHARLIE_PIN_4}, // D77,78
-    {CHARLIE_PIN_4, CHARLIE_PIN_5}, // D79,80
-    {CHARLIE_PIN_6, CHARLIE_PIN_5}, // D81,82
-    {CHARLIE_PIN_5, CHARLIE_PIN_6}, // D83,84
-};
-
-// more charlie matrix combinations
+// CHARLIE_RAM_ISR: the per tick path of the scan ISR and the port masks it
+// reads run from SRAM, no flash wait states. What runs once per LED slot or
+// less (next LED, sense poll, draining the command ring) and the per LED
+// tables stay in flash, SRAM holds 2K with the stack. Needs ch32v003_star.ld
+// (.highcode), tools/ram_report.py prints the budget after the link.
+#ifdef CHARLIE_RAM_ISR
+#define CHARLIE_RAM_CODE            __attribute__((section(".highcode.charlie")))
+#define CHARLIE_SLOT_CODE           __attribute__((noinline))
+#define CHARLIE_ISR_TABLE(name)     __attribute__((section(".data.charlie_isr." #name)))
+#else
+#define CHARLIE_RAM_CODE
+#define CHARLIE_SLOT_CODE
+#endif
+
+// Pin list, LED matrix and register masks are generated from
+// custom_charlie_pins in platformio.ini (tools/gen_charlie_topology.py)
+#define CHARLIE_TOPOLOGY_TABLES
+#include "charlie_topology.h"
+
+#define CHARLIE_NO_LED      0xFF
+
+// PWM tick rate, independent of the core clock (see charlie_set_timebase)
+#define CHARLIE_TICK_HZ     400000
+
+// CHARLIE_HW_PWM: TIM1 counts PWM ticks and one timer period is one LED
+// slot, a channel output ends the on-time. One interrupt per slot instead of
+// one per tick. Without it TIM2 interrupts every tick (software PWM).
+#ifdef CHARLIE_HW_PWM
+#define CHARLIE_TIM         TIM1
+#define CHARLIE_TIM_PERIOD  1       // timer counts per PWM tick
+#else
+#define CHARLIE_TIM         TIM2
+#define CHARLIE_TIM_PERIOD  20
+#endif
+
+// Software PWM: core cycles the TIM2 ISR needs per interrupt, 48MHz at
+// CHARLIE_TICK_HZ. Below that it interrupts every 2nd (24MHz) or 8th (8MHz)
+// PWM tick and the levels step by as much, slots, scans and sense times
+// stay in PWM ticks (pwm_step, charlie_set_timebase).
+#define CHARLIE_TICK_CYCLES 120
+#define CHARLIE_MAX_STEP    8
+
+// Sense window polls: every interrupt, with TIM1 a short timer period
+#ifdef CHARLIE_HW_PWM
+#define CHARLIE_SENSE_POLL  4
+#else
+#define CHARLIE_SENSE_POLL  pwm_step
+#endif
 
 // Timer
 static volatile uint8_t charlie_brightness = 128;
-static volatile uint16_t current_anode_pin = 0;
-static volatile uint16_t current_cathode_pin = 0;
+static volatile uint8_t current_led = CHARLIE_NO_LED;
 static volatile uint8_t pwm_counter = 0;
+static volatile uint8_t pwm_step = 1;       // PWM ticks per TIM2 interrupt, power of two
 static volatile uint8_t led_is_on = 0;
 
-// Multiplex
-static uint32_t multiplex_bitmask[CHARLIE_BITMASK_SIZE] = {0};
+static volatile uint8_t current_level = 0;
+
+// Multiplex, front buffers are scanned by the ISR, back buffers can be
+// filled in place (e.g. by DMA) and swapped in with charlie_present_*
+static uint32_t multiplex_buffers[2][CHARLIE_BITMASK_SIZE] = {0};
+static uint8_t level_buffers[2][CHARLIE_NUM_LEDS];
+static uint32_t * volatile multiplex_bitmask = multiplex_buffers[0];
+static uint8_t * volatile led_levels = level_buffers[0];
 static uint8_t multiplex_enabled = 0;
 static uint8_t current_led_index = 0;
 static volatile uint8_t fast_pwm_mode = 0;
+static uint8_t scan_order = CHARLIE_SCAN_INDEX;
+
+// Control commands, main loop -> ISR. Single producer, single consumer:
+// only the producer writes cmd_head, only the ISR writes cmd_tail.
+static charlie_cmd cmd_ring[CHARLIE_CMD_RING_SIZE];
+static volatile uint8_t cmd_head = 0;
+static volatile uint8_t cmd_tail = 0;
+static volatile uint32_t charlie_scans = 0;
+
+// Pattern version: changes applied by the ISR plus presents, one writer each
+static volatile uint32_t pattern_changes = 0;
+static volatile uint32_t pattern_presents = 0;
+static volatile uint32_t masks_refused = 0;
+static uint32_t mask_keep[CHARLIE_BITMASK_SIZE];
+static uint8_t mask_ok = 0;
+
+// Sense window, ISR owned while sense_led is set
+static volatile uint8_t sense_led = CHARLIE_NO_LED;
+static GPIO_TypeDef *sense_port;    // timed pin, looked up when the command applies
+static uint16_t sense_pin;
+static uint32_t sense_cfg;
+static uint32_t sense_tri;
+static uint16_t sense_count;
+static volatile uint16_t sense_ticks;
+static volatile uint8_t sense_seq = 0;
+static uint8_t sense_read_seq = 0;
+
+// Orders the ring slot against the index store, one core so no fence needed
+#define CHARLIE_BARRIER()   __asm__ volatile("" ::: "memory")
+
+// Spinning on the ring, nothing to do on the chip: the ISR preempts
+#ifndef CHARLIE_WAIT
+#define CHARLIE_WAIT()
+#endif
 
 // --- Internal Charlie Functions ---
 
-void charlie_pin_high(uint16_t pin){
+// Single pin helpers, pin = index into charlie_pins
+void charlie_pin_high(uint8_t pin){
     GPIO_InitTypeDef cph_init = {0};
+    GPIO_TypeDef *port = charlie_ports[charlie_pins[pin].port];
 
-    cph_init.GPIO_Pin = pin;
+    cph_init.GPIO_Pin = charlie_pins[pin].pin;
     cph_init.GPIO_Mode = GPIO_Mode_Out_PP;
     cph_init.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_Init(CHARLIE_GPIO_PORT, &cph_init);
+    GPIO_Init(port, &cph_init);
 
-    GPIO_SetBits(CHARLIE_GPIO_PORT, pin);
+    GPIO_SetBits(port, charlie_pins[pin].pin);
 }
 
-void charlie_pin_low(uint16_t pin){
+void charlie_pin_low(uint8_t pin){
     GPIO_InitTypeDef cpl_init = {0};
+    GPIO_TypeDef *port = charlie_ports[charlie_pins[pin].port];
 
-    cpl_init.GPIO_Pin = pin;
+    cpl_init.GPIO_Pin = charlie_pins[pin].pin;
     cpl_init.GPIO_Mode = GPIO_Mode_Out_PP;
     cpl_init.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_Init(CHARLIE_GPIO_PORT, &cpl_init);
+    GPIO_Init(port, &cpl_init);
 
-    GPIO_ResetBits(CHARLIE_GPIO_PORT, pin);
+    GPIO_ResetBits(port, charlie_pins[pin].pin);
 }
 
-void charlie_pin_tri(uint16_t pin){
+void charlie_pin_tri(uint8_t pin){
     GPIO_InitTypeDef cpt_init = {0};
 
-    cpt_init.GPIO_Pin = pin;
+    cpt_init.GPIO_Pin = charlie_pins[pin].pin;
     cpt_init.GPIO_Mode = GPIO_Mode_IN_FLOATING;
-    GPIO_Init(CHARLIE_GPIO_PORT, &cpt_init);
+    GPIO_Init(charlie_ports[charlie_pins[pin].port], &cpt_init);
+}
+
+// Lights one LED with the precomputed register values, output level
+// is written first so the pins come up driven the right way
+CHARLIE_RAM_CODE static inline void charlie_light_led(uint8_t led_num){
+    const charlie_led_regs *regs = &charlie_led_regs_table[led_num];
+
+    for (int p = 0; p < CHARLIE_NUM_PORTS; p++){
+        GPIO_TypeDef *port = charlie_ports[p];
+
+        if (regs->bshr[p]) {
+            port->BSHR = regs->bshr[p];
+        }
+        port->CFGLR = (port->CFGLR & ~charlie_cfg_mask[p]) | regs->cfglr[p];
+    }
 }
 
 void charlie_set_fast_pwm_mode(uint8_t enable)
@@ -138,36 +171,167 @@ static inline uint8_t charlie_is_led_enabled(uint8_t led_num)
     return (multiplex_bitmask[index] & (1UL << bit)) != 0;
 }
 
-void charlie_disable_multiplex(void)
-{
-    __disable_irq();
-    multiplex_enabled = 0;
-    charlie_set_led(current_led_index, 0);
-    __enable_irq();
-}
-
 // ---
 
+// Per LED level scaled by the global brightness, 255 = brightness as is
+static inline uint8_t charlie_scale_level(uint8_t level){
+    return fx_scale8(charlie_brightness, level);
+}
+
 // Turns of all leds
-void charlie_off(){
-    for(int i = 0; i < CHARLIE_NUM_PINS; i++){
-        charlie_pin_tri(charlie_pins[i]);
+CHARLIE_RAM_CODE void charlie_off(){
+    for (int p = 0; p < CHARLIE_NUM_PORTS; p++){
+        GPIO_TypeDef *port = charlie_ports[p];
+
+        port->CFGLR = (port->CFGLR & ~charlie_cfg_mask[p]) | charlie_cfg_tri[p];
+    }
+}
+
+// Turns off the current LED. Scanning by pins only its cathode floats, the
+// anode stays high for the next LED on it; with no pin low nothing lights.
+// On more than one port the next LED would be lit port by port, so there
+// it's the plain off.
+CHARLIE_RAM_CODE static inline void charlie_release(void){
+#if CHARLIE_NUM_PORTS == 1
+    if (scan_order == CHARLIE_SCAN_PINS && current_led != CHARLIE_NO_LED) {
+        uint8_t cathode = full_charlie_matrix[current_led].cathode;
+        GPIO_TypeDef *port = charlie_ports[0];
+
+        port->CFGLR = (port->CFGLR & ~charlie_pin_cfg[cathode]) | (charlie_cfg_tri[0] & charlie_pin_cfg[cathode]);
+        led_is_on = 0;
+        return;
     }
+#endif
+    charlie_off();
+    led_is_on = 0;
+}
+
+// First frame shown by the fast boot path (CHARLIE_FAST_BOOT), flash resident.
+// Default are the five star tips, override with -DCHARLIE_BOOT_FRAME={...}
+#ifndef CHARLIE_BOOT_FRAME
+#if CHARLIE_NUM_LEDS == 42
+#define CHARLIE_BOOT_FRAME  {0x20100804, 0x00000060}   // LEDs 2, 11, 20, 29, 37, 38
+#else
+#define CHARLIE_BOOT_FRAME  {0x00000001}
+#endif
+#endif
+const uint32_t charlie_boot_frame[CHARLIE_BITMASK_SIZE] = CHARLIE_BOOT_FRAME;
+
+// Set by the startup code: SysTick count from reset to charlie_boot_light()
+uint32_t charlie_boot_cycles;
+
+// With CHARLIE_RAM_ISR the port tables live in .data, before the copy they
+// can only be read at their flash load address. The LED table is in flash.
+#ifdef CHARLIE_RAM_ISR
+extern uint8_t _data_vma[], _data_lma[];
+#define CHARLIE_BOOT_ADDR(p)    ((const void *)((const uint8_t *)(p) - _data_vma + _data_lma))
+#else
+#define CHARLIE_BOOT_ADDR(p)    ((const void *)(p))
+#endif
+
+// Called from handle_reset before .data/.bss are set up, so only registers,
+// flash constants and the stack may be touched here. Lights the first LED
+// of the boot frame statically until charlie_init() takes over.
+void charlie_boot_light(void){
+    GPIO_TypeDef * const *ports = CHARLIE_BOOT_ADDR(charlie_ports);
+    const uint32_t *cfg_mask = CHARLIE_BOOT_ADDR(charlie_cfg_mask);
+    const charlie_led_regs *regs = charlie_led_regs_table;
+
+    RCC_APB2PeriphClockCmd(CHARLIE_RCC_PERIPH, ENABLE);
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++){
+        if (charlie_boot_frame[led / 32] & (1UL << (led % 32))){
+            for (int p = 0; p < CHARLIE_NUM_PORTS; p++){
+                ports[p]->BSHR = regs[led].bshr[p];
+                ports[p]->CFGLR = (ports[p]->CFGLR & ~cfg_mask[p]) | regs[led].cfglr[p];
+            }
+            return;
+        }
+    }
+}
+
+// Timer prescaler for CHARLIE_TICK_HZ, 6 at 48MHz. The software PWM takes
+// pwm_step ticks per interrupt, so the prescaler is for CHARLIE_TICK_HZ / step.
+static uint16_t charlie_prescaler(uint32_t hclk){
+    uint8_t shift = 0;
+
+#ifndef CHARLIE_HW_PWM
+    while (hclk << shift < (uint32_t)CHARLIE_TICK_HZ * CHARLIE_TICK_CYCLES && (1U << shift) < CHARLIE_MAX_STEP) shift++;
+    pwm_step = 1U << shift;
+#endif
+
+    uint32_t div = (hclk << shift) / ((uint32_t)CHARLIE_TICK_HZ * CHARLIE_TIM_PERIOD);
+    return div ? div : 1;
+}
+
+void charlie_set_timebase(uint32_t hclk){
+    TIM_PrescalerConfig(CHARLIE_TIM, charlie_prescaler(hclk) - 1, TIM_PSCReloadMode_Update);
 }
 
+#ifdef CHARLIE_HW_PWM
+// All four channels in PWM mode 1 with the outputs off, a slot enables the
+// one on its LED in CCER. Compare values are not preloaded, the ISR writes
+// them at the start of the slot they are for.
+static void charlie_hw_init(void){
+    TIM_TimeBaseInitTypeDef charlie_tim = {0};
+    TIM_OCInitTypeDef charlie_oc = {0};
+    NVIC_InitTypeDef charlie_nvic = {0};
+
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1 | RCC_APB2Periph_AFIO, ENABLE);
+#ifdef CHARLIE_HW_REMAP
+    GPIO_PinRemapConfig(CHARLIE_HW_REMAP, ENABLE);
+#endif
+
+    charlie_tim.TIM_Period = 256 - 1;
+    charlie_tim.TIM_Prescaler = charlie_prescaler(SystemCoreClock) - 1;
+    charlie_tim.TIM_ClockDivision = TIM_CKD_DIV1;
+    charlie_tim.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseInit(TIM1, &charlie_tim);
+
+    charlie_oc.TIM_OCMode = TIM_OCMode_PWM1;
+    charlie_oc.TIM_OutputState = TIM_OutputState_Disable;
+    charlie_oc.TIM_OutputNState = TIM_OutputNState_Disable;
+    TIM_OC1Init(TIM1, &charlie_oc);
+    TIM_OC2Init(TIM1, &charlie_oc);
+    TIM_OC3Init(TIM1, &charlie_oc);
+    TIM_OC4Init(TIM1, &charlie_oc);
+    TIM_CtrlPWMOutputs(TIM1, ENABLE);
+    TIM_ITConfig(TIM1, TIM_IT_Update, ENABLE);
+
+    charlie_nvic.NVIC_IRQChannel = TIM1_UP_IRQn;
+    charlie_nvic.NVIC_IRQChannelPreemptionPriority = 1;
+    charlie_nvic.NVIC_IRQChannelSubPriority = 0;
+    charlie_nvic.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&charlie_nvic);
+    charlie_nvic.NVIC_IRQChannel = TIM1_CC_IRQn;
+    NVIC_Init(&charlie_nvic);
+
+    TIM_Cmd(TIM1, ENABLE);
+}
+#endif
+
 void charlie_init(){
+    for (int i = 0; i < CHARLIE_NUM_LEDS; i++) {
+        level_buffers[0][i] = 255;
+        level_buffers[1][i] = 255;
+    }
+    cmd_head = cmd_tail = 0;   // nothing left over from before a re-init
+
     RCC_APB2PeriphClockCmd(CHARLIE_RCC_PERIPH, ENABLE);
 
     charlie_off();
 
+#ifdef CHARLIE_HW_PWM
+    charlie_hw_init();
+#else
     TIM_TimeBaseInitTypeDef charlie_tim = {0};
     NVIC_InitTypeDef charlie_nvic = {0};
 
     RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
 
     // Set Timer
-    charlie_tim.TIM_Period = 20 - 1;
-    charlie_tim.TIM_Prescaler = 6 - 1;
+    charlie_tim.TIM_Period = CHARLIE_TIM_PERIOD - 1;
+    charlie_tim.TIM_Prescaler = charlie_prescaler(SystemCoreClock) - 1;
     charlie_tim.TIM_ClockDivision = TIM_CKD_DIV1;
     charlie_tim.TIM_CounterMode = TIM_CounterMode_Up;
     TIM_TimeBaseInit(TIM2, &charlie_tim);
@@ -181,63 +345,319 @@ void charlie_init(){
     NVIC_Init(&charlie_nvic);
 
     TIM_Cmd(TIM2, ENABLE);
+#endif
 }
 
+// --- Command ring, ISR side ---
+
+static inline void charlie_copy_pattern(const uint32_t *pattern){
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        multiplex_bitmask[i] = pattern[i];
+    }
+}
+
+static void charlie_apply(const charlie_cmd *cmd){
+    switch (cmd->type) {
+    case CHARLIE_CMD_BRIGHTNESS:
+        charlie_brightness = cmd->arg;
+        break;
+    case CHARLIE_CMD_SET_LED:
+        if (cmd->arg) multiplex_bitmask[cmd->led / 32] |= (1UL << (cmd->led % 32));
+        else multiplex_bitmask[cmd->led / 32] &= ~(1UL << (cmd->led % 32));
+        pattern_changes++;
+        break;
+    case CHARLIE_CMD_LEVEL:
+        led_levels[cmd->led] = cmd->arg;
+        break;
+    case CHARLIE_CMD_SINGLE:
+        // takes over the display, the scan would pick the next LED
+        multiplex_enabled = 0;
+        charlie_off();
+        led_is_on = 0;
+        current_led = cmd->arg ? cmd->led : CHARLIE_NO_LED;
+        pwm_counter = 0;
+        break;
+    case CHARLIE_CMD_PATTERN:
+        // a frame presented after the post is newer, it stays
+        if ((cmd->flags & CHARLIE_CMD_IF_SHOWN) && cmd->scan != pattern_presents) break;
+        charlie_copy_pattern(cmd->pattern);
+        pattern_changes++;
+        PERF_FRAME_DONE();
+        break;
+    case CHARLIE_CMD_MULTIPLEX:
+        charlie_copy_pattern(cmd->pattern);
+        pattern_changes++;
+        multiplex_enabled = 1;
+        current_led_index = 0;
+        break;
+    case CHARLIE_CMD_MULTIPLEX_OFF:
+        multiplex_enabled = 0;
+        current_led = CHARLIE_NO_LED;
+        charlie_off();
+        led_is_on = 0;
+        break;
+    case CHARLIE_CMD_MASK_KEEP:
+        mask_ok = !(cmd->flags & CHARLIE_CMD_IF_VERSION) ||
+                  cmd->scan == pattern_changes + pattern_presents;
+        for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) mask_keep[i] = cmd->pattern[i];
+        break;
+    case CHARLIE_CMD_MASK_FLIP:
+        if (!mask_ok) {
+            masks_refused++;
+            break;
+        }
+        for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+            multiplex_bitmask[i] = (multiplex_bitmask[i] & mask_keep[i]) ^ cmd->pattern[i];
+        }
+        pattern_changes++;
+        PERF_FRAME_DONE();
+        break;
+    case CHARLIE_CMD_SENSE:
+        sense_port = charlie_ports[charlie_pins[cmd->arg].port];
+        sense_pin = charlie_pins[cmd->arg].pin;
+        sense_cfg = charlie_pin_cfg[cmd->arg];
+        sense_tri = charlie_cfg_tri[charlie_pins[cmd->arg].port] & sense_cfg;
+        sense_count = 0;
+        sense_led = cmd->led;
+        break;
+    case CHARLIE_CMD_SCAN_ORDER:
+        scan_order = cmd->arg;
+        break;
+    }
+}
+
+// Applies everything that is due, in order: a command waiting for its
+// scan holds back the ones behind it
+CHARLIE_SLOT_CODE static void charlie_drain(void){
+    uint8_t tail = cmd_tail;
+
+    while (tail != cmd_head) {
+        const charlie_cmd *cmd = &cmd_ring[tail];
+
+        if ((cmd->flags & CHARLIE_CMD_AT_SCAN) && (int32_t)(charlie_scans - cmd->scan) < 0) break;
+
+        charlie_apply(cmd);
+        tail = (tail + 1) & (CHARLIE_CMD_RING_SIZE - 1);
+        CHARLIE_BARRIER();
+        cmd_tail = tail;
+    }
+}
+
+static inline void charlie_scan_done(void){
+    PERF_SCAN_DONE(pattern_presents);
+    charlie_scans++;
+    charlie_drain();
+}
+
+// Multiplex: next LED of the pattern into current_led / current_level,
+// CHARLIE_NO_LED if the pattern is empty. The ring drains at the end of a
+// scan, a MULTIPLEX_OFF or SINGLE applied there owns current_led and ends
+// the search.
+CHARLIE_SLOT_CODE static void charlie_next_led(void){
+    uint8_t found = 0;
+    uint8_t search_count = 0;
+
+    while (search_count < CHARLIE_NUM_LEDS){ // look for next led
+        uint8_t led = scan_order == CHARLIE_SCAN_PINS ? charlie_scan_order[current_led_index] : current_led_index;
+
+        if (charlie_is_led_enabled(led)){ // check bitmask
+            current_led = led;
+            current_level = charlie_scale_level(led_levels[led]);
+            found = 1;
+
+            current_led_index++;
+            if (current_led_index >= CHARLIE_NUM_LEDS) {
+                current_led_index = 0;
+                charlie_scan_done();
+            }
+
+            break;
+        }
+
+        current_led_index++;
+        if (current_led_index >= CHARLIE_NUM_LEDS) {
+            current_led_index = 0;
+            charlie_scan_done();
+            if (!multiplex_enabled) return;
+        }
+
+        search_count++;
+    }
+
+    if (!found)
+    {
+        current_led = CHARLIE_NO_LED;
+    }
+}
+
+// One poll of the sense window, the display is off. First the antiparallel
+// LED of the pair is lit, that is the reverse bias of the sensing one and
+// charges its cathode pin. The pin floats from the next poll on, the
+// photocurrent discharges it: brighter light, shorter time.
+CHARLIE_SLOT_CODE static void charlie_sense_poll(void){
+    GPIO_TypeDef *port = sense_port;
+
+    if (sense_count == 0) {
+        charlie_light_led(sense_led);
+        sense_count = 1;
+        return;
+    }
+    if (sense_count == 1) {
+        port->CFGLR = (port->CFGLR & ~sense_cfg) | sense_tri;
+        sense_count = 2;
+        return;
+    }
+
+    sense_count += CHARLIE_SENSE_POLL;
+    if ((port->INDR & sense_pin) && sense_count - 2 < CHARLIE_SENSE_MAX_TICKS) return;
+
+    charlie_off();
+    sense_ticks = sense_count - 2;
+    sense_seq++;
+    sense_led = CHARLIE_NO_LED;
+}
+
+#ifdef CHARLIE_HW_PWM
+
+#if CHARLIE_HW_FALLBACK_CH != 3
+#error "charlie_topology.h expects another compare channel for LEDs without a channel pin"
+#endif
+
+// Pins floating first, then the channel outputs off
+CHARLIE_RAM_CODE static inline void charlie_hw_off(void){
+    charlie_off();
+    TIM1->CCER = 0;
+    TIM1->DMAINTENR &= ~TIM_IT_CC4;
+    led_is_on = 0;
+}
+
+// On-time is the compare value, in PWM ticks from the start of the slot like
+// pwm_counter < level in software. The channel output goes inactive at the
+// match and turns the LED off. LEDs without a channel pin are lit with plain
+// GPIO and the CC4 interrupt ends them, unless the counter is already past.
+CHARLIE_RAM_CODE static inline void charlie_hw_light(uint8_t led_num, uint8_t level){
+    const charlie_hw_regs *regs = &charlie_hw_regs_table[led_num];
+
+    (&TIM1->CH1CVR)[regs->ch] = level;
+    TIM1->CCER = regs->ccer;
+
+    for (int p = 0; p < CHARLIE_NUM_PORTS; p++){
+        GPIO_TypeDef *port = charlie_ports[p];
+
+        if (regs->bshr[p]) {
+            port->BSHR = regs->bshr[p];
+        }
+        port->CFGLR = (port->CFGLR & ~charlie_cfg_mask[p]) | regs->cfglr[p];
+    }
+    led_is_on = 1;
+
+    if (!regs->ccer) {
+        TIM1->INTFR = (uint16_t)~TIM_IT_CC4;
+        TIM1->DMAINTENR |= TIM_IT_CC4;
+        if (TIM1->CNT >= level) charlie_hw_off();
+    }
+}
+
+// Start of an LED slot
+void TIM1_UP_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+CHARLIE_RAM_CODE void TIM1_UP_IRQHandler(void){
+    PERF_START(isr_start);
+
+    if (TIM1->INTFR & TIM_IT_Update){
+        TIM1->INTFR = (uint16_t)~TIM_IT_Update;
+        PERF_ISR_TICK();
+
+        if (sense_led != CHARLIE_NO_LED) {
+            if (led_is_on) charlie_hw_off();
+            TIM1->ATRLR = CHARLIE_SENSE_POLL - 1;
+            charlie_sense_poll();
+            PERF_END(PERF_ISR, isr_start);
+            return;
+        }
+
+        charlie_hw_off();
+        TIM1->ATRLR = fast_pwm_mode ? 64 - 1 : 256 - 1;
+
+        if (multiplex_enabled){
+            charlie_next_led();
+        } else { // PWM period = scan without multiplex
+            charlie_scans++;
+            charlie_drain();
+        }
+
+        uint8_t level = multiplex_enabled ? current_level : charlie_brightness;
+
+        USAGE_SLOT(current_led, level, fast_pwm_mode ? 64 : 256);
+
+        if (level && current_led != CHARLIE_NO_LED){
+            charlie_hw_light(current_led, level);
+        }
+    }
+
+    PERF_END(PERF_ISR, isr_start);
+}
+
+// End of the on-time of an LED without a channel pin
+void TIM1_CC_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+CHARLIE_RAM_CODE void TIM1_CC_IRQHandler(void){
+    if (TIM1->INTFR & TIM_IT_CC4){
+        TIM1->INTFR = (uint16_t)~TIM_IT_CC4;
+        PERF_ISR_TICK();
+        charlie_hw_off();
+    }
+}
+
+#else
+
+// Flag test and clear on the registers, the SDK calls would run from flash
 void TIM2_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
-void TIM2_IRQHandler(void){
-    if (TIM_GetITStatus(TIM2, TIM_IT_Update) != RESET){
-        TIM_ClearITPendingBit(TIM2, TIM_IT_Update); // clear bit
+CHARLIE_RAM_CODE void TIM2_IRQHandler(void){
+    PERF_START(isr_start);
+
+    if (TIM2->INTFR & TIM_IT_Update){
+        TIM2->INTFR = (uint16_t)~TIM_IT_Update; // clear bit
+        PERF_ISR_TICK();
+
+        // sense window, the slot carries on after it
+        if (sense_led != CHARLIE_NO_LED) {
+            if (led_is_on) {
+                charlie_off();
+                led_is_on = 0;
+            }
+            charlie_sense_poll();
+            PERF_END(PERF_ISR, isr_start);
+            return;
+        }
         
+        pwm_counter += pwm_step;
         if (fast_pwm_mode) {
-            pwm_counter++;
             if (pwm_counter >= 64) pwm_counter = 0;
-        } else {
-            pwm_counter++;  // Wraps naturally at 256
+        } else if (pwm_counter < pwm_step) {
+            pwm_counter = 0;    // wrapped at 256, from a step set mid slot too
         }
         
+        if (pwm_counter == 0 && !multiplex_enabled){ // PWM period = scan without multiplex
+            charlie_scans++;
+            charlie_drain();
+        }
+
         if (pwm_counter == 0 && multiplex_enabled){ // switch led in multi mode
-            uint8_t found = 0;
-            uint8_t search_count = 0;
-            
-            while (search_count < CHARLIE_NUM_LEDS){ // look for next led
-                if (charlie_is_led_enabled(current_led_index)){ // check bitmask
-                    if (current_led_index < CHARLIE_NUM_LEDS) {  // Bounds check for led_matrix
-                        current_anode_pin = full_charlie_matrix[current_led_index].anode;
-                        current_cathode_pin = full_charlie_matrix[current_led_index].cathode;
-                        found = 1;
-                    }
-
-                    current_led_index++;
-                    if (current_led_index >= CHARLIE_NUM_LEDS) {
-                        current_led_index = 0;
-                    }
-                
-                    break;
-                }
-
-                current_led_index++;
-                if (current_led_index >= CHARLIE_NUM_LEDS) {
-                    current_led_index = 0;
-                }
-                
-                search_count++;
-            }
-            
-            if (!found)
-            {
-                current_anode_pin = 0;
-                current_cathode_pin = 0;
-            }
-            
-            led_is_on = 0;
+            // an LED at full duty is still on, the next one may stay dark
+            if (led_is_on) charlie_release();
+            charlie_next_led();
         }
         
-        if (pwm_counter < charlie_brightness && charlie_brightness > 0)
+        uint8_t level = multiplex_enabled ? current_level : charlie_brightness;
+
+        if (pwm_counter == 0){ // slot start, the level holds for the whole period, in steps
+            USAGE_SLOT(current_led, (level + pwm_step - 1) & -pwm_step, fast_pwm_mode ? 64 : 256);
+        }
+
+        if (pwm_counter < level)
         {
-            if (!led_is_on && current_anode_pin != 0)
+            if (!led_is_on && current_led != CHARLIE_NO_LED)
             {
-                charlie_pin_high(current_anode_pin);
-                charlie_pin_low(current_cathode_pin);
+                charlie_light_led(current_led);
                 led_is_on = 1;
             }
         }
@@ -247,112 +667,239 @@ void TIM2_IRQHandler(void){
             if (led_is_on)
             {
                 /* Turn LED off (tri-state) */
-                charlie_off();
-                led_is_on = 0;
+                charlie_release();
             }
         }
     }
+
+    PERF_END(PERF_ISR, isr_start);
 }
 
+#endif /* CHARLIE_HW_PWM */
 
+// --- Command ring, producer side ---
 
-// internal, disables briefly interrupts to update led
-void charlie_light_single_on(uint16_t anode_pin, uint16_t cathode_pin){
-    __disable_irq();
-    charlie_off();
-    led_is_on = 0;
+uint8_t charlie_try_post(const charlie_cmd *cmd)
+{
+    uint8_t head = cmd_head;
+    uint8_t next = (head + 1) & (CHARLIE_CMD_RING_SIZE - 1);
 
-    current_anode_pin = anode_pin;
-    current_cathode_pin = cathode_pin;
-    pwm_counter = 0;
+    if (next == cmd_tail) return 0;
 
-    __enable_irq();
+    cmd_ring[head] = *cmd;
+    CHARLIE_BARRIER();
+    cmd_head = next;
+
+    return 1;
 }
 
-void charlie_light_single_off(){
-    __disable_irq();
-    current_anode_pin = 0;
-    current_cathode_pin = 0;
+// Waits for the ISR when the ring is full, needs the timer running
+void charlie_post(const charlie_cmd *cmd)
+{
+    while (!charlie_try_post(cmd)) CHARLIE_WAIT();
+}
 
-    charlie_off();
-    led_is_on = 0;
+void charlie_sync(void)
+{
+    while (cmd_tail != cmd_head) CHARLIE_WAIT();
+}
 
-    __enable_irq();
+uint32_t charlie_scan_count(void)
+{
+    return charlie_scans;
 }
 
-// new bitmask approach to set leds
-void charlie_set_led(uint8_t led_num, uint8_t state)
+// Both halves of a mask update straight into the ring, published with one
+// head store so the ISR never sees the first without the second
+static uint8_t charlie_try_post_masks(const charlie_masks *masks, uint8_t flags, uint32_t version)
 {
-    if (led_num >= CHARLIE_NUM_LEDS) return;
-    
-    uint8_t index = led_num / 32;
-    uint8_t bit = led_num % 32;
-    
-    __disable_irq();
-    
-    if (state) {
-        multiplex_bitmask[index] |= (1UL << bit);   // Set bit
-    } else {
-        multiplex_bitmask[index] &= ~(1UL << bit);  // Clear bit
+    uint8_t head = cmd_head;
+    uint8_t second = (head + 1) & (CHARLIE_CMD_RING_SIZE - 1);
+    uint8_t next = (head + 2) & (CHARLIE_CMD_RING_SIZE - 1);
+    uint8_t tail = cmd_tail;
+
+    if (second == tail || next == tail) return 0;
+
+    charlie_cmd *keep = &cmd_ring[head];
+    charlie_cmd *flip = &cmd_ring[second];
+
+    keep->type = CHARLIE_CMD_MASK_KEEP;
+    keep->flags = flags;
+    keep->scan = version;
+    flip->type = CHARLIE_CMD_MASK_FLIP;
+    flip->flags = 0;
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        keep->pattern[i] = ~(masks->set[i] | masks->clear[i]);
+        flip->pattern[i] = (masks->set[i] & ~masks->clear[i]) ^ masks->toggle[i];
     }
-    
-    __enable_irq();
+
+    // no bits past the last LED
+    if (CHARLIE_NUM_LEDS % 32) flip->pattern[CHARLIE_BITMASK_SIZE - 1] &= (1UL << (CHARLIE_NUM_LEDS % 32)) - 1;
+
+    CHARLIE_BARRIER();
+    cmd_head = next;
+
+    return 1;
 }
 
-void charlie_enable_multiplex(uint32_t *bitmask)
+void charlie_apply_masks(const charlie_masks *masks)
 {
-    __disable_irq();
-    
+    while (!charlie_try_post_masks(masks, 0, 0)) CHARLIE_WAIT();
+}
+
+uint8_t charlie_try_apply_masks_if(const charlie_masks *masks, uint32_t version)
+{
+    return charlie_try_post_masks(masks, CHARLIE_CMD_IF_VERSION, version);
+}
+
+uint32_t charlie_pattern_version(void)
+{
+    return pattern_changes + pattern_presents;
+}
+
+// Pattern on show, a snapshot that may be one scan behind
+void charlie_get_pattern(uint32_t *bitmask)
+{
+    const uint32_t *front = multiplex_bitmask;
+
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) bitmask[i] = front[i];
+}
+
+uint32_t charlie_masks_refused(void)
+{
+    return masks_refused;
+}
+
+static void charlie_post_simple(uint8_t type, uint8_t led, uint8_t arg)
+{
+    charlie_cmd cmd = {.type = type, .led = led, .arg = arg};
+
+    charlie_post(&cmd);
+}
+
+static void charlie_post_pattern(uint8_t type, uint8_t flags, const uint32_t *bitmask)
+{
+    charlie_cmd cmd = {.type = type, .flags = flags, .scan = pattern_presents};
+
     for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
-        multiplex_bitmask[i] = bitmask[i]; // copy to buffer
+        cmd.pattern[i] = bitmask[i];
     }
-    
-    multiplex_enabled = 1;
-    current_led_index = 0;
-    
-    __enable_irq();
+    charlie_post(&cmd);
+}
+
+void charlie_set_scan_order(uint8_t order)
+{
+    charlie_post_simple(CHARLIE_CMD_SCAN_ORDER, 0, order);
+}
+
+void charlie_disable_multiplex(void)
+{
+    charlie_post_simple(CHARLIE_CMD_MULTIPLEX_OFF, 0, 0);
 }
 
+// new bitmask approach to set leds
+void charlie_set_led(uint8_t led_num, uint8_t state)
+{
+    if (led_num >= CHARLIE_NUM_LEDS) return;
 
+    charlie_post_simple(CHARLIE_CMD_SET_LED, led_num, state);
+}
 
-void charlie_update_multiplex_pattern(uint32_t *bitmask)
+// Sensing LED anode -> cathode, charged through the one cathode -> anode
+void charlie_sense_start(uint8_t led_num)
 {
-    __disable_irq();
-    
-    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
-        multiplex_bitmask[i] = bitmask[i];
+    if (led_num >= CHARLIE_NUM_LEDS) return;
+
+    const charlie_led_config *led = &full_charlie_matrix[led_num];
+
+    for (uint8_t i = 0; i < CHARLIE_NUM_LEDS; i++) {
+        if (full_charlie_matrix[i].anode == led->cathode && full_charlie_matrix[i].cathode == led->anode) {
+            charlie_post_simple(CHARLIE_CMD_SENSE, i, led->cathode);
+            return;
+        }
     }
-    
-    __enable_irq();
+}
+
+uint8_t charlie_sense_read(uint16_t *ticks)
+{
+    uint8_t seq = sense_seq;
+
+    if (seq == sense_read_seq) return 0;
+    *ticks = sense_ticks;
+    sense_read_seq = seq;
+
+    return 1;
+}
+
+void charlie_enable_multiplex(const uint32_t *bitmask)
+{
+    charlie_post_pattern(CHARLIE_CMD_MULTIPLEX, 0, bitmask);
+}
+
+void charlie_update_multiplex_pattern(const uint32_t *bitmask)
+{
+    charlie_post_pattern(CHARLIE_CMD_PATTERN, CHARLIE_CMD_IF_SHOWN, bitmask);
+}
+
+uint32_t* charlie_pattern_back_buffer(void)
+{
+    uint32_t *front = multiplex_bitmask;
+
+    return (front == multiplex_buffers[0]) ? multiplex_buffers[1] : multiplex_buffers[0];
+}
+
+uint8_t* charlie_levels_back_buffer(void)
+{
+    uint8_t *front = led_levels;
+
+    return (front == level_buffers[0]) ? level_buffers[1] : level_buffers[0];
+}
+
+// Single word store, the ISR sees either the old or the new frame
+void charlie_present_pattern(void)
+{
+    multiplex_bitmask = charlie_pattern_back_buffer();
+    pattern_presents++;
+}
+
+void charlie_present_levels(void)
+{
+    led_levels = charlie_levels_back_buffer();
+}
+
+void charlie_set_led_level(uint8_t led_num, uint8_t level)
+{
+    if (led_num >= CHARLIE_NUM_LEDS) return;
+
+    charlie_post_simple(CHARLIE_CMD_LEVEL, led_num, level);
 }
 
 void charlie_clear_multiplex_pattern(void)
 {
-    __disable_irq();
-    
-    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
-        multiplex_bitmask[i] = 0;
-    }
-    
-    __enable_irq();
+    static const uint32_t none[CHARLIE_BITMASK_SIZE] = {0};
+
+    charlie_update_multiplex_pattern(none);
 }
 
-void charlie_set_all_multiplex_leds(void)
+static void charlie_all_pattern(uint32_t *pattern)
 {
-    __disable_irq();
-    
-    /* Set all bits */
     for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
-        multiplex_bitmask[i] = 0xFFFFFFFF;
+        pattern[i] = 0xFFFFFFFF;
     }
-    
+
     /* Clear any bits beyond CHARLIE_MAX_LEDS */
     uint8_t remainder = CHARLIE_NUM_LEDS % 32;
     if (remainder > 0) {
-        multiplex_bitmask[CHARLIE_BITMASK_SIZE - 1] = (1UL << remainder) - 1;
+        pattern[CHARLIE_BITMASK_SIZE - 1] = (1UL << remainder) - 1;
     }
-    
-    __enable_irq();
+}
+
+void charlie_set_all_multiplex_leds(void)
+{
+    uint32_t all[CHARLIE_BITMASK_SIZE];
+
+    charlie_all_pattern(all);
+    charlie_update_multiplex_pattern(all);
 }
 
 //Lights a single LED, use schematic to find led number pair (odd toplayer, even bottlayer)
@@ -360,41 +907,40 @@ void charlie_set_all_multiplex_leds(void)
 void charlie_single(uint8_t led_num, uint8_t state){
     if(led_num >= CHARLIE_NUM_LEDS) return;
 
-    if(state) {
-        charlie_light_single_on(full_charlie_matrix[led_num].anode, full_charlie_matrix[led_num].cathode);
-    } else {
-        charlie_light_single_off();
-    }
+    charlie_post_simple(CHARLIE_CMD_SINGLE, led_num, state);
 }
 
 void charlie_set_brightness(uint8_t brightness){
-    charlie_brightness = brightness;
+    charlie_post_simple(CHARLIE_CMD_BRIGHTNESS, 0, brightness);
+}
+
+void charlie_set_brightness_at(uint8_t brightness, uint32_t scan){
+    charlie_cmd cmd = {.type = CHARLIE_CMD_BRIGHTNESS, .arg = brightness,
+                       .flags = CHARLIE_CMD_AT_SCAN, .scan = scan};
+
+    charlie_post(&cmd);
+}
+
+void charlie_led_pins(uint8_t led_num, uint8_t *anode, uint8_t *cathode){
+    *anode = full_charlie_matrix[led_num].anode;
+    *cathode = full_charlie_matrix[led_num].cathode;
 }
 
 uint8_t charlie_get_brightness(){
     return charlie_brightness;
 }
 
+// Drives several charlie pins at once, masks are bitmasks of charlie pin indices
 void charlie_multi_mask(uint16_t high_mask, uint16_t low_mask, uint16_t tri_mask){
-    GPIO_InitTypeDef charlie_multi_init = {0};
-
-    if(tri_mask){
-        charlie_multi_init.GPIO_Pin = tri_mask;
-        charlie_multi_init.GPIO_Mode = GPIO_Mode_IN_FLOATING;
-        GPIO_Init(CHARLIE_GPIO_PORT, &charlie_multi_init);
-    }
-
-    if(high_mask | low_mask){
-        charlie_multi_init.GPIO_Pin = high_mask | low_mask;
-        charlie_multi_init.GPIO_Mode = GPIO_Mode_Out_PP;
-        charlie_multi_init.GPIO_Speed = GPIO_Speed_50MHz;
-        GPIO_Init(CHARLIE_GPIO_PORT, &charlie_multi_init);
-
-        if(high_mask){
-            GPIO_SetBits(CHARLIE_GPIO_PORT, high_mask);
-        }
-        if(low_mask){
-            GPIO_ResetBits(CHARLIE_GPIO_PORT, low_mask);
+    for (uint8_t pin = 0; pin < CHARLIE_NUM_PINS; pin++){
+        uint16_t bit = 1U << pin;
+
+        if (tri_mask & bit){
+            charlie_pin_tri(pin);
+        } else if (high_mask & bit){
+            charlie_pin_high(pin);
+        } else if (low_mask & bit){
+            charlie_pin_low(pin);
         }
     }
 }
@@ -414,7 +960,7 @@ void charlie_test(){
 
     charlie_off();
 
-    charlie_single(41, 1);
+    charlie_single(CHARLIE_NUM_LEDS - 1, 1);
 
     cnt = 0;
     while(cnt < 1){
@@ -434,20 +980,25 @@ void charlie_test(){
     charlie_set_brightness(30);
     charlie_set_fast_pwm_mode(1);
 
-    charlie_set_all_multiplex_leds();
-    multiplex_enabled = 1;
+    uint32_t all[CHARLIE_BITMASK_SIZE];
+    charlie_all_pattern(all);
+    charlie_enable_multiplex(all);
 
     for(volatile int i = 0; i < 500000; i++);
 
     charlie_disable_multiplex();
 
-    uint32_t pattern1[2], pattern2[2];
+    uint32_t pattern1[CHARLIE_BITMASK_SIZE], pattern2[CHARLIE_BITMASK_SIZE];
 
-    pattern1[0] = 0x55555555;
-    pattern1[1] = 0x000002AA;
-
-    pattern2[0] = 0xAAAAAAAA;
-    pattern2[1] = 0x00000155;
+    // every other led, then the rest
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        pattern1[i] = 0x55555555;
+        pattern2[i] = 0xAAAAAAAA;
+    }
+    if (CHARLIE_NUM_LEDS % 32) {
+        pattern1[CHARLIE_BITMASK_SIZE - 1] &= (1UL << (CHARLIE_NUM_LEDS % 32)) - 1;
+        pattern2[CHARLIE_BITMASK_SIZE - 1] &= (1UL << (CHARLIE_NUM_LEDS % 32)) - 1;
+    }
 
     charlie_enable_multiplex(pattern1);
 
@@ -1,17 +1,133 @@
 #ifndef LED_CHARLIE_H
 #define LED_CHARLIE_H
 #include <stdint.h>
+#include "charlie_topology.h"
+
+// Control calls (set_led, brightness, single, multiplex, pattern) don't touch
+// the display state directly: they go through a lock-free ring that the
+// display ISR drains at scan boundaries, in order. Interrupts stay enabled and
+// changes land between two LEDs, never in the middle of a scan.
+// Without multiplexing every PWM period counts as a scan.
+
+#define CHARLIE_CMD_RING_SIZE   8       // power of two, one slot stays free
+
+typedef enum {
+    CHARLIE_CMD_BRIGHTNESS = 0, // arg = brightness
+    CHARLIE_CMD_SET_LED,        // led, arg = state
+    CHARLIE_CMD_LEVEL,          // led, arg = level
+    CHARLIE_CMD_SINGLE,         // led, arg = state, ends multiplexing
+    CHARLIE_CMD_PATTERN,        // pattern
+    CHARLIE_CMD_MULTIPLEX,      // pattern, starts multiplexing from LED 0
+    CHARLIE_CMD_MULTIPLEX_OFF,
+    CHARLIE_CMD_MASK_KEEP,      // pattern = bits kept, always followed by MASK_FLIP
+    CHARLIE_CMD_MASK_FLIP,      // pattern = bits flipped, applies the pair
+    CHARLIE_CMD_SENSE,          // led = LED lit to charge, arg = pin timed
+    CHARLIE_CMD_SCAN_ORDER      // arg = CHARLIE_SCAN_*
+} charlie_cmd_type;
+
+#define CHARLIE_CMD_AT_SCAN     0x01    // flags: not before charlie_scan_count() == scan
+#define CHARLIE_CMD_IF_VERSION  0x02    // MASK_KEEP: only if charlie_pattern_version() == scan
+#define CHARLIE_CMD_IF_SHOWN    0x04    // PATTERN: dropped if charlie_present_pattern() ran
+                                        // after the post, scan = present count at the post
+
+typedef struct {
+    uint8_t type;
+    uint8_t led;
+    uint8_t arg;
+    uint8_t flags;
+    uint32_t scan;
+    uint32_t pattern[CHARLIE_BITMASK_SIZE];
+} charlie_cmd;
 
 void charlie_init(void);
 void charlie_off(void);
 void charlie_test(void);
 void charlie_set_led(uint8_t led_num, uint8_t state);
 void charlie_set_brightness(uint8_t);
+// One LED at the global brightness, multiplexing stops until it is enabled again
 void charlie_single(uint8_t led_num, uint8_t state);
 uint8_t charlie_get_brightness(void);
+void charlie_set_brightness_at(uint8_t brightness, uint32_t scan);
+
+// Pins of an LED, indices into custom_charlie_pins: anode sources, cathode sinks
+void charlie_led_pins(uint8_t led_num, uint8_t *anode, uint8_t *cathode);
+
+// Raw ring access: try_post returns 0 when full, post waits for a free
+// slot, sync waits until the ISR has applied everything
+uint8_t charlie_try_post(const charlie_cmd *cmd);
+void charlie_post(const charlie_cmd *cmd);
+void charlie_sync(void);
+uint32_t charlie_scan_count(void);
+
+// Pattern changes as whole words, any number of LEDs in one ring post of
+// fixed cost. Per bit: set, then clear, then toggle. The update is posted
+// as a MASK_KEEP / MASK_FLIP pair in one go, the ISR applies both at the
+// same scan boundary: new = (old & keep) ^ flip.
+typedef struct {
+    uint32_t set[CHARLIE_BITMASK_SIZE];
+    uint32_t clear[CHARLIE_BITMASK_SIZE];
+    uint32_t toggle[CHARLIE_BITMASK_SIZE];
+} charlie_masks;
+
+void charlie_apply_masks(const charlie_masks *masks);
 
-void charlie_enable_multiplex(uint32_t *bitmask);
-void charlie_update_multiplex_pattern(uint32_t *bitmask);
+// Compare and swap: the masks only apply if nothing else changed the
+// pattern since charlie_pattern_version() returned version, otherwise
+// charlie_masks_refused() counts one up. Returns 0 if the ring is full.
+uint8_t charlie_try_apply_masks_if(const charlie_masks *masks, uint32_t version);
+uint32_t charlie_pattern_version(void);
+void charlie_get_pattern(uint32_t *bitmask);
+uint32_t charlie_masks_refused(void);
+
+// An LED as light sensor (charlie_ambient.h). The sense window takes the
+// place of the slots after the next scan boundary: the LED is reverse
+// biased for one poll, then its cathode pin floats and the ISR counts PWM
+// ticks until the photocurrent has pulled it low. The star is dark for
+// that long, at most CHARLIE_SENSE_MAX_TICKS.
+#define CHARLIE_SENSE_MAX_TICKS 2048    // 5ms
+
+void charlie_sense_start(uint8_t led_num);
+// 1 with the discharge time of a new measurement in *ticks,
+// CHARLIE_SENSE_MAX_TICKS if the pin never went low
+uint8_t charlie_sense_read(uint16_t *ticks);
+
+void charlie_enable_multiplex(const uint32_t *bitmask);
+void charlie_disable_multiplex(void);
+void charlie_update_multiplex_pattern(const uint32_t *bitmask);
 void charlie_set_fast_pwm_mode(uint8_t enable);
 
+// Multiplex scan order, switched at a scan boundary. CHARLIE_SCAN_PINS takes
+// the LEDs in the generated charlie_scan_order, picked for the fewest pin
+// changes from one LED to the next. Software PWM then only floats the
+// cathode when an LED goes off and goes anode by anode; CHARLIE_HW_PWM
+// keeps its off and gets an order of its own (sim/star_sim --scan).
+#define CHARLIE_SCAN_INDEX      0       // LED 0, 1, 2, ...
+#define CHARLIE_SCAN_PINS       1
+
+void charlie_set_scan_order(uint8_t order);
+
+// Keeps the PWM tick rate after a core clock change (sysclk hook), needs HCLK >= 8MHz
+void charlie_set_timebase(uint32_t hclk);
+
+// Per LED brightness (0-255, scaled by charlie_set_brightness), multiplex
+// mode only. Goes through the ring into the levels shown when it applies.
+void charlie_set_led_level(uint8_t led_num, uint8_t level);
+
+// Double buffered pattern and levels for zero-copy producers: fill the
+// whole back buffer, then swap it in. Levels are one byte per LED.
+// A present takes effect at once, also from an interrupt (the stream):
+// pattern updates still in the ring when it happens are dropped, the
+// presented frame is newer. Level and LED commands apply to it.
+uint32_t* charlie_pattern_back_buffer(void);
+uint8_t* charlie_levels_back_buffer(void);
+void charlie_present_pattern(void);
+void charlie_present_levels(void);
+
+// Fast boot (CHARLIE_FAST_BOOT): the startup code lights the first LED of
+// charlie_boot_frame before the C runtime is up and stores the SysTick count
+// (HCLK cycles at the reset clock) in charlie_boot_cycles
+extern const uint32_t charlie_boot_frame[CHARLIE_BITMASK_SIZE];
+extern uint32_t charlie_boot_cycles;
+void charlie_boot_light(void);
+
 #endif /* LED_CHARLIE_H */
\ No newline at end of file
@@ -0,0 +1,129 @@
+/* Generated by tools/gen_led_layout.py from advent_star.kicad_pcb - do not edit. */
+#include "led_layout.h"
+
+const led_layout_pos led_layout[LED_LAYOUT_NUM_LEDS] = {
+    {196,  56}, // D1,2
+    {226,  58}, // D3,4
+    {255,  65}, // D5,6
+    {235,  89}, // D7,8
+    {213, 107}, // D9,10
+    {219,  76}, // D11,12
+    {186,  72}, // D13,14
+    {190, 100}, // D15,16
+    {194, 128}, // D17,18
+    {198, 157}, // D19,20
+    {204, 184}, // D21,22
+    {206, 215}, // D23,24
+    {178, 203}, // D25,26
+    {154, 188}, // D27,28
+    {185, 185}, // D29,30
+    {153, 164}, // D31,32
+    {179, 152}, // D33,34
+    {127, 176}, // D35,36
+    {101, 188}, // D37,38
+    { 77, 203}, // D39,40
+    { 49, 214}, // D41,42
+    { 52, 184}, // D43,44
+    { 58, 157}, // D45,46
+    { 70, 185}, // D47,48
+    {101, 163}, // D49,50
+    { 76, 152}, // D51,52
+    { 60, 127}, // D53,54
+    { 41, 106}, // D55,56
+    { 20,  88}, // D57,58
+    {  0,  65}, // D59,60
+    { 29,  59}, // D61,62
+    { 57,  56}, // D63,64
+    { 34,  76}, // D65,66
+    { 65, 100}, // D67,68
+    { 68,  73}, // D69,70
+    { 86,  50}, // D71,72
+    {103,  21}, // D73,74
+    {115,   0}, // D75,76
+    {140,   0}, // D77,78
+    {152,  21}, // D79,80
+    {127,  26}, // D81,82
+    {168,  49}, // D83,84
+};
+
+const uint8_t led_layout_angle[LED_LAYOUT_NUM_LEDS] = {
+    227, 235, 241, 247, 253, 240, 231, 247,   9,  22,  30,  37,
+     43,  50,  36,  45,  26,  64,  77,  84,  90,  97, 104,  91,
+     83, 101, 119, 131, 137, 142, 148, 155, 143, 136, 152, 168,
+    181, 187, 196, 202, 191, 215,
+};
+
+const uint8_t led_layout_radius[LED_LAYOUT_NUM_LEDS] = {
+    167, 211, 255, 206, 161, 185, 134, 120, 128, 156, 196, 241,
+    193, 149, 173, 107, 121, 118, 149, 193, 239, 194, 154, 172,
+    106, 121, 129, 162, 206, 254, 210, 169, 188, 119, 134, 141,
+    178, 212, 212, 178, 162, 142,
+};
+
+const uint32_t led_layout_neighbours[LED_LAYOUT_NUM_LEDS][LED_LAYOUT_WORDS] = {
+    {0x00000062, 0x00000200}, // 0: 1 5 6 41
+    {0x0000002D, 0x00000000}, // 1: 0 2 3 5
+    {0x0000000A, 0x00000000}, // 2: 1 3
+    {0x00000036, 0x00000000}, // 3: 1 2 4 5
+    {0x000001A8, 0x00000000}, // 4: 3 5 7 8
+    {0x0000005B, 0x00000000}, // 5: 0 1 3 4 6
+    {0x000000A1, 0x00000200}, // 6: 0 5 7 41
+    {0x00000150, 0x00000000}, // 7: 4 6 8
+    {0x00010290, 0x00000000}, // 8: 4 7 9 16
+    {0x00014500, 0x00000000}, // 9: 8 10 14 16
+    {0x00005A00, 0x00000000}, // 10: 9 11 12 14
+    {0x00001400, 0x00000000}, // 11: 10 12
+    {0x00006C00, 0x00000000}, // 12: 10 11 13 14
+    {0x0002D000, 0x00000000}, // 13: 12 14 15 17
+    {0x00013600, 0x00000000}, // 14: 9 10 12 13 16
+    {0x00032000, 0x00000000}, // 15: 13 16 17
+    {0x0000C300, 0x00000000}, // 16: 8 9 14 15
+    {0x0104A000, 0x00000000}, // 17: 13 15 18 24
+    {0x018A0000, 0x00000000}, // 18: 17 19 23 24
+    {0x00B40000, 0x00000000}, // 19: 18 20 21 23
+    {0x00A80000, 0x00000000}, // 20: 19 21 23
+    {0x00D80000, 0x00000000}, // 21: 19 20 22 23
+    {0x06A00000, 0x00000000}, // 22: 21 23 25 26
+    {0x027C0000, 0x00000000}, // 23: 18 19 20 21 22 25
+    {0x02060000, 0x00000000}, // 24: 17 18 25
+    {0x05C00000, 0x00000000}, // 25: 22 23 24 26
+    {0x0A400000, 0x00000002}, // 26: 22 25 27 33
+    {0x14000000, 0x00000003}, // 27: 26 28 32 33
+    {0x68000000, 0x00000001}, // 28: 27 29 30 32
+    {0x50000000, 0x00000001}, // 29: 28 30 32
+    {0xB0000000, 0x00000001}, // 30: 28 29 31 32
+    {0x40000000, 0x0000000D}, // 31: 30 32 34 35
+    {0xF8000000, 0x00000004}, // 32: 27 28 29 30 31 34
+    {0x0C000000, 0x00000004}, // 33: 26 27 34
+    {0x80000000, 0x0000000B}, // 34: 31 32 33 35
+    {0x80000000, 0x00000014}, // 35: 31 34 36
+    {0x00000000, 0x00000128}, // 36: 35 37 40
+    {0x00000000, 0x00000150}, // 37: 36 38 40
+    {0x00000000, 0x000001A0}, // 38: 37 39 40
+    {0x00000000, 0x00000340}, // 39: 38 40 41
+    {0x00000000, 0x000000F0}, // 40: 36 37 38 39
+    {0x00000041, 0x00000080}, // 41: 0 6 39
+};
+
+const led_layout_shift led_layout_shifts[LED_LAYOUT_NUM_SHIFTS] = {
+    {-41, {0x00000000, 0x00000200}},
+    {-35, {0x00000000, 0x00000200}},
+    { -8, {0x00010000, 0x00000000}},
+    { -7, {0x01010000, 0x00000002}},
+    { -6, {0x01000040, 0x00000002}},
+    { -5, {0x00804020, 0x00000001}},
+    { -4, {0x04824120, 0x00000109}},
+    { -3, {0x02800080, 0x00000105}},
+    { -2, {0x42A3D028, 0x00000305}},
+    { -1, {0xFEFD7FFE, 0x000001FD}},
+    {  1, {0xFF7EBFFF, 0x000000FE}},
+    {  2, {0x50A8F40A, 0x000000C1}},
+    {  3, {0xA0500010, 0x00000020}},
+    {  4, {0x90482412, 0x00000010}},
+    {  5, {0x08040201, 0x00000000}},
+    {  6, {0x08040001, 0x00000000}},
+    {  7, {0x04020200, 0x00000000}},
+    {  8, {0x00000100, 0x00000000}},
+    { 35, {0x00000040, 0x00000000}},
+    { 41, {0x00000001, 0x00000000}},
+};
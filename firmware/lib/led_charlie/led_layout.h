@@ -0,0 +1,33 @@
+/* Generated by tools/gen_led_layout.py from advent_star.kicad_pcb - do not edit. */
+#ifndef LED_LAYOUT_H
+#define LED_LAYOUT_H
+#include <stdint.h>
+
+#define LED_LAYOUT_NUM_LEDS         42
+#define LED_LAYOUT_WORDS            2  // bitmask words, like CHARLIE_BITMASK_SIZE
+#define LED_LAYOUT_MAX_NEIGHBOURS   6
+#define LED_LAYOUT_NUM_SHIFTS       20
+
+typedef struct {
+    uint8_t x;      // 0..255 left to right
+    uint8_t y;      // 0..255 top to bottom
+} led_layout_pos;
+
+// LED i has LED i+shift as neighbour for every bit i set in mask
+typedef struct {
+    int8_t shift;
+    uint32_t mask[LED_LAYOUT_WORDS];
+} led_layout_shift;
+
+// Physical position of every LED, indexed like the charlie matrix
+extern const led_layout_pos led_layout[LED_LAYOUT_NUM_LEDS];
+// Angle around the star centre (0..255 = full turn, 0 = right, clockwise)
+extern const uint8_t led_layout_angle[LED_LAYOUT_NUM_LEDS];
+// Distance from the star centre (0..255 = outermost LED)
+extern const uint8_t led_layout_radius[LED_LAYOUT_NUM_LEDS];
+// Physical neighbours of every LED as a bitmask
+extern const uint32_t led_layout_neighbours[LED_LAYOUT_NUM_LEDS][LED_LAYOUT_WORDS];
+// The same graph as shifted copies of the pattern, sorted by shift
+extern const led_layout_shift led_layout_shifts[LED_LAYOUT_NUM_SHIFTS];
+
+#endif /* LED_LAYOUT_H */
@@ -0,0 +1,91 @@
+#include "transition.h"
+#include "animations.h"
+#include "led_layout.h"
+
+// Only for the pin list led_layout is of, see animations.h
+#if ANIM_LAYOUT
+
+#define TRANS_DONE      0x10000UL   // progress 1.0 in Q16
+
+typedef struct {
+    comp_frame_fn from;
+    comp_frame_fn to;
+    uint8_t type;
+    uint8_t seed;           // dissolve order / fade dither phase
+    uint32_t progress;      // Q16, 0..TRANS_DONE
+    uint32_t step;          // Q16 per frame
+} TransState;
+
+static TransState trans_state = {0};
+static uint32_t trans_pattern[CHARLIE_BITMASK_SIZE] = {0};
+
+void trans_start(comp_frame_fn from, comp_frame_fn to, trans_type type, uint16_t frames){
+    trans_state.from = from;
+    trans_state.to = to;
+    trans_state.type = type;
+    trans_state.seed = (uint8_t)(trans_state.seed * 5 + 71);  // new order every run
+    trans_state.progress = 0;
+
+    // only divide in the whole transition
+    // nothing to blend without both, the active path calls them unchecked
+    if (type == TRANS_CUT || frames == 0 || !from || !to) {
+        trans_state.progress = TRANS_DONE;
+        trans_state.step = TRANS_DONE;
+    } else {
+        trans_state.step = (TRANS_DONE + frames - 1) / frames;
+    }
+}
+
+uint8_t trans_is_active(void){
+    return trans_state.progress < TRANS_DONE;
+}
+
+// Threshold per LED, an LED shows the incoming animation once progress
+// passes it. i * 37 is a permutation of 0..255, so keys never collide.
+static inline uint8_t trans_key(uint8_t led){
+    switch (trans_state.type) {
+        case TRANS_WIPE_X:      return led_layout[led].x;
+        case TRANS_WIPE_Y:      return led_layout[led].y;
+        case TRANS_WIPE_RADIAL: return led_layout_radius[led];
+        default:                return (uint8_t)(led * 37) ^ trans_state.seed;
+    }
+}
+
+uint32_t* trans_next_frame(void){
+    if (!trans_is_active()) {
+        return trans_state.to ? trans_state.to() : 0;
+    }
+
+    uint32_t *from = trans_state.from();
+    uint32_t *to = trans_state.to();
+
+    trans_state.progress += trans_state.step;
+    if (trans_state.progress > TRANS_DONE) trans_state.progress = TRANS_DONE;
+
+    // 0..256, 256 selects every LED
+    uint16_t level = (uint16_t)(trans_state.progress >> 8);
+
+    // Fade: rotating the keys by an odd step every frame makes each LED
+    // show the incoming frame for level/256 of the time
+    if (trans_state.type == TRANS_FADE) trans_state.seed += 89;
+
+    // Fixed cost: one compare per LED, no matter how many change
+    for (int w = 0; w < CHARLIE_BITMASK_SIZE; w++) {
+        uint32_t sel = 0;
+        uint8_t base = w * 32;
+        uint8_t count = (CHARLIE_NUM_LEDS - base < 32) ? CHARLIE_NUM_LEDS - base : 32;
+
+        for (uint8_t b = 0; b < count; b++) {
+            if (trans_key(base + b) < level) sel |= (1UL << b);
+        }
+
+        // animations that finished count as blank
+        uint32_t f = from ? from[w] : 0;
+        uint32_t t = to ? to[w] : 0;
+        trans_pattern[w] = (f & ~sel) | (t & sel);
+    }
+
+    return trans_pattern;
+}
+
+#endif /* ANIM_LAYOUT */
@@ -0,0 +1,23 @@
+#ifndef TRANSITION_H
+#define TRANSITION_H
+#include <stdint.h>
+#include "compositor.h"
+
+typedef enum {
+    TRANS_CUT = 0,      // switch immediately
+    TRANS_FADE,         // crossfade by temporal dithering
+    TRANS_WIPE_X,       // left to right across the star
+    TRANS_WIPE_Y,       // top to bottom
+    TRANS_WIPE_RADIAL,  // from the centre outwards
+    TRANS_DISSOLVE      // LEDs switch over one by one in random order
+} trans_type;
+
+// Blends from one animation to the next over `frames` frames, both are
+// stepped every frame. After that trans_next_frame() just passes `to` through.
+// TRANS_CUT, 0 frames or a missing from or to is a cut: `to` right away,
+// without `to` trans_next_frame() returns 0 (no frame).
+void trans_start(comp_frame_fn from, comp_frame_fn to, trans_type type, uint16_t frames);
+uint32_t* trans_next_frame(void);
+uint8_t trans_is_active(void);
+
+#endif /* TRANSITION_H */
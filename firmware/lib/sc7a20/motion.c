@@ -0,0 +1,71 @@
+#include "motion.h"
+
+#define MOTION_Q        4           // fraction bits of the filter states
+#define MOTION_1G       1000        // mg
+
+static struct {
+    int32_t g[3];                   // gravity, Q4 mg, board axes
+    int32_t energy;                 // motion follower, Q4 mg
+    uint8_t armed;                  // shake detector waits for a peak
+} motion;
+
+static inline int32_t motion_abs(int32_t v){
+    return v < 0 ? -v : v;
+}
+
+static inline int8_t motion_clamp8(int32_t v){
+    return v > 127 ? 127 : (v < -127 ? -127 : (int8_t)v);
+}
+
+void motion_init(void){
+    motion.g[0] = 0;
+    motion.g[1] = 0;
+    motion.g[2] = MOTION_1G << MOTION_Q;
+    motion.energy = 0;
+    motion.armed = 1;
+}
+
+void motion_update(const sc7a20_sample *samples, uint8_t n, motion_state *out){
+    uint8_t shakes = 0;
+
+    for (uint8_t i = 0; i < n; i++) {
+        const sc7a20_sample *s = &samples[i];
+        int32_t a[3] = {MOTION_BOARD_X(s), MOTION_BOARD_Y(s), MOTION_BOARD_Z(s)};
+        int32_t dist = 0;
+
+        for (int k = 0; k < 3; k++) {
+            int32_t q = a[k] << MOTION_Q;
+
+            motion.g[k] += (q - motion.g[k]) >> MOTION_GRAVITY_SHIFT;
+            dist += motion_abs(q - motion.g[k]);
+        }
+
+        // dist is Q4 mg, L1 distance of the sample to gravity
+        if (motion.armed && dist > (MOTION_SHAKE_MG << MOTION_Q)) {
+            shakes++;
+            motion.armed = 0;
+        } else if (dist < (MOTION_REARM_MG << MOTION_Q)) {
+            motion.armed = 1;
+        }
+
+        motion.energy += (dist - motion.energy) >>
+                         (dist > motion.energy ? MOTION_ATTACK_SHIFT : MOTION_RELEASE_SHIFT);
+    }
+
+    // The sensor reads the reaction to gravity (up), light runs downhill
+    out->tilt_x = motion_clamp8(-motion.g[0] >> (MOTION_Q + 2));
+    out->tilt_y = motion_clamp8(-motion.g[1] >> (MOTION_Q + 2));
+
+    int32_t level = motion.energy >> (MOTION_Q + 2);
+    out->intensity = level > 255 ? 255 : (uint8_t)level;
+    out->shakes = shakes;
+}
+
+uint8_t motion_poll(motion_state *out){
+    sc7a20_sample batch[MOTION_BATCH_MAX];
+    uint8_t n = sc7a20_read(batch, MOTION_BATCH_MAX);
+
+    motion_update(batch, n, out);
+
+    return n;
+}
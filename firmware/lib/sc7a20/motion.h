@@ -0,0 +1,44 @@
+#ifndef MOTION_H
+#define MOTION_H
+#include <stdint.h>
+#include "sc7a20.h"
+
+// Tilt, shake and motion intensity from batches of accelerometer samples.
+// Integer only, shifts and adds per sample: a low pass for gravity, the
+// L1 distance to it as the motion signal, a peak detector with hysteresis
+// for shakes and an attack / release follower for the intensity.
+//
+// Board axes are the led_layout ones (x right, y down on the front).
+// U2 sits rotated by 90 degrees: sensor +x points to the board's -y,
+// sensor +y to the board's -x.
+
+#define MOTION_BOARD_X(s)       (-(s)->y)
+#define MOTION_BOARD_Y(s)       (-(s)->x)
+#define MOTION_BOARD_Z(s)       ((s)->z)
+
+#define MOTION_GRAVITY_SHIFT    4       // gravity low pass, 16 samples (160ms)
+#define MOTION_ATTACK_SHIFT     2       // intensity rises within ~4 samples
+#define MOTION_RELEASE_SHIFT    6       // and falls over ~64 (0.6s)
+#define MOTION_SHAKE_MG         700     // peak away from gravity that counts as a shake
+#define MOTION_REARM_MG         250     // below this the next peak counts again
+
+#define MOTION_BATCH_MAX        16      // samples per motion_poll, 160ms at 100Hz
+#define MOTION_POLL_MS          80      // motion_poll period of the main loop, 8 samples
+
+typedef struct {
+    int8_t tilt_x;          // downhill direction on the board, +-127 at 0.5g
+    int8_t tilt_y;
+    uint8_t intensity;      // smoothed motion, 255 at 1g away from gravity
+    uint8_t shakes;         // shake peaks in the last batch
+} motion_state;
+
+// Filters start level and at rest
+void motion_init(void);
+
+// One batch of samples (sensor axes), state after the last one
+void motion_update(const sc7a20_sample *samples, uint8_t n, motion_state *out);
+
+// Drains the sensor FIFO into motion_update, returns the samples used
+uint8_t motion_poll(motion_state *out);
+
+#endif /* MOTION_H */
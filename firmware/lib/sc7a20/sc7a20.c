@@ -0,0 +1,164 @@
+#include "sc7a20.h"
+#include <ch32v00x.h>
+
+#define SC7A20_WHO_AM_I         0x0F
+#define SC7A20_CTRL_REG1        0x20
+#define SC7A20_CTRL_REG4        0x23
+#define SC7A20_CTRL_REG5        0x24
+#define SC7A20_OUT_X_L          0x28
+#define SC7A20_FIFO_CTRL_REG    0x2E
+#define SC7A20_FIFO_SRC_REG     0x2F
+
+#define SC7A20_ID               0x11
+#define SC7A20_AUTO_INC         0x80    // register address bit: multi byte access
+
+#define SC7A20_REG1_100HZ_XYZ   0x57    // ODR 100Hz, normal power, X Y Z on
+#define SC7A20_REG4_BDU_HR      0x88    // block data update, high resolution, +-2g
+#define SC7A20_REG5_FIFO_EN     0x40
+#define SC7A20_FIFO_STREAM      0x80    // oldest samples dropped when full
+#define SC7A20_FIFO_OVRN        0x40
+#define SC7A20_FIFO_FSS         0x1F
+
+#define SC7A20_TIMEOUT          2000    // polls per bus event, ~0.5ms at 8MHz
+
+static uint8_t sc7a20_addr = 0;         // 8 bit bus address, 0 = not found
+
+static uint8_t sc7a20_wait(uint32_t event){
+    for (uint16_t n = SC7A20_TIMEOUT; n; n--) {
+        if (I2C_CheckEvent(I2C1, event)) return 1;
+    }
+
+    return 0;
+}
+
+// A failed transfer still ends with a stop, so the next one finds the bus free
+static uint8_t sc7a20_stop(uint8_t ok){
+    I2C_GenerateSTOP(I2C1, ENABLE);
+
+    return ok;
+}
+
+static uint8_t sc7a20_start(uint8_t addr, uint8_t direction, uint32_t event){
+    I2C_GenerateSTART(I2C1, ENABLE);
+    if (!sc7a20_wait(I2C_EVENT_MASTER_MODE_SELECT)) return 0;
+    I2C_Send7bitAddress(I2C1, addr, direction);
+
+    return sc7a20_wait(event);
+}
+
+static uint8_t sc7a20_write_reg(uint8_t addr, uint8_t reg, uint8_t value){
+    if (!sc7a20_start(addr, I2C_Direction_Transmitter, I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED)) {
+        return sc7a20_stop(0);
+    }
+    I2C_SendData(I2C1, reg);
+    if (!sc7a20_wait(I2C_EVENT_MASTER_BYTE_TRANSMITTED)) return sc7a20_stop(0);
+    I2C_SendData(I2C1, value);
+
+    return sc7a20_stop(sc7a20_wait(I2C_EVENT_MASTER_BYTE_TRANSMITTED));
+}
+
+// Register address, repeated start, len bytes. The last byte is NACKed.
+static uint8_t sc7a20_read_regs(uint8_t addr, uint8_t reg, uint8_t *out, uint16_t len){
+    if (!sc7a20_start(addr, I2C_Direction_Transmitter, I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED)) {
+        return sc7a20_stop(0);
+    }
+    I2C_SendData(I2C1, len > 1 ? reg | SC7A20_AUTO_INC : reg);
+    if (!sc7a20_wait(I2C_EVENT_MASTER_BYTE_TRANSMITTED)) return sc7a20_stop(0);
+
+    if (!sc7a20_start(addr, I2C_Direction_Receiver, I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED)) {
+        return sc7a20_stop(0);
+    }
+
+    I2C_AcknowledgeConfig(I2C1, ENABLE);
+    for (uint16_t i = 0; i < len; i++) {
+        if (i == len - 1) I2C_AcknowledgeConfig(I2C1, DISABLE);
+        if (!sc7a20_wait(I2C_EVENT_MASTER_BYTE_RECEIVED)) return sc7a20_stop(0);
+        out[i] = I2C_ReceiveData(I2C1);
+    }
+
+    return sc7a20_stop(1);
+}
+
+static void sc7a20_bus_init(void){
+    I2C_InitTypeDef i2c = {0};
+
+    i2c.I2C_ClockSpeed = SC7A20_I2C_HZ;
+    i2c.I2C_Mode = I2C_Mode_I2C;
+    i2c.I2C_DutyCycle = I2C_DutyCycle_2;
+    i2c.I2C_OwnAddress1 = 0;
+    i2c.I2C_Ack = I2C_Ack_Enable;
+    i2c.I2C_AcknowledgedAddress = I2C_AcknowledgedAddress_7bit;
+    I2C_Init(I2C1, &i2c);
+}
+
+uint8_t sc7a20_init(void){
+    GPIO_InitTypeDef gpio = {0};
+    static const uint8_t addrs[] = {SC7A20_ADDR, SC7A20_ADDR_ALT};
+
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOD, ENABLE);
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_I2C1, ENABLE);
+
+    // PD0 SDA, PD1 SCL, pull-ups on the board (R2, R3)
+    gpio.GPIO_Pin = GPIO_Pin_0 | GPIO_Pin_1;
+    gpio.GPIO_Mode = GPIO_Mode_AF_OD;
+    gpio.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_Init(GPIOD, &gpio);
+
+    sc7a20_bus_init();
+    I2C_Cmd(I2C1, ENABLE);
+
+    sc7a20_addr = 0;
+    for (uint8_t i = 0; i < sizeof(addrs); i++) {
+        uint8_t id = 0;
+
+        if (sc7a20_read_regs(addrs[i] << 1, SC7A20_WHO_AM_I, &id, 1) && id == SC7A20_ID) {
+            sc7a20_addr = addrs[i] << 1;
+            break;
+        }
+    }
+    if (!sc7a20_addr) return 0;
+
+    if (!sc7a20_write_reg(sc7a20_addr, SC7A20_CTRL_REG4, SC7A20_REG4_BDU_HR) ||
+        !sc7a20_write_reg(sc7a20_addr, SC7A20_CTRL_REG5, SC7A20_REG5_FIFO_EN) ||
+        !sc7a20_write_reg(sc7a20_addr, SC7A20_FIFO_CTRL_REG, SC7A20_FIFO_STREAM) ||
+        !sc7a20_write_reg(sc7a20_addr, SC7A20_CTRL_REG1, SC7A20_REG1_100HZ_XYZ)) {
+        sc7a20_addr = 0;
+    }
+
+    return sc7a20_addr != 0;
+}
+
+// One burst for the whole FIFO: in FIFO mode the register address wraps
+// from OUT_Z_H back to OUT_X_L, every 6 bytes pop one sample
+uint8_t sc7a20_read(sc7a20_sample *out, uint8_t max){
+    uint8_t src;
+
+    if (!sc7a20_addr || !sc7a20_read_regs(sc7a20_addr, SC7A20_FIFO_SRC_REG, &src, 1)) return 0;
+
+    uint8_t n = (src & SC7A20_FIFO_OVRN) ? SC7A20_FIFO_SIZE : (src & SC7A20_FIFO_FSS);
+
+    if (n > max) n = max;
+    if (!n) return 0;
+
+    // samples are read in place: 6 bytes little endian each, the same
+    // layout as sc7a20_sample on this core
+    if (!sc7a20_read_regs(sc7a20_addr, SC7A20_OUT_X_L, (uint8_t*)out, n * sizeof(sc7a20_sample))) return 0;
+
+    // left aligned 12 bit, 1mg per LSB after the shift
+    for (uint8_t i = 0; i < n; i++) {
+        out[i].x >>= 4;
+        out[i].y >>= 4;
+        out[i].z >>= 4;
+    }
+
+    return n;
+}
+
+// I2C_Init derives the bus timing from the current HCLK
+void sc7a20_set_timebase(uint32_t hclk){
+    (void)hclk;
+
+    I2C_Cmd(I2C1, DISABLE);
+    sc7a20_bus_init();
+    I2C_Cmd(I2C1, ENABLE);
+}
@@ -0,0 +1,36 @@
+#ifndef SC7A20_H
+#define SC7A20_H
+#include <stdint.h>
+
+// SC7A20 accelerometer (U2) on I2C1, SDA PD0 / SCL PD1. Those are the
+// remapped I2C1 pins (GPIO_PartialRemap_I2C1, i2c_remap() in main.c), PD1
+// is also SWDIO, so the remap turns off SWD.
+//
+// The sensor samples into its 32 entry FIFO on its own (100Hz, 12 bit,
+// +-2g), the driver drains the FIFO in one burst read. Polled, the bus is
+// only busy while sc7a20_read runs.
+
+#define SC7A20_ADDR         0x19    // SDO left open, internal pull-up
+#define SC7A20_ADDR_ALT     0x18    // SDO to GND
+#define SC7A20_FIFO_SIZE    32
+#define SC7A20_ODR_HZ       100
+#define SC7A20_I2C_HZ       400000
+
+// Sensor axes in mg (1 mg per LSB at +-2g), see motion.h for the board axes
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} sc7a20_sample;
+
+// I2C1 up at SC7A20_I2C_HZ, sensor found on either address and started.
+// Returns 0 if nothing answers, sc7a20_read then always returns 0.
+uint8_t sc7a20_init(void);
+
+// Up to max samples out of the FIFO, oldest first. 0 on a bus error.
+uint8_t sc7a20_read(sc7a20_sample *out, uint8_t max);
+
+// Keeps the I2C clock after a core clock change (sysclk hook)
+void sc7a20_set_timebase(uint32_t hclk);
+
+#endif /* SC7A20_H */
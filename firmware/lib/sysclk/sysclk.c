@@ -0,0 +1,77 @@
+#include "sysclk.h"
+#include <ch32v00x.h>
+
+#define SYSCLK_SWS_HSI      0x00
+#define SYSCLK_SWS_PLL      0x08
+
+static uint8_t sysclk_requests[SYSCLK_NUM_USERS];
+static sysclk_level sysclk_current = SYSCLK_HIGH;
+static sysclk_hook sysclk_hooks[SYSCLK_MAX_HOOKS];
+static uint8_t sysclk_num_hooks = 0;
+static uint32_t sysclk_switch_count = 0;
+
+// Wait states go up before the clock does and down after it
+static void sysclk_switch(sysclk_level level){
+    if (level == SYSCLK_HIGH) {
+        FLASH_SetLatency(FLASH_Latency_1);
+        RCC_HCLKConfig(RCC_SYSCLK_Div1);
+        RCC_PLLCmd(ENABLE);
+        while (RCC_GetFlagStatus(RCC_FLAG_PLLRDY) == RESET);
+        RCC_SYSCLKConfig(RCC_SYSCLKSource_PLLCLK);
+        while (RCC_GetSYSCLKSource() != SYSCLK_SWS_PLL);
+    } else {
+        RCC_SYSCLKConfig(RCC_SYSCLKSource_HSI);
+        while (RCC_GetSYSCLKSource() != SYSCLK_SWS_HSI);
+        RCC_PLLCmd(DISABLE);
+        RCC_HCLKConfig(level == SYSCLK_LOW ? RCC_SYSCLK_Div3 : RCC_SYSCLK_Div1);
+        FLASH_SetLatency(FLASH_Latency_0);
+    }
+
+    SystemCoreClockUpdate();
+    sysclk_current = level;
+    sysclk_switch_count++;
+
+    for (uint8_t i = 0; i < sysclk_num_hooks; i++) {
+        sysclk_hooks[i](SystemCoreClock);
+    }
+}
+
+void sysclk_init(void){
+    for (int i = 0; i < SYSCLK_NUM_USERS; i++) {
+        sysclk_requests[i] = SYSCLK_LOW;
+    }
+    sysclk_current = SYSCLK_HIGH;
+    sysclk_num_hooks = 0;
+    sysclk_switch_count = 0;
+}
+
+void sysclk_add_hook(sysclk_hook hook){
+    if (sysclk_num_hooks < SYSCLK_MAX_HOOKS) {
+        sysclk_hooks[sysclk_num_hooks++] = hook;
+    }
+}
+
+void sysclk_request(sysclk_user user, sysclk_level level){
+    if (user >= SYSCLK_NUM_USERS || level >= SYSCLK_NUM_LEVELS) return;
+
+    sysclk_requests[user] = level;
+
+    sysclk_level want = SYSCLK_LOW;
+    for (int i = 0; i < SYSCLK_NUM_USERS; i++) {
+        if (sysclk_requests[i] > want) want = sysclk_requests[i];
+    }
+
+    if (want != sysclk_current) sysclk_switch(want);
+}
+
+sysclk_level sysclk_level_now(void){
+    return sysclk_current;
+}
+
+uint32_t sysclk_hclk(void){
+    return SystemCoreClock;
+}
+
+uint32_t sysclk_switches(void){
+    return sysclk_switch_count;
+}
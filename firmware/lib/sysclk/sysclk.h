@@ -0,0 +1,45 @@
+#ifndef SYSCLK_H
+#define SYSCLK_H
+#include <stdint.h>
+
+// Core clock follows the workload. Every user (display, animation, I2C, ...)
+// requests the level it needs, the highest request wins. Modules with a
+// timebase register a hook and reprogram their prescalers on every change,
+// so refresh rates and baud rates stay the same.
+//
+// SYSCLK_LOW is too slow for the display, only request it with the
+// multiplexing stopped. Both display drivers run at SYSCLK_MID
+// (DISPLAY_SYSCLK in main.c), the software PWM with half the levels.
+
+typedef enum {
+    SYSCLK_LOW = 0,     // 8MHz, HSI / 3, PLL off
+    SYSCLK_MID,         // 24MHz, HSI, PLL off, no flash wait state
+    SYSCLK_HIGH,        // 48MHz, HSI + PLL, 1 flash wait state
+    SYSCLK_NUM_LEVELS
+} sysclk_level;
+
+typedef enum {
+    SYSCLK_USER_DISPLAY = 0,
+    SYSCLK_USER_ANIM,
+    SYSCLK_USER_I2C,
+    SYSCLK_USER_STREAM,
+    SYSCLK_NUM_USERS
+} sysclk_user;
+
+#define SYSCLK_MAX_HOOKS    4
+
+// Called with the new HCLK after every switch
+typedef void (*sysclk_hook)(uint32_t hclk);
+
+// Starts at the clock SystemInit left (SYSCLK_HIGH), all users at SYSCLK_LOW
+void sysclk_init(void);
+void sysclk_add_hook(sysclk_hook hook);
+
+// Switches right away if the resulting level changes
+void sysclk_request(sysclk_user user, sysclk_level level);
+
+sysclk_level sysclk_level_now(void);
+uint32_t sysclk_hclk(void);
+uint32_t sysclk_switches(void);
+
+#endif /* SYSCLK_H */
@@ -0,0 +1,336 @@
+#include "uart_stream.h"
+#include "led_charlie.h"
+#include "charlie_perf.h"
+#include "charlie_usage.h"
+#include <ch32v00x.h>
+
+#define STREAM_DMA              DMA1_Channel5   // USART1_RX
+#define STREAM_DMA_IT_TC        DMA1_IT_TC5
+
+#define STREAM_PATTERN_BYTES    (CHARLIE_BITMASK_SIZE * 4)
+
+typedef enum {
+    STREAM_RX_HEADER = 0,
+    STREAM_RX_PAYLOAD,
+    STREAM_RX_WAIT_IDLE         // lost sync, wait for a gap on the line
+} stream_rx_state;
+
+static uint8_t stream_header[STREAM_HEADER_SIZE];
+static uint8_t stream_arg[4];   // payload of the small commands
+static uint8_t *stream_dst;     // where the payload in flight lands
+static volatile uint8_t stream_state = STREAM_RX_HEADER;
+static volatile uint8_t stream_current_anim = 1;
+static volatile uint8_t stream_perf_request = 0;
+static volatile uint8_t stream_usage_request = 0;
+static volatile uint8_t stream_usage_first = 0;
+static volatile uint8_t stream_brightness_request = 0;
+static volatile uint8_t stream_brightness = 0;
+static volatile uint8_t stream_masks_request = 0;
+static charlie_masks stream_masks;
+static stream_stats stream_stat = {0};
+static uint32_t stream_baud = 115200;
+
+void USART1_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+void DMA1_Channel5_IRQHandler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
+
+// Points the RX DMA at the next buffer, the only copy is the DMA itself
+static inline void stream_dma_arm(void *dst, uint16_t len){
+    STREAM_DMA->CFGR &= ~DMA_CFGR1_EN;
+    STREAM_DMA->MADDR = (uint32_t)(uintptr_t)dst;
+    STREAM_DMA->CNTR = len;
+    STREAM_DMA->CFGR |= DMA_CFGR1_EN;
+}
+
+static inline void stream_rx_header(void){
+    stream_state = STREAM_RX_HEADER;
+    stream_dma_arm(stream_header, STREAM_HEADER_SIZE);
+}
+
+static inline void stream_rx_lost(void){
+    STREAM_DMA->CFGR &= ~DMA_CFGR1_EN;
+    stream_state = STREAM_RX_WAIT_IDLE;
+}
+
+// Payload destination for a command, 0 if the length doesn't fit
+static uint8_t* stream_payload_dst(uint8_t cmd, uint8_t len){
+    switch (cmd) {
+        case STREAM_CMD_PATTERN:
+            return (len == STREAM_PATTERN_BYTES) ? (uint8_t*)charlie_pattern_back_buffer() : 0;
+        case STREAM_CMD_LEVELS:
+            return (len == CHARLIE_NUM_LEDS) ? charlie_levels_back_buffer() : 0;
+        case STREAM_CMD_BRIGHTNESS:
+        case STREAM_CMD_ANIM:
+        case STREAM_CMD_USAGE:
+            return (len == 1) ? stream_arg : 0;
+        case STREAM_CMD_MASKS:
+            // one in flight, the next would land in the masks being posted
+            return (len == sizeof(stream_masks) && !stream_masks_request) ? (uint8_t*)&stream_masks : 0;
+        default:
+            return 0;
+    }
+}
+
+// A frame payload lands in the back buffer it was given at header time.
+// If the main loop presented that buffer in the meantime (a built-in
+// animation, set_all_levels) it is on display now, and presenting again
+// would show the other buffer, a stale frame.
+static uint8_t stream_dst_is_back(uint8_t cmd){
+    switch (cmd) {
+        case STREAM_CMD_PATTERN:
+            return stream_dst == (uint8_t*)charlie_pattern_back_buffer();
+        case STREAM_CMD_LEVELS:
+            return stream_dst == charlie_levels_back_buffer();
+        default:
+            return 1;
+    }
+}
+
+static void stream_apply(uint8_t cmd){
+    switch (cmd) {
+        case STREAM_CMD_PATTERN:
+            stream_current_anim = STREAM_ANIM_LIVE;
+            charlie_present_pattern();
+            break;
+        case STREAM_CMD_LEVELS:
+            charlie_present_levels();
+            break;
+        case STREAM_CMD_BRIGHTNESS:
+            stream_brightness = stream_arg[0];
+            stream_brightness_request = 1;
+            break;
+        case STREAM_CMD_ANIM:
+            stream_current_anim = stream_arg[0];
+            break;
+        case STREAM_CMD_MASKS:
+            stream_current_anim = STREAM_ANIM_LIVE;
+            stream_masks_request = 1;
+            break;
+        case STREAM_CMD_PERF:
+            stream_perf_request = 1;
+            break;
+        case STREAM_CMD_USAGE:
+            stream_usage_first = stream_arg[0];
+            stream_usage_request = 1;
+            break;
+    }
+
+    stream_stat.packets++;
+}
+
+void DMA1_Channel5_IRQHandler(void){
+    if (DMA_GetITStatus(STREAM_DMA_IT_TC) == RESET) return;
+    DMA_ClearITPendingBit(STREAM_DMA_IT_TC);
+
+    uint8_t cmd = stream_header[1];
+    uint8_t len = stream_header[2];
+
+    if (stream_state == STREAM_RX_HEADER) {
+        if (stream_header[0] != STREAM_SYNC) {
+            stream_stat.bad_header++;
+            stream_rx_lost();
+            return;
+        }
+
+        if (len == 0) {
+            if (cmd == STREAM_CMD_PERF) stream_apply(cmd);
+            else stream_stat.bad_header++;
+            stream_rx_header();
+            return;
+        }
+
+        uint8_t *dst = stream_payload_dst(cmd, len);
+        if (!dst) {
+            stream_stat.bad_header++;
+            stream_rx_lost();
+            return;
+        }
+
+        stream_state = STREAM_RX_PAYLOAD;
+        stream_dst = dst;
+        stream_dma_arm(dst, len);
+    } else if (stream_state == STREAM_RX_PAYLOAD) {
+        // checksum over the payload where it landed, nothing is shown before this passes
+        if (!stream_dst_is_back(cmd)) {
+            stream_stat.dropped++;
+        } else {
+            uint8_t sum = 0;
+
+            for (uint8_t i = 0; i < len; i++) sum += stream_dst[i];
+
+            if (sum == stream_header[3]) stream_apply(cmd);
+            else stream_stat.bad_sum++;
+        }
+
+        stream_rx_header();
+    }
+}
+
+// Idle line after a partial packet: drop it and start over with a header
+void USART1_IRQHandler(void){
+    if (USART_GetITStatus(USART1, USART_IT_IDLE) == RESET) return;
+
+    USART_ReceiveData(USART1);  // STATR then DATAR read clears IDLE
+
+    if (stream_state != STREAM_RX_HEADER || STREAM_DMA->CNTR != STREAM_HEADER_SIZE) {
+        stream_stat.resyncs++;
+        stream_rx_header();
+    }
+}
+
+void stream_init(uint32_t baudrate){
+    GPIO_InitTypeDef stream_gpio = {0};
+    USART_InitTypeDef stream_usart = {0};
+    DMA_InitTypeDef stream_dma = {0};
+    NVIC_InitTypeDef stream_nvic = {0};
+
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOD | RCC_APB2Periph_USART1, ENABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+    // PD5 TX, PD6 RX
+    stream_gpio.GPIO_Pin = GPIO_Pin_5;
+    stream_gpio.GPIO_Mode = GPIO_Mode_AF_PP;
+    stream_gpio.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_Init(GPIOD, &stream_gpio);
+
+    stream_gpio.GPIO_Pin = GPIO_Pin_6;
+    stream_gpio.GPIO_Mode = GPIO_Mode_IPU;
+    GPIO_Init(GPIOD, &stream_gpio);
+
+    stream_baud = baudrate;
+    stream_usart.USART_BaudRate = baudrate;
+    stream_usart.USART_WordLength = USART_WordLength_8b;
+    stream_usart.USART_StopBits = USART_StopBits_1;
+    stream_usart.USART_Parity = USART_Parity_No;
+    stream_usart.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+    stream_usart.USART_Mode = USART_Mode_Tx | USART_Mode_Rx;
+    USART_Init(USART1, &stream_usart);
+
+    stream_dma.DMA_PeripheralBaseAddr = (uint32_t)(uintptr_t)&USART1->DATAR;
+    stream_dma.DMA_MemoryBaseAddr = (uint32_t)(uintptr_t)stream_header;
+    stream_dma.DMA_DIR = DMA_DIR_PeripheralSRC;
+    stream_dma.DMA_BufferSize = STREAM_HEADER_SIZE;
+    stream_dma.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    stream_dma.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    stream_dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    stream_dma.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    stream_dma.DMA_Mode = DMA_Mode_Normal;
+    stream_dma.DMA_Priority = DMA_Priority_VeryHigh;
+    stream_dma.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(STREAM_DMA, &stream_dma);
+    DMA_ITConfig(STREAM_DMA, DMA_IT_TC, ENABLE);
+
+    // Below the display timer, a late packet is better than a flicker
+    stream_nvic.NVIC_IRQChannel = DMA1_Channel5_IRQn;
+    stream_nvic.NVIC_IRQChannelPreemptionPriority = 2;
+    stream_nvic.NVIC_IRQChannelSubPriority = 0;
+    stream_nvic.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&stream_nvic);
+
+    stream_nvic.NVIC_IRQChannel = USART1_IRQn;
+    stream_nvic.NVIC_IRQChannelSubPriority = 1;
+    NVIC_Init(&stream_nvic);
+
+    USART_ITConfig(USART1, USART_IT_IDLE, ENABLE);
+    USART_DMACmd(USART1, USART_DMAReq_Rx, ENABLE);
+    USART_Cmd(USART1, ENABLE);
+
+    stream_rx_header();
+}
+
+// BRR holds PCLK / baud (mantissa and 1/16 fraction), PCLK = HCLK here
+void stream_set_timebase(uint32_t hclk){
+    USART1->BRR = (uint16_t)((hclk + stream_baud / 2) / stream_baud);
+}
+
+uint8_t stream_anim(void){
+    return stream_current_anim;
+}
+
+void stream_set_anim(uint8_t anim){
+    stream_current_anim = anim;
+}
+
+void stream_get_stats(stream_stats *out){
+    __disable_irq();
+    *out = stream_stat;
+    __enable_irq();
+}
+
+static void stream_send(const uint8_t *data, uint16_t len){
+    for (uint16_t i = 0; i < len; i++) {
+        while (USART_GetFlagStatus(USART1, USART_FLAG_TXE) == RESET);
+        USART_SendData(USART1, data[i]);
+    }
+}
+
+// Replies use the same framing as the requests
+static void stream_reply(uint8_t cmd, const void *payload, uint8_t len){
+    const uint8_t *p = payload;
+    uint8_t header[STREAM_HEADER_SIZE] = {STREAM_SYNC, cmd, len, 0};
+
+    for (uint8_t i = 0; i < len; i++) header[3] += p[i];
+
+    stream_send(header, STREAM_HEADER_SIZE);
+    stream_send(p, len);
+}
+
+// One page of the usage counters from first on, a reset answers with an
+// empty page
+static void stream_usage_reply(uint8_t first){
+#ifdef CHARLIE_USAGE
+    static usage_data d;
+    static stream_usage_page page;
+    uint8_t count = 0;
+
+    if (first == STREAM_USAGE_RESET) {
+        usage_reset();
+        first = 0;
+    } else if (first < CHARLIE_NUM_LEDS) {
+        count = CHARLIE_NUM_LEDS - first;
+        if (count > STREAM_USAGE_PAGE_LEDS) count = STREAM_USAGE_PAGE_LEDS;
+    }
+
+    usage_snapshot(&d);
+    page.ticks = d.ticks;
+    page.slots = d.slots;
+    page.first = first;
+    page.count = count;
+    page.num_leds = CHARLIE_NUM_LEDS;
+    for (uint8_t i = 0; i < count; i++) page.on[i] = d.on[first + i];
+
+    stream_reply(STREAM_CMD_USAGE, &page, sizeof(page) - (STREAM_USAGE_PAGE_LEDS - count) * 4);
+#else
+    (void)first;
+    stream_reply(STREAM_CMD_USAGE, 0, 0);
+#endif
+}
+
+void stream_poll(void){
+    // The driver's command ring has a single producer, the main loop
+    if (stream_brightness_request) {
+        stream_brightness_request = 0;
+        charlie_set_brightness(stream_brightness);
+    }
+
+    if (stream_masks_request) {
+        charlie_apply_masks(&stream_masks);
+        stream_masks_request = 0;
+    }
+
+    if (stream_usage_request) {
+        stream_usage_request = 0;
+        stream_usage_reply(stream_usage_first);
+    }
+
+    if (!stream_perf_request) return;
+    stream_perf_request = 0;
+
+#ifdef CHARLIE_PERF
+    perf_data d;
+
+    perf_snapshot(&d);
+    stream_reply(STREAM_CMD_PERF, &d, sizeof(d));
+#else
+    stream_reply(STREAM_CMD_PERF, 0, 0);
+#endif
+}
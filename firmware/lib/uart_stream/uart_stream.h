@@ -0,0 +1,68 @@
+#ifndef UART_STREAM_H
+#define UART_STREAM_H
+#include <stdint.h>
+
+// Live frames from a host over USART1 (PD5 TX, PD6 RX), see tools/star_stream.py
+//
+// Packet: SYNC cmd len sum payload[len]
+//   sum = 8 bit sum of the payload bytes
+//
+// RX runs on DMA1 channel 5 in two stages, header then payload. The
+// payload goes straight into the driver's back buffer and is swapped in
+// once the checksum matches, unless the main loop has presented that
+// buffer meanwhile (stream_stats.dropped). An idle line resyncs the receiver.
+
+#define STREAM_SYNC             0xA5
+#define STREAM_HEADER_SIZE      4
+
+typedef enum {
+    STREAM_CMD_PATTERN = 0x01,  // CHARLIE_BITMASK_SIZE little endian words
+    STREAM_CMD_LEVELS = 0x02,   // CHARLIE_NUM_LEDS bytes, per LED brightness
+    STREAM_CMD_BRIGHTNESS = 0x03, // 1 byte global brightness
+    STREAM_CMD_ANIM = 0x04,     // 1 byte animation id, see stream_anim()
+    STREAM_CMD_PERF = 0x05,     // no payload, replies with perf_data (CHARLIE_PERF builds)
+    STREAM_CMD_USAGE = 0x06,    // 1 byte first LED, replies with a stream_usage_page
+                                // (CHARLIE_USAGE builds), STREAM_USAGE_RESET clears the counters
+    STREAM_CMD_MASKS = 0x07     // charlie_masks, set/clear/toggle words on the live pattern
+} stream_cmd;
+
+#define STREAM_USAGE_RESET      0xFF
+#define STREAM_USAGE_PAGE_LEDS  60  // counters per reply, the length is one byte
+
+// Reply to STREAM_CMD_USAGE, only count entries of on[] are sent
+typedef struct {
+    uint32_t ticks;
+    uint32_t slots;
+    uint8_t first;
+    uint8_t count;
+    uint8_t num_leds;
+    uint8_t reserved;
+    uint32_t on[STREAM_USAGE_PAGE_LEDS];
+} stream_usage_page;
+
+// Animation ids, anything above is up to the application
+#define STREAM_ANIM_LIVE        0   // frames only come from the host
+
+typedef struct {
+    uint32_t packets;
+    uint32_t bad_sum;
+    uint32_t bad_header;
+    uint32_t resyncs;
+    uint32_t dropped;   // frames whose buffer the main loop presented while they came in
+} stream_stats;
+
+void stream_init(uint32_t baudrate);
+
+// Keeps the baud rate after a core clock change (sysclk hook). A byte on
+// the line during the switch can be lost, the idle resync recovers.
+void stream_set_timebase(uint32_t hclk);
+
+// Requested animation, a pattern packet switches to STREAM_ANIM_LIVE
+uint8_t stream_anim(void);
+void stream_set_anim(uint8_t anim);
+
+// Main loop part: applies the brightness and mask commands, sends pending replies
+void stream_poll(void);
+void stream_get_stats(stream_stats *out);
+
+#endif /* UART_STREAM_H */
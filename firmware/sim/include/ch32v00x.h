@@ -0,0 +1,384 @@
+/* Host stand-in for the WCH ch32v00x.h, just enough of the SDK for the
+ * led_charlie library. Peripherals are plain structs in host memory,
+ * sim_hw.c implements the SDK calls on top of them. */
+#ifndef __CH32V00x_H
+#define __CH32V00x_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The firmware uses __attribute__((interrupt("WCH-Interrupt-fast"))),
+// which means something else on the host. ISRs are plain calls here.
+#define interrupt(x)    unused
+
+// The driver spins on its command ring while the ISR catches up, here the
+// ISR may be a thread on the same core (sim_ring.c)
+#include <sched.h>
+#define CHARLIE_WAIT()  sched_yield()
+
+#define __IO volatile
+
+typedef enum {RESET = 0, SET = !RESET} FlagStatus, ITStatus;
+typedef enum {DISABLE = 0, ENABLE = !DISABLE} FunctionalState;
+typedef enum {ERROR = 0, SUCCESS = !ERROR} ErrorStatus;
+
+typedef struct {
+    __IO uint32_t CFGLR;
+    __IO uint32_t RESERVED0;
+    __IO uint32_t INDR;
+    __IO uint32_t OUTDR;
+    __IO uint32_t BSHR;
+    __IO uint32_t BCR;
+    __IO uint32_t LCKR;
+} GPIO_TypeDef;
+
+typedef struct {
+    __IO uint16_t CTLR1;
+    uint16_t RESERVED0;
+    __IO uint16_t CTLR2;
+    uint16_t RESERVED1;
+    __IO uint16_t SMCFGR;
+    uint16_t RESERVED2;
+    __IO uint16_t DMAINTENR;
+    uint16_t RESERVED3;
+    __IO uint16_t INTFR;
+    uint16_t RESERVED4;
+    __IO uint16_t SWEVGR;
+    uint16_t RESERVED5;
+    __IO uint16_t CHCTLR1;
+    uint16_t RESERVED6;
+    __IO uint16_t CHCTLR2;
+    uint16_t RESERVED7;
+    __IO uint16_t CCER;
+    uint16_t RESERVED8;
+    __IO uint16_t CNT;
+    uint16_t RESERVED9;
+    __IO uint16_t PSC;
+    uint16_t RESERVED10;
+    __IO uint16_t ATRLR;
+    uint16_t RESERVED11;
+    __IO uint16_t RPTCR;
+    uint16_t RESERVED12;
+    __IO uint32_t CH1CVR;
+    __IO uint32_t CH2CVR;
+    __IO uint32_t CH3CVR;
+    __IO uint32_t CH4CVR;
+    __IO uint16_t BDTR;
+    uint16_t RESERVED13;
+    __IO uint16_t DMACFGR;
+    uint16_t RESERVED14;
+    __IO uint16_t DMAADR;
+    uint16_t RESERVED15;
+} TIM_TypeDef;
+
+typedef struct {
+    __IO uint32_t CTLR;
+    __IO uint32_t SR;
+    __IO uint32_t CNT;
+    uint32_t RESERVED0;
+    __IO uint32_t CMP;
+    uint32_t RESERVED1;
+} SysTick_Type;
+
+typedef struct {
+    __IO uint16_t STATR;
+    uint16_t RESERVED0;
+    __IO uint16_t DATAR;
+    uint16_t RESERVED1;
+    __IO uint16_t BRR;
+    uint16_t RESERVED2;
+    __IO uint16_t CTLR1;
+    uint16_t RESERVED3;
+    __IO uint16_t CTLR2;
+    uint16_t RESERVED4;
+    __IO uint16_t CTLR3;
+    uint16_t RESERVED5;
+    __IO uint16_t GPR;
+    uint16_t RESERVED6;
+} USART_TypeDef;
+
+typedef struct {
+    __IO uint32_t CFGR;
+    __IO uint32_t CNTR;
+    __IO uint32_t PADDR;
+    __IO uint32_t MADDR;    // sim is linked -no-pie, static buffers fit
+} DMA_Channel_TypeDef;
+
+typedef struct {
+    __IO uint32_t INTFR;
+    __IO uint32_t INTFCR;
+} DMA_TypeDef;
+
+typedef struct {
+    __IO uint16_t CTLR1;
+    uint16_t RESERVED0;
+    __IO uint16_t CTLR2;
+    uint16_t RESERVED1;
+    __IO uint16_t OADDR1;
+    uint16_t RESERVED2;
+    __IO uint16_t OADDR2;
+    uint16_t RESERVED3;
+    __IO uint16_t DATAR;
+    uint16_t RESERVED4;
+    __IO uint16_t STAR1;
+    uint16_t RESERVED5;
+    __IO uint16_t STAR2;
+    uint16_t RESERVED6;
+    __IO uint16_t CKCFGR;
+    uint16_t RESERVED7;
+} I2C_TypeDef;
+
+extern GPIO_TypeDef sim_gpioa, sim_gpioc, sim_gpiod;
+extern USART_TypeDef sim_usart1;
+extern DMA_TypeDef sim_dma1;
+extern DMA_Channel_TypeDef sim_dma1_channel5;
+extern TIM_TypeDef sim_tim1, sim_tim2;
+extern I2C_TypeDef sim_i2c1;
+SysTick_Type *sim_systick(void);
+
+#define GPIOA       (&sim_gpioa)
+#define GPIOC       (&sim_gpioc)
+#define GPIOD       (&sim_gpiod)
+#define TIM1        (&sim_tim1)
+#define TIM2        (&sim_tim2)
+#define SysTick     (sim_systick())
+#define USART1      (&sim_usart1)
+#define I2C1        (&sim_i2c1)
+#define DMA1        (&sim_dma1)
+#define DMA1_Channel5 (&sim_dma1_channel5)
+
+extern uint32_t SystemCoreClock;
+
+#define GPIO_Pin_0      ((uint16_t)0x0001)
+#define GPIO_Pin_1      ((uint16_t)0x0002)
+#define GPIO_Pin_2      ((uint16_t)0x0004)
+#define GPIO_Pin_3      ((uint16_t)0x0008)
+#define GPIO_Pin_4      ((uint16_t)0x0010)
+#define GPIO_Pin_5      ((uint16_t)0x0020)
+#define GPIO_Pin_6      ((uint16_t)0x0040)
+#define GPIO_Pin_7      ((uint16_t)0x0080)
+#define GPIO_Pin_All    ((uint16_t)0x00FF)
+
+typedef enum {
+    GPIO_Speed_10MHz = 1,
+    GPIO_Speed_2MHz,
+    GPIO_Speed_50MHz
+} GPIOSpeed_TypeDef;
+
+typedef enum {
+    GPIO_Mode_AIN = 0x0,
+    GPIO_Mode_IN_FLOATING = 0x04,
+    GPIO_Mode_IPD = 0x28,
+    GPIO_Mode_IPU = 0x48,
+    GPIO_Mode_Out_OD = 0x14,
+    GPIO_Mode_Out_PP = 0x10,
+    GPIO_Mode_AF_OD = 0x1C,
+    GPIO_Mode_AF_PP = 0x18
+} GPIOMode_TypeDef;
+
+typedef struct {
+    uint16_t GPIO_Pin;
+    GPIOSpeed_TypeDef GPIO_Speed;
+    GPIOMode_TypeDef GPIO_Mode;
+} GPIO_InitTypeDef;
+
+typedef struct {
+    uint16_t TIM_Prescaler;
+    uint16_t TIM_CounterMode;
+    uint16_t TIM_Period;
+    uint16_t TIM_ClockDivision;
+    uint8_t TIM_RepetitionCounter;
+} TIM_TimeBaseInitTypeDef;
+
+typedef struct {
+    uint16_t TIM_OCMode;
+    uint16_t TIM_OutputState;
+    uint16_t TIM_OutputNState;
+    uint16_t TIM_Pulse;
+    uint16_t TIM_OCPolarity;
+    uint16_t TIM_OCNPolarity;
+    uint16_t TIM_OCIdleState;
+    uint16_t TIM_OCNIdleState;
+} TIM_OCInitTypeDef;
+
+typedef struct {
+    uint8_t NVIC_IRQChannel;
+    uint8_t NVIC_IRQChannelPreemptionPriority;
+    uint8_t NVIC_IRQChannelSubPriority;
+    FunctionalState NVIC_IRQChannelCmd;
+} NVIC_InitTypeDef;
+
+#define RCC_APB2Periph_AFIO     ((uint32_t)0x00000001)
+#define RCC_APB2Periph_GPIOA    ((uint32_t)0x00000004)
+#define RCC_APB2Periph_GPIOC    ((uint32_t)0x00000010)
+#define RCC_APB2Periph_GPIOD    ((uint32_t)0x00000020)
+#define RCC_APB2Periph_TIM1     ((uint32_t)0x00000800)
+#define RCC_APB1Periph_TIM2     ((uint32_t)0x00000001)
+
+typedef struct {
+    uint32_t USART_BaudRate;
+    uint16_t USART_WordLength;
+    uint16_t USART_StopBits;
+    uint16_t USART_Parity;
+    uint16_t USART_Mode;
+    uint16_t USART_HardwareFlowControl;
+} USART_InitTypeDef;
+
+typedef struct {
+    uint32_t DMA_PeripheralBaseAddr;
+    uint32_t DMA_MemoryBaseAddr;
+    uint32_t DMA_DIR;
+    uint32_t DMA_BufferSize;
+    uint32_t DMA_PeripheralInc;
+    uint32_t DMA_MemoryInc;
+    uint32_t DMA_PeripheralDataSize;
+    uint32_t DMA_MemoryDataSize;
+    uint32_t DMA_Mode;
+    uint32_t DMA_Priority;
+    uint32_t DMA_M2M;
+} DMA_InitTypeDef;
+
+#define RCC_APB2Periph_USART1   ((uint32_t)0x00004000)
+#define RCC_AHBPeriph_DMA1      ((uint32_t)0x00000001)
+
+typedef struct {
+    uint32_t I2C_ClockSpeed;
+    uint16_t I2C_Mode;
+    uint16_t I2C_DutyCycle;
+    uint16_t I2C_OwnAddress1;
+    uint16_t I2C_Ack;
+    uint16_t I2C_AcknowledgedAddress;
+} I2C_InitTypeDef;
+
+#define RCC_APB1Periph_I2C1     ((uint32_t)0x00200000)
+
+#define I2C_Mode_I2C            ((uint16_t)0x0000)
+#define I2C_DutyCycle_2         ((uint16_t)0xBFFF)
+#define I2C_Ack_Enable          ((uint16_t)0x0400)
+#define I2C_AcknowledgedAddress_7bit ((uint16_t)0x4000)
+#define I2C_Direction_Transmitter ((uint8_t)0x00)
+#define I2C_Direction_Receiver  ((uint8_t)0x01)
+#define I2C_FLAG_BUSY           ((uint32_t)0x00020000)
+
+#define I2C_EVENT_MASTER_MODE_SELECT                ((uint32_t)0x00030001)
+#define I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED  ((uint32_t)0x00070082)
+#define I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED     ((uint32_t)0x00030002)
+#define I2C_EVENT_MASTER_BYTE_TRANSMITTED           ((uint32_t)0x00070084)
+#define I2C_EVENT_MASTER_BYTE_RECEIVED              ((uint32_t)0x00030040)
+
+#define USART_WordLength_8b     ((uint16_t)0x0000)
+#define USART_StopBits_1        ((uint16_t)0x0000)
+#define USART_Parity_No         ((uint16_t)0x0000)
+#define USART_Mode_Rx           ((uint16_t)0x0004)
+#define USART_Mode_Tx           ((uint16_t)0x0008)
+#define USART_HardwareFlowControl_None ((uint16_t)0x0000)
+#define USART_IT_IDLE           ((uint16_t)0x0424)
+#define USART_FLAG_TXE          ((uint16_t)0x0080)
+#define USART_FLAG_TC           ((uint16_t)0x0040)
+#define USART_FLAG_IDLE         ((uint16_t)0x0010)
+#define USART_DMAReq_Rx         ((uint16_t)0x0040)
+
+#define DMA_CFGR1_EN            ((uint16_t)0x0001)
+#define DMA_CFGR1_TCIE          ((uint16_t)0x0002)
+#define DMA_DIR_PeripheralSRC   ((uint32_t)0x00000000)
+#define DMA_PeripheralInc_Disable ((uint32_t)0x00000000)
+#define DMA_MemoryInc_Enable    ((uint32_t)0x00000080)
+#define DMA_PeripheralDataSize_Byte ((uint32_t)0x00000000)
+#define DMA_MemoryDataSize_Byte ((uint32_t)0x00000000)
+#define DMA_Mode_Normal         ((uint32_t)0x00000000)
+#define DMA_Priority_VeryHigh   ((uint32_t)0x00003000)
+#define DMA_M2M_Disable         ((uint32_t)0x00000000)
+#define DMA_IT_TC               ((uint32_t)0x00000002)
+#define DMA1_IT_TC5             ((uint32_t)0x00020000)
+
+#define USART1_IRQn             32
+#define DMA1_Channel5_IRQn      26
+
+#define TIM_CKD_DIV1            ((uint16_t)0x0000)
+#define TIM_CounterMode_Up      ((uint16_t)0x0000)
+#define TIM_IT_Update           ((uint16_t)0x0001)
+#define TIM_IT_CC4              ((uint16_t)0x0010)
+#define TIM_OCMode_PWM1         ((uint16_t)0x0060)
+#define TIM_OutputState_Disable ((uint16_t)0x0000)
+#define TIM_OutputNState_Disable ((uint16_t)0x0000)
+
+#define TIM1_UP_IRQn            35
+#define TIM1_CC_IRQn            37
+#define TIM2_IRQn               38
+#define TIM_PSCReloadMode_Update ((uint16_t)0x0000)
+
+#define RCC_SYSCLKSource_HSI    ((uint32_t)0x00000000)
+#define RCC_SYSCLKSource_PLLCLK ((uint32_t)0x00000002)
+#define RCC_SYSCLK_Div1         ((uint32_t)0x00000000)
+#define RCC_SYSCLK_Div3         ((uint32_t)0x00000020)
+#define RCC_FLAG_PLLRDY         ((uint8_t)0x39)
+#define FLASH_Latency_0         ((uint32_t)0x00000000)
+#define FLASH_Latency_1         ((uint32_t)0x00000001)
+
+#define GPIO_PartialRemap_I2C1  ((uint32_t)0x08000002)
+#define GPIO_FullRemap_I2C1     ((uint32_t)0x08400002)
+#define GPIO_PartialRemap1_TIM1 ((uint32_t)0x00160040)
+#define GPIO_FullRemap_TIM1     ((uint32_t)0x001600C0)
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_InitStruct);
+void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+uint8_t GPIO_ReadInputDataBit(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void GPIO_PinRemapConfig(uint32_t GPIO_Remap, FunctionalState NewState);
+
+void SystemInit(void);
+void SystemCoreClockUpdate(void);
+void RCC_HCLKConfig(uint32_t RCC_SYSCLK);
+void RCC_SYSCLKConfig(uint32_t RCC_SYSCLKSource);
+uint8_t RCC_GetSYSCLKSource(void);
+void RCC_PLLCmd(FunctionalState NewState);
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG);
+void FLASH_SetLatency(uint32_t FLASH_Latency);
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState);
+
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct);
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState);
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState);
+ITStatus TIM_GetITStatus(TIM_TypeDef *TIMx, uint16_t TIM_IT);
+void TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t TIM_IT);
+void TIM_PrescalerConfig(TIM_TypeDef *TIMx, uint16_t Prescaler, uint16_t TIM_PSCReloadMode);
+void TIM_OC1Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC2Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC3Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_OC4Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct);
+void TIM_CtrlPWMOutputs(TIM_TypeDef *TIMx, FunctionalState NewState);
+
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *USART_InitStruct);
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState);
+void USART_ITConfig(USART_TypeDef *USARTx, uint16_t USART_IT, FunctionalState NewState);
+ITStatus USART_GetITStatus(USART_TypeDef *USARTx, uint16_t USART_IT);
+FlagStatus USART_GetFlagStatus(USART_TypeDef *USARTx, uint16_t USART_FLAG);
+void USART_DMACmd(USART_TypeDef *USARTx, uint16_t USART_DMAReq, FunctionalState NewState);
+void USART_SendData(USART_TypeDef *USARTx, uint16_t Data);
+uint16_t USART_ReceiveData(USART_TypeDef *USARTx);
+
+void RCC_AHBPeriphClockCmd(uint32_t RCC_AHBPeriph, FunctionalState NewState);
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *DMA_InitStruct);
+void DMA_ITConfig(DMA_Channel_TypeDef *DMAy_Channelx, uint32_t DMA_IT, FunctionalState NewState);
+ITStatus DMA_GetITStatus(uint32_t DMAy_IT);
+void DMA_ClearITPendingBit(uint32_t DMAy_IT);
+
+void I2C_Init(I2C_TypeDef *I2Cx, I2C_InitTypeDef *I2C_InitStruct);
+void I2C_Cmd(I2C_TypeDef *I2Cx, FunctionalState NewState);
+void I2C_GenerateSTART(I2C_TypeDef *I2Cx, FunctionalState NewState);
+void I2C_GenerateSTOP(I2C_TypeDef *I2Cx, FunctionalState NewState);
+void I2C_AcknowledgeConfig(I2C_TypeDef *I2Cx, FunctionalState NewState);
+void I2C_Send7bitAddress(I2C_TypeDef *I2Cx, uint8_t Address, uint8_t I2C_Direction);
+void I2C_SendData(I2C_TypeDef *I2Cx, uint8_t Data);
+uint8_t I2C_ReceiveData(I2C_TypeDef *I2Cx);
+ErrorStatus I2C_CheckEvent(I2C_TypeDef *I2Cx, uint32_t I2C_EVENT);
+FlagStatus I2C_GetFlagStatus(I2C_TypeDef *I2Cx, uint32_t I2C_FLAG);
+
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct);
+
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+
+#endif /* __CH32V00x_H */
@@ -0,0 +1,13 @@
+/* Host stand-in for the WCH debug.h, printf goes to stdout */
+#ifndef __DEBUG_H
+#define __DEBUG_H
+
+#include <stdio.h>
+#include "ch32v00x.h"
+
+void Delay_Init(void);
+void Delay_Us(uint32_t n);
+void Delay_Ms(uint32_t n);
+void USART_Printf_Init(uint32_t baudrate);
+
+#endif /* __DEBUG_H */
@@ -0,0 +1,84 @@
+#ifndef SIM_H
+#define SIM_H
+#include <stdint.h>
+#include <stdio.h>
+#include <ch32v00x.h>
+
+// Host side of the simulation: peripheral state and the ISR pump
+
+// Only the display timer the driver was built for has its ISRs
+// (TIM2, or TIM1 with CHARLIE_HW_PWM)
+void TIM2_IRQHandler(void) __attribute__((weak));
+void TIM1_UP_IRQHandler(void) __attribute__((weak));
+void TIM1_CC_IRQHandler(void) __attribute__((weak));
+void USART1_IRQHandler(void);
+void DMA1_Channel5_IRQHandler(void);
+
+#define SIM_TICK_HZ     400000  // PWM ticks, CHARLIE_TICK_HZ in led_charlie.c
+
+void sim_reset(void);
+// One PWM tick of TIM2, returns 1 if it ended the timer period and the
+// update interrupt ran: every tick at 48MHz, with the software PWM step
+// below. 0 if interrupts are currently disabled.
+int sim_tim2_tick(void);
+// One PWM tick (2.5us) on whichever display timer runs, returns the
+// number of interrupts it took
+int sim_tick(void);
+// Applies pending BSHR/BCR writes to OUTDR, like the hardware does immediately
+void sim_gpio_sync(GPIO_TypeDef *port);
+uint8_t sim_irq_enabled(void);
+// ticks PWM ticks. With only TIM1 running (CHARLIE_HW_PWM) the counter
+// jumps from event to event, the pins are only right at the events.
+// Returns the number of interrupts taken.
+int sim_run(uint32_t ticks);
+// Driven level of charlie pin pin (index into charlie_pins): 1 high,
+// 0 low, -1 floating (sim_pwm.c)
+int sim_pin_level(uint8_t pin);
+// LED the charlie pins light right now, 0xFF if dark. Adds one to
+// *errors if the pins drive more than one LED (sim_pwm.c).
+uint8_t sim_lit_led(int *errors);
+// Charlie pins as photodiodes (charlie_sense_*): a pin that was driven
+// high still reads high for this many PWM ticks after it floats, then low.
+// 0 = no model (sim_reset), inputs read 0 and nothing is tracked per tick.
+extern uint32_t sim_discharge_ticks;
+// Flash wait states last set with FLASH_SetLatency
+extern uint32_t sim_flash_latency;
+// SysTick follows the host clock, for the perf counters. 0 stops it,
+// it costs more than the rest of a display interrupt.
+extern uint8_t sim_host_time;
+
+// USART1 line: one received byte (through DMA channel 5 when armed),
+// an idle line event, and where transmitted bytes go
+void sim_uart_rx(uint8_t byte);
+void sim_uart_idle(void);
+extern void (*sim_uart_tx)(uint8_t byte);
+
+// I2C1 target: start after its address (read = 1 for a read transfer),
+// write for every byte the master sends, read for every byte it clocks in
+typedef struct {
+    uint8_t addr;       // 7 bit
+    void (*start)(uint8_t read);
+    void (*write)(uint8_t byte);
+    uint8_t (*read)(void);
+} sim_i2c_target;
+
+// The one device on the bus, others NACK. Kept over sim_reset.
+extern const sim_i2c_target *sim_i2c_device;
+// Address and data bytes on the bus since sim_reset
+extern uint32_t sim_i2c_bytes;
+
+// Animations of the bench (sim_bench.c), also what --render plays.
+// frame_ms is the frame period of the firmware main loop.
+typedef struct {
+    const char *name;
+    void (*init)(void);
+    uint32_t* (*next)(void);
+    uint16_t frame_ms;
+} sim_anim;
+
+const sim_anim *sim_anim_find(const char *name);
+void sim_anim_list(FILE *out);
+// Levels of the last frame, 0 for animations without levels
+uint8_t *sim_anim_levels(void);
+
+#endif /* SIM_H */
@@ -0,0 +1,180 @@
+/* Auto-brightness from an LED as light sensor (charlie_ambient.h).
+ *
+ *   sim/star_sim --ambient       software PWM
+ *   sim/star_sim_hw --ambient    CHARLIE_HW_PWM
+ *
+ * 1. The filter on synthetic discharge times: the references map to the
+ *    ends of the scale, a step from light to dark settles without going
+ *    back, a single odd reading changes nothing and a noisy steady light
+ *    doesn't make the brightness pump.
+ * 2. The sense window of the driver against the photodiode model of the
+ *    sim (sim_discharge_ticks): the time read back matches the model, the
+ *    display is dark meanwhile except the one charge poll, and carries on
+ *    afterwards. Prints what the brightness would be for each time.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "charlie_ambient.h"
+#include "fixmath.h"
+
+#define AMBIENT_SETTLE      12          // readings from light to dark
+#define AMBIENT_NOISE       200         // readings of a noisy steady light
+#define AMBIENT_NO_LED      0xFF
+
+#ifdef CHARLIE_HW_PWM
+#define AMBIENT_POLL        4           // CHARLIE_SENSE_POLL in led_charlie.c
+#else
+#define AMBIENT_POLL        1
+#endif
+
+static int ambient_errors;
+
+static void ambient_fail(const char *what, long got, long expected){
+    if (ambient_errors++ < 10) printf("ambient: %s: %ld, expected %ld\n", what, got, expected);
+}
+
+static uint8_t ambient_settle(ambient_state *a, uint16_t ticks){
+    for (int i = 0; i < AMBIENT_SETTLE; i++) ambient_update(a, ticks);
+
+    return a->scale;
+}
+
+// Discharge time with up to +-pct percent noise
+static uint16_t ambient_noisy(uint16_t ticks, uint8_t pct){
+    int32_t delta = (int32_t)ticks * pct / 100;
+    int32_t t = ticks - delta + (int32_t)(fx_rand() % (2 * delta + 1));
+
+    return t < 1 ? 1 : (uint16_t)t;
+}
+
+static void ambient_filter_check(void){
+    ambient_state a;
+
+    for (uint8_t k = 0; k < 16; k++) {
+        if (ambient_log(1 << k) != (k ? k * 16 : 0)) ambient_fail("log of a power of two", ambient_log(1 << k), k * 16);
+    }
+    for (uint32_t t = 2; t < 0xFFFF; t++) {
+        if (ambient_log(t) < ambient_log(t - 1)) ambient_fail("log not monotonic at", t, 0);
+    }
+
+    ambient_init(&a);
+    if (ambient_settle(&a, AMBIENT_BRIGHT_TICKS) != 255) ambient_fail("bright reference", a.scale, 255);
+    if (ambient_settle(&a, AMBIENT_DARK_TICKS) != AMBIENT_MIN_SCALE) {
+        ambient_fail("dark reference", a.scale, AMBIENT_MIN_SCALE);
+    }
+    ambient_calibrate(&a, 16, 256);
+    if (ambient_settle(&a, 16) != 255) ambient_fail("bright after calibration", a.scale, 255);
+    if (ambient_settle(&a, 256) != AMBIENT_MIN_SCALE) ambient_fail("dark after calibration", a.scale, AMBIENT_MIN_SCALE);
+
+    // lights out: only ever darker, and there within AMBIENT_SETTLE readings
+    ambient_init(&a);
+    ambient_settle(&a, AMBIENT_BRIGHT_TICKS);
+    for (int i = 0, last = a.scale; i < AMBIENT_SETTLE; i++) {
+        ambient_update(&a, AMBIENT_DARK_TICKS * 2);
+        if (a.scale > last) ambient_fail("step to dark went back up", a.scale, last);
+        last = a.scale;
+    }
+    if (a.scale != AMBIENT_MIN_SCALE) ambient_fail("step to dark ends at", a.scale, AMBIENT_MIN_SCALE);
+
+    // a hand over the LED for one reading, a flash for one
+    ambient_init(&a);
+    uint8_t room = ambient_settle(&a, 64);
+
+    ambient_update(&a, AMBIENT_DARK_TICKS * 4);
+    ambient_update(&a, 64);
+    ambient_update(&a, 1);
+    ambient_update(&a, 64);
+    if (a.scale != room) ambient_fail("single readings moved the scale", a.scale, room);
+
+    // noisy steady light, after settling at most one step
+    uint32_t changes = 0;
+
+    fx_srand(0xA3B1E7);
+    ambient_init(&a);
+    ambient_settle(&a, 64);
+    for (int i = 0, last = a.scale; i < AMBIENT_NOISE; i++) {
+        ambient_update(&a, ambient_noisy(64, 30));
+        if (a.scale != last) changes++;
+        last = a.scale;
+    }
+    if (changes > 1) ambient_fail("scale changes on a noisy steady light", changes, 1);
+
+    printf("ambient filter: room light scale %u, %lu changes in %d noisy readings, %s\n", room,
+           (unsigned long)changes, AMBIENT_NOISE, ambient_errors ? "FAIL" : "ok");
+}
+
+// LED of the pair that charges the sensing one
+static uint8_t ambient_partner(uint8_t led){
+    uint8_t a, c, a2, c2;
+
+    charlie_led_pins(led, &a, &c);
+    for (uint8_t i = 0; i < CHARLIE_NUM_LEDS; i++) {
+        charlie_led_pins(i, &a2, &c2);
+        if (a2 == c && c2 == a) return i;
+    }
+
+    return AMBIENT_NO_LED;
+}
+
+static void ambient_sense_check(void){
+    static const uint16_t times[] = {2, 5, 20, 80, 300, 1000, CHARLIE_SENSE_MAX_TICKS + 500};
+    const uint8_t partner = ambient_partner(AMBIENT_LED);
+    uint32_t pattern[CHARLIE_BITMASK_SIZE] = {0};
+    ambient_state a;
+
+    for (uint8_t led = 10; led < CHARLIE_NUM_LEDS; led += 10) pattern[led / 32] |= 1UL << (led % 32);
+
+    sim_reset();
+    charlie_init();
+    charlie_set_fast_pwm_mode(1);
+    charlie_set_brightness(255);
+    charlie_enable_multiplex(pattern);
+    ambient_init(&a);
+
+    printf("discharge  read   log  light  scale\n");
+    for (unsigned i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+        uint16_t expect = times[i] > CHARLIE_SENSE_MAX_TICKS ? CHARLIE_SENSE_MAX_TICKS : times[i];
+        uint32_t charged = 0, lit = 0, ticks = 0;
+        uint16_t read;
+        int overlap = 0;
+
+        sim_discharge_ticks = times[i];
+        for (int t = 0; t < 2000; t++) sim_tick();
+
+        charlie_sense_start(AMBIENT_LED);
+        while (!charlie_sense_read(&read) && ticks < 100000) {
+            uint8_t led;
+
+            sim_tick();
+            ticks++;
+            led = sim_lit_led(&overlap);
+            if (led == partner) charged++;
+        }
+
+        // the display is back within a slot
+        for (int t = 0; t < 64 * 2 && !lit; t++) {
+            sim_tick();
+            lit = sim_lit_led(&overlap) != AMBIENT_NO_LED;
+        }
+
+        if (read < expect || read > expect + AMBIENT_POLL) ambient_fail("discharge time read back", read, expect);
+        if (charged != AMBIENT_POLL) ambient_fail("charge ticks", charged, AMBIENT_POLL);
+        if (!lit) ambient_fail("display dark after sensing", 0, 1);
+        if (overlap) ambient_fail("ticks with two LEDs driven", overlap, 0);
+
+        for (int k = 0; k < 6; k++) ambient_update(&a, read);
+        printf("%-10u %-6u %-4u %-6u %u\n", times[i], read, ambient_log(read), a.light, a.scale);
+    }
+}
+
+int sim_ambient(void){
+    ambient_errors = 0;
+    ambient_filter_check();
+    ambient_sense_check();
+    printf("ambient: %s\n", ambient_errors ? "FAIL" : "ok");
+
+    return ambient_errors != 0;
+}
@@ -0,0 +1,284 @@
+/* Golden frame and throughput bench for the animations.
+ *
+ * Every animation runs from a fixed seed, the frame stream is hashed
+ * (FNV-1a over the pattern words) and compared with golden_frames.txt.
+ * An optimisation must keep every hash, frames/s shows what it bought.
+ *
+ *   sim/star_sim --bench            compare
+ *   sim/star_sim --bench --update   rewrite golden_frames.txt
+ *
+ * Animations use fx_rand(), so hashes are the same on every host.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "animations.h"
+#include "animations_simple.h"
+#include "animations_wave.h"
+#include "animations_ca.h"
+#include "animations_motion.h"
+#include "animations_seq.h"
+#include "fixmath.h"
+#include "compositor.h"
+#include "transition.h"
+
+#define BENCH_FRAMES    5000
+#define BENCH_SEED      0x5EED
+#define BENCH_GOLDEN    "golden_frames.txt"
+
+static void bench_twinkle_init(void){
+    TIM2->CNT = BENCH_SEED;     // twinkle_init seeds from the timer
+    twinkle_init();
+}
+
+static void bench_sparkle_init(void){
+    fx_srand(BENCH_SEED);
+    anim_sparkle_init(8, 128);
+}
+
+static void bench_comp_init(void){
+    bench_twinkle_init();
+    anim_sparkle_init(10, 180);
+    comp_init();
+    comp_set_layer(0, twinkle_next_frame, COMP_OP_OR);
+    comp_set_layer(1, anim_sparkle_update, COMP_OP_XOR);
+}
+
+static void bench_trans_init(void){
+    bench_twinkle_init();
+    anim_sparkle_init(10, 180);
+    trans_start(twinkle_next_frame, anim_sparkle_update, TRANS_FADE, BENCH_FRAMES);
+}
+
+static void bench_wipe_init(void){
+    bench_twinkle_init();
+    anim_sparkle_init(10, 180);
+    trans_start(anim_sparkle_update, twinkle_next_frame, TRANS_WIPE_RADIAL, BENCH_FRAMES);
+}
+
+// Level animations: the levels are hashed after the pattern
+static uint8_t bench_levels[CHARLIE_NUM_LEDS];
+static uint8_t bench_has_levels;
+
+static void bench_breathe_init(void){
+    bench_has_levels = 1;
+    anim_breathe_init(3);
+}
+
+static uint32_t* bench_breathe_next(void){
+    return anim_breathe_update(bench_levels);
+}
+
+static void bench_wave_init(void){
+    bench_has_levels = 1;
+    anim_wave_init(4, 160);
+}
+
+static uint32_t* bench_wave_next(void){
+    return anim_wave_update(bench_levels);
+}
+
+static void bench_life_init(void){
+    bench_has_levels = 1;
+    fx_srand(BENCH_SEED);
+    anim_life_init(0, 0);
+}
+
+static uint32_t* bench_life_next(void){
+    return anim_life_update(bench_levels);
+}
+
+static void bench_fire_init(void){
+    bench_has_levels = 1;
+    fx_srand(BENCH_SEED);
+    anim_fire_init(4, 24);
+}
+
+static uint32_t* bench_fire_next(void){
+    return anim_fire_update(bench_levels);
+}
+
+static void bench_ripple_init(void){
+    bench_has_levels = 1;
+    fx_srand(BENCH_SEED);
+    anim_ripple_init(40);
+}
+
+static uint32_t* bench_ripple_next(void){
+    return anim_ripple_update(bench_levels);
+}
+
+// Motion: the tilt circles once every 256 frames, a shake every 64
+static uint16_t bench_motion_frame;
+
+static void bench_motion_init(void){
+    bench_has_levels = 1;
+    bench_motion_frame = 0;
+    fx_srand(BENCH_SEED);
+    anim_motion_init();
+}
+
+static uint32_t* bench_motion_next(void){
+    uint8_t t = (uint8_t)bench_motion_frame++;
+
+    return anim_motion_update(fx_cos8(t), fx_sin8(t), (uint8_t)(t << 2), (t & 63) == 0, bench_levels);
+}
+
+// Show: the button is pressed every 700 frames, in whatever part it is
+static uint16_t bench_show_frame;
+
+static void bench_show_init(void){
+    bench_has_levels = 1;
+    bench_show_frame = 0;
+    fx_srand(BENCH_SEED);
+    anim_show_init();
+}
+
+static uint32_t* bench_show_next(void){
+    if (++bench_show_frame % 700 == 0) anim_show_trigger();
+
+    return anim_show_update(bench_levels);
+}
+
+// Frame periods of the firmware main loop (src/main.c)
+static const sim_anim bench_anims[] = {
+    {"twinkle", bench_twinkle_init, twinkle_next_frame, 500},
+    {"sparkle", bench_sparkle_init, anim_sparkle_update, 50},
+    {"comp_or_xor", bench_comp_init, comp_next_frame, 50},
+    {"trans_fade", bench_trans_init, trans_next_frame, 50},
+    {"trans_wipe", bench_wipe_init, trans_next_frame, 50},
+    {"breathe", bench_breathe_init, bench_breathe_next, 20},
+    {"wave", bench_wave_init, bench_wave_next, 20},
+    {"life", bench_life_init, bench_life_next, 200},
+    {"fire", bench_fire_init, bench_fire_next, 100},
+    {"ripple", bench_ripple_init, bench_ripple_next, 100},
+    {"motion", bench_motion_init, bench_motion_next, 20},
+    {"show", bench_show_init, bench_show_next, 20},
+};
+
+#define BENCH_NUM_ANIMS (sizeof(bench_anims) / sizeof(bench_anims[0]))
+
+const sim_anim *sim_anim_find(const char *name){
+    for (size_t i = 0; i < BENCH_NUM_ANIMS; i++) {
+        if (!strcmp(bench_anims[i].name, name)) return &bench_anims[i];
+    }
+
+    return 0;
+}
+
+void sim_anim_list(FILE *out){
+    for (size_t i = 0; i < BENCH_NUM_ANIMS; i++) fprintf(out, " %s", bench_anims[i].name);
+    fprintf(out, "\n");
+}
+
+uint8_t *sim_anim_levels(void){
+    return bench_has_levels ? bench_levels : 0;
+}
+
+static uint32_t bench_fnv(uint32_t h, const uint32_t *words){
+    for (int w = 0; w < CHARLIE_BITMASK_SIZE; w++) {
+        for (int b = 0; b < 4; b++) {
+            h ^= (words[w] >> (b * 8)) & 0xFF;
+            h *= 16777619u;
+        }
+    }
+    return h;
+}
+
+static double bench_seconds(void){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t bench_hash(const sim_anim *a){
+    static const uint32_t blank[CHARLIE_BITMASK_SIZE] = {0};
+    uint32_t h = 2166136261u;
+
+    bench_has_levels = 0;
+    a->init();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        uint32_t *frame = a->next();
+        h = bench_fnv(h, frame ? frame : blank);
+        for (int i = 0; bench_has_levels && i < CHARLIE_NUM_LEDS; i++) {
+            h = (h ^ bench_levels[i]) * 16777619u;
+        }
+    }
+
+    return h;
+}
+
+// Best of a few runs, the first one warms the caches
+static double bench_fps(const sim_anim *a){
+    double best = 0;
+
+    for (int run = 0; run < 5; run++) {
+        a->init();
+        double t0 = bench_seconds();
+        for (int f = 0; f < BENCH_FRAMES; f++) a->next();
+        double fps = BENCH_FRAMES / (bench_seconds() - t0);
+        if (fps > best) best = fps;
+    }
+
+    return best;
+}
+
+static int bench_golden(const char *name, uint32_t *hash){
+    FILE *f = fopen(BENCH_GOLDEN, "r");
+    char n[64];
+    unsigned long h;
+    int found = 0;
+
+    if (!f) return 0;
+    while (!found && fscanf(f, "%63s %lx", n, &h) == 2) {
+        if (!strcmp(n, name)) {
+            *hash = (uint32_t)h;
+            found = 1;
+        }
+    }
+    fclose(f);
+
+    return found;
+}
+
+int sim_bench(int update){
+    FILE *out = 0;
+    int failed = 0;
+
+    if (update && !(out = fopen(BENCH_GOLDEN, "w"))) {
+        perror(BENCH_GOLDEN);
+        return 1;
+    }
+
+    printf("%-12s %-10s %-8s %12s\n", "anim", "hash", "golden", "frames/s");
+    for (size_t i = 0; i < BENCH_NUM_ANIMS; i++) {
+        const sim_anim *a = &bench_anims[i];
+        uint32_t h = bench_hash(a);
+        uint32_t golden;
+        const char *res;
+
+        if (update) {
+            fprintf(out, "%s %08lx\n", a->name, (unsigned long)h);
+            res = "updated";
+        } else if (!bench_golden(a->name, &golden)) {
+            res = "missing";
+            failed = 1;
+        } else if (golden != h) {
+            res = "CHANGED";
+            failed = 1;
+        } else {
+            res = "ok";
+        }
+
+        printf("%-12s %08lx   %-8s %12.0f\n", a->name, (unsigned long)h, res, bench_fps(a));
+    }
+
+    if (out) fclose(out);
+
+    return failed;
+}
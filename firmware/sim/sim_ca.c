@@ -0,0 +1,113 @@
+/* Word-parallel neighbour counts of the cellular automata (animations_ca.h).
+ *
+ *   sim/star_sim --ca
+ *
+ * anim_ca_count against a per LED count over led_layout_neighbours, on
+ * the empty and the full star, every single LED and random states of
+ * every density. Counts past the last LED must stay 0. The host time of
+ * both per generation is printed for comparison, the cycles on the chip
+ * are in the frame task of the perf report (star_debug, animation 5).
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include "sim.h"
+#include "animations_ca.h"
+#include "led_layout.h"
+#include "fixmath.h"
+
+#define CA_RANDOM_STATES    20000
+#define CA_BENCH_GENS       200000
+
+static int ca_errors;
+
+static uint8_t ca_naive_count(const uint32_t *state, uint8_t led){
+    uint8_t n = 0;
+
+    for (uint8_t other = 0; other < CHARLIE_NUM_LEDS; other++) {
+        if ((led_layout_neighbours[led][other / 32] >> (other % 32)) & 1) {
+            n += (state[other / 32] >> (other % 32)) & 1;
+        }
+    }
+
+    return n;
+}
+
+static void ca_check(const uint32_t *state){
+    uint32_t count[ANIM_CA_PLANES][CHARLIE_BITMASK_SIZE];
+
+    anim_ca_count(count, state);
+    for (uint8_t led = 0; led < 32 * CHARLIE_BITMASK_SIZE; led++) {
+        uint8_t got = 0;
+        uint8_t expect = led < CHARLIE_NUM_LEDS ? ca_naive_count(state, led) : 0;
+
+        for (int b = 0; b < ANIM_CA_PLANES; b++) got |= ((count[b][led / 32] >> (led % 32)) & 1) << b;
+        if (got != expect && ca_errors++ < 10) {
+            printf("ca: LED %u has %u neighbours on, counted %u (state %08lx %08lx)\n", led, expect, got,
+                   (unsigned long)state[0], (unsigned long)state[CHARLIE_BITMASK_SIZE - 1]);
+        }
+    }
+}
+
+static void ca_random_state(uint32_t *state, uint8_t shift){
+    for (int w = 0; w < CHARLIE_BITMASK_SIZE; w++) {
+        uint32_t r = 0xFFFFFFFF;
+
+        for (uint8_t i = 0; i < shift; i++) r &= fx_rand();
+        state[w] = r;
+    }
+    // the bits past the last LED too, they must not count
+}
+
+static double ca_seconds(void){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int sim_ca(void){
+    uint32_t state[CHARLIE_BITMASK_SIZE] = {0};
+    uint32_t count[ANIM_CA_PLANES][CHARLIE_BITMASK_SIZE];
+    volatile uint32_t sink = 0;
+    double t0, t_word, t_naive;
+
+    ca_check(state);
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        state[led / 32] = 1UL << (led % 32);
+        ca_check(state);
+        state[led / 32] = 0;
+    }
+    for (int w = 0; w < CHARLIE_BITMASK_SIZE; w++) state[w] = 0xFFFFFFFF;
+    ca_check(state);
+
+    fx_srand(0x2545F491);
+    for (int i = 0; i < CA_RANDOM_STATES; i++) {
+        ca_random_state(state, i % 4);
+        ca_check(state);
+    }
+    printf("%d states, max %u neighbours, %u graph shifts\n",
+           CA_RANDOM_STATES + CHARLIE_NUM_LEDS + 2, LED_LAYOUT_MAX_NEIGHBOURS, LED_LAYOUT_NUM_SHIFTS);
+
+    // host time per generation, word-parallel and per LED
+    t0 = ca_seconds();
+    for (int i = 0; i < CA_BENCH_GENS; i++) {
+        state[0] ^= i;
+        anim_ca_count(count, state);
+        sink += count[0][0] ^ count[1][1] ^ count[2][0];
+    }
+    t_word = ca_seconds() - t0;
+
+    t0 = ca_seconds();
+    for (int i = 0; i < CA_BENCH_GENS; i++) {
+        state[0] ^= i;
+        for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) sink += ca_naive_count(state, led);
+    }
+    t_naive = ca_seconds() - t0;
+
+    printf("per generation (host): word-parallel %.0f ns, per LED %.0f ns\n",
+           t_word * 1e9 / CA_BENCH_GENS, t_naive * 1e9 / CA_BENCH_GENS);
+    printf("ca: %s\n", ca_errors ? "FAIL" : "ok");
+
+    return ca_errors != 0;
+}
@@ -0,0 +1,620 @@
+#include <time.h>
+#include "sim.h"
+
+GPIO_TypeDef sim_gpioa, sim_gpioc, sim_gpiod;
+TIM_TypeDef sim_tim1, sim_tim2;
+USART_TypeDef sim_usart1;
+DMA_TypeDef sim_dma1;
+DMA_Channel_TypeDef sim_dma1_channel5;
+I2C_TypeDef sim_i2c1;
+void (*sim_uart_tx)(uint8_t byte) = 0;
+
+static uint8_t sim_usart_idle_ie = 0;
+uint32_t SystemCoreClock = 48000000;
+
+// Clock tree: HSI 24MHz, PLL x2, AHB prescaler
+static uint32_t sim_sysclk_src = RCC_SYSCLKSource_PLLCLK;
+static uint32_t sim_hpre = RCC_SYSCLK_Div1;
+static uint8_t sim_pll_on = 1;
+uint32_t sim_flash_latency = FLASH_Latency_1;
+uint8_t sim_host_time = 1;
+
+static SysTick_Type sim_systick_regs;
+static uint8_t sim_irq_on = 1;
+static uint32_t sim_tim1_remap = 0;
+
+// I2C1 master as the SDK calls see it, the target is sim_i2c_device
+typedef enum {
+    SIM_I2C_IDLE = 0,
+    SIM_I2C_START,      // start sent, address next
+    SIM_I2C_TX,
+    SIM_I2C_RX,
+    SIM_I2C_NACK        // nobody answered, only a stop helps
+} sim_i2c_state;
+
+static sim_i2c_state sim_i2c_bus = SIM_I2C_IDLE;
+const sim_i2c_target *sim_i2c_device = 0;
+uint32_t sim_i2c_bytes = 0;
+
+// TIM1 output pins per remap, as the hardware routes them
+typedef struct {
+    GPIO_TypeDef *port;
+    uint8_t bit;
+    uint8_t ch;
+    uint8_t comp;       // CHxN
+} sim_tim_pin;
+
+static const sim_tim_pin sim_tim1_pins_default[] = {
+    {GPIOD, 2, 0, 0}, {GPIOA, 1, 1, 0}, {GPIOC, 3, 2, 0}, {GPIOC, 4, 3, 0},
+    {GPIOD, 0, 0, 1}, {GPIOA, 2, 1, 1}, {GPIOD, 1, 2, 1},
+};
+static const sim_tim_pin sim_tim1_pins_remap1[] = {
+    {GPIOC, 6, 0, 0}, {GPIOC, 7, 1, 0}, {GPIOC, 0, 2, 0}, {GPIOD, 3, 3, 0},
+    {GPIOC, 3, 0, 1}, {GPIOC, 4, 1, 1}, {GPIOD, 1, 2, 1},
+};
+static const sim_tim_pin sim_tim1_pins_full[] = {
+    {GPIOC, 4, 0, 0}, {GPIOC, 7, 1, 0}, {GPIOC, 5, 2, 0}, {GPIOD, 4, 3, 0},
+    {GPIOC, 3, 0, 1}, {GPIOD, 2, 1, 1}, {GPIOC, 6, 2, 1},
+};
+
+// SysTick counts host time in core clock cycles
+SysTick_Type *sim_systick(void){
+    struct timespec ts;
+
+    if (!sim_host_time) return &sim_systick_regs;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    sim_systick_regs.CNT = (uint32_t)(ns * (SystemCoreClock / 1000000) / 1000);
+
+    return &sim_systick_regs;
+}
+
+uint32_t sim_discharge_ticks = 0;
+static uint64_t sim_ticks;
+static GPIO_TypeDef * const sim_gpio_ports[] = {GPIOA, GPIOC, GPIOD};
+static uint8_t sim_pin_output[3];           // driven at the last ISR
+static uint8_t sim_pin_charged[3];          // pin was high when last driven
+static uint64_t sim_pin_driven[3][8];       // tick it was last driven
+static uint32_t sim_tim2_clocks;           // core clocks into the TIM2 period
+
+void sim_reset(void){
+    GPIO_TypeDef *ports[] = {GPIOA, GPIOC, GPIOD};
+
+    for (int i = 0; i < 3; i++) {
+        *ports[i] = (GPIO_TypeDef){0};
+        ports[i]->CFGLR = 0x44444444;   // reset value, all floating
+    }
+    sim_tim1 = (TIM_TypeDef){0};
+    sim_tim2 = (TIM_TypeDef){0};
+    sim_tim2_clocks = 0;
+    sim_tim1_remap = 0;
+    sim_usart1 = (USART_TypeDef){0};
+    sim_dma1 = (DMA_TypeDef){0};
+    sim_dma1_channel5 = (DMA_Channel_TypeDef){0};
+    sim_i2c1 = (I2C_TypeDef){0};
+    sim_i2c_bus = SIM_I2C_IDLE;
+    sim_i2c_bytes = 0;
+    sim_usart_idle_ie = 0;
+    sim_irq_on = 1;
+    sim_sysclk_src = RCC_SYSCLKSource_PLLCLK;
+    sim_hpre = RCC_SYSCLK_Div1;
+    sim_pll_on = 1;
+    sim_flash_latency = FLASH_Latency_1;
+    sim_discharge_ticks = 0;
+    for (int i = 0; i < 3; i++) sim_pin_output[i] = sim_pin_charged[i] = 0;
+    SystemCoreClock = 48000000;
+}
+
+void sim_gpio_sync(GPIO_TypeDef *port){
+    if (port->BSHR) {
+        port->OUTDR = (port->OUTDR | (port->BSHR & 0xFFFF)) & ~(port->BSHR >> 16);
+        port->BSHR = 0;
+    }
+    if (port->BCR) {
+        port->OUTDR &= ~port->BCR;
+        port->BCR = 0;
+    }
+}
+
+// INDR before an ISR: outputs and pulls read back, a floating pin reads
+// its charge until it has run out
+static void sim_gpio_inputs(void){
+    if (!sim_discharge_ticks) return;
+
+    for (int p = 0; p < 3; p++) {
+        GPIO_TypeDef *port = sim_gpio_ports[p];
+        uint32_t indr = 0;
+
+        for (int bit = 0; bit < 8; bit++) {
+            uint32_t mode = (port->CFGLR >> (bit * 4)) & 0xF;
+            uint8_t level = (port->OUTDR >> bit) & 1;
+
+            if (mode == 0x4) {
+                level = ((sim_pin_charged[p] >> bit) & 1) && sim_ticks - sim_pin_driven[p][bit] < sim_discharge_ticks;
+            }
+            indr |= (uint32_t)level << bit;
+        }
+        port->INDR = indr;
+    }
+}
+
+// After an ISR: level of the driven pins, and the tick a pin stopped
+// being driven, it held its level up to there
+static void sim_gpio_track(void){
+    if (!sim_discharge_ticks) return;
+
+    for (int p = 0; p < 3; p++) {
+        GPIO_TypeDef *port = sim_gpio_ports[p];
+
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t out = ((port->CFGLR >> (bit * 4)) & 3) != 0;
+
+            if (out) {
+                sim_pin_charged[p] = (sim_pin_charged[p] & ~(1 << bit)) | (((port->OUTDR >> bit) & 1) << bit);
+            }
+            if (out || (sim_pin_output[p] >> bit) & 1) sim_pin_driven[p][bit] = sim_ticks;
+            sim_pin_output[p] = (sim_pin_output[p] & ~(1 << bit)) | (out << bit);
+        }
+    }
+}
+
+// TIM2 updates every (PSC + 1) * (ATRLR + 1) core clocks, a PWM tick is
+// HCLK / SIM_TICK_HZ of them: every tick at 48MHz, fewer below
+int sim_tim2_tick(void){
+    uint32_t period = (TIM2->PSC + 1) * (TIM2->ATRLR + 1);
+
+    if (!sim_irq_on || !(TIM2->CTLR1 & 1) || !(TIM2->DMAINTENR & TIM_IT_Update)) return 0;
+
+    sim_tim2_clocks += SystemCoreClock / SIM_TICK_HZ;
+    if (sim_tim2_clocks < period) return 0;
+    sim_tim2_clocks = sim_tim2_clocks - period < period ? sim_tim2_clocks - period : 0;
+
+    TIM2->INTFR |= TIM_IT_Update;
+    sim_gpio_inputs();
+    if (TIM2_IRQHandler) TIM2_IRQHandler();
+    sim_gpio_sync(GPIOA);
+    sim_gpio_sync(GPIOC);
+    sim_gpio_sync(GPIOD);
+    sim_gpio_track();
+
+    return 1;
+}
+
+// PWM mode 1 outputs of the enabled channels. The sim keeps the level of
+// an alternate function pin in its OUTDR bit, the pin only shows it when
+// CFGLR has it in AF mode.
+static void sim_tim1_outputs(void){
+    const sim_tim_pin *pins = sim_tim1_pins_default;
+    const __IO uint32_t *ccr = &TIM1->CH1CVR;
+
+    if (!(TIM1->BDTR & 0x8000) || !TIM1->CCER) return;     // MOE, any channel on
+    if (sim_tim1_remap == GPIO_PartialRemap1_TIM1) pins = sim_tim1_pins_remap1;
+    if (sim_tim1_remap == GPIO_FullRemap_TIM1) pins = sim_tim1_pins_full;
+
+    for (int i = 0; i < 7; i++) {
+        const sim_tim_pin *p = &pins[i];
+        uint16_t ccer = TIM1->CCER >> (p->ch * 4);
+        uint16_t chctlr = p->ch < 2 ? TIM1->CHCTLR1 : TIM1->CHCTLR2;
+        uint16_t mode = (chctlr >> ((p->ch & 1) * 8 + 4)) & 7;
+
+        if (!(ccer & (p->comp ? 0x4 : 0x1)) || mode != 6) continue;
+
+        uint8_t level = (TIM1->CNT < ccr[p->ch]) ^ !!(ccer & (p->comp ? 0x8 : 0x2));
+
+        if (level) p->port->OUTDR |= 1UL << p->bit;
+        else p->port->OUTDR &= ~(1UL << p->bit);
+    }
+}
+
+// TIM1 with the counter at the PWM tick (CHARLIE_HW_PWM): one count per
+// call, update event when it wraps, CC4 event on its compare match.
+// INTFR bits are cleared by writing 0 on the chip (the ISRs write ~bit),
+// a plain struct can't do that, so INTFR only holds this tick's events.
+// The last ~bit write of the update ISR still clears a pending CC4 before
+// its interrupt is taken.
+static int sim_tim1_tick(void){
+    uint16_t events = 0;
+    int irqs = 0;
+
+    if (!(TIM1->CTLR1 & 1)) return 0;
+
+    if (TIM1->CNT >= TIM1->ATRLR) {
+        TIM1->CNT = 0;
+        events |= TIM_IT_Update;
+    } else {
+        TIM1->CNT++;
+    }
+    if (TIM1->CNT == TIM1->CH4CVR) events |= TIM_IT_CC4;
+    TIM1->INTFR = events;
+    if (events) sim_gpio_inputs();
+
+    if (sim_irq_on && (events & TIM1->DMAINTENR & TIM_IT_Update) && TIM1_UP_IRQHandler) {
+        TIM1->INTFR = events;
+        TIM1_UP_IRQHandler();
+        irqs++;
+        events &= TIM1->INTFR;
+    }
+    if (sim_irq_on && (events & TIM1->DMAINTENR & TIM_IT_CC4) && TIM1_CC_IRQHandler) {
+        TIM1->INTFR = events;
+        TIM1_CC_IRQHandler();
+        irqs++;
+    }
+    sim_gpio_sync(GPIOA);
+    sim_gpio_sync(GPIOC);
+    sim_gpio_sync(GPIOD);
+    sim_tim1_outputs();
+    if (irqs) sim_gpio_track();
+
+    return irqs;
+}
+
+int sim_tick(void){
+    sim_ticks++;
+
+    return sim_tim2_tick() + sim_tim1_tick();
+}
+
+// Ticks without an event only count: up to the one that wraps, or to the
+// one before a CC4 match
+int sim_run(uint32_t ticks){
+    int irqs = 0;
+
+    while (ticks) {
+        if ((TIM1->CTLR1 & 1) && !(TIM2->CTLR1 & 1) && TIM1->CNT < TIM1->ATRLR) {
+            uint32_t skip = TIM1->ATRLR - TIM1->CNT;
+
+            if (TIM1->CH4CVR > TIM1->CNT && TIM1->CH4CVR - TIM1->CNT - 1 < skip) {
+                skip = TIM1->CH4CVR - TIM1->CNT - 1;
+            }
+            if (skip >= ticks) skip = ticks - 1;
+            TIM1->CNT += skip;
+            sim_ticks += skip;
+            ticks -= skip;
+        }
+        irqs += sim_tick();
+        ticks--;
+    }
+
+    return irqs;
+}
+
+// DMA channel 5 state the registers don't show, a new MADDR/CNTR pair
+// means the firmware re-armed it
+static uint32_t sim_dma5_maddr = 0;
+static uint32_t sim_dma5_left = 0;
+static uint32_t sim_dma5_start = 0;
+
+void sim_uart_rx(uint8_t byte){
+    DMA_Channel_TypeDef *ch = DMA1_Channel5;
+
+    if (!(sim_usart1.CTLR3 & USART_DMAReq_Rx) || !(ch->CFGR & DMA_CFGR1_EN) || !ch->CNTR) {
+        sim_usart1.DATAR = byte;    // nobody is listening, byte is lost
+        return;
+    }
+
+    if (ch->MADDR != sim_dma5_maddr || ch->CNTR != sim_dma5_left) {
+        sim_dma5_maddr = ch->MADDR;
+        sim_dma5_start = ch->CNTR;
+    }
+
+    uint8_t *dst = (uint8_t*)(uintptr_t)ch->MADDR;
+    dst[sim_dma5_start - ch->CNTR] = byte;
+    ch->CNTR--;
+    sim_dma5_left = ch->CNTR;
+
+    if (ch->CNTR == 0) {
+        sim_dma1.INTFR |= DMA1_IT_TC5;
+        if ((ch->CFGR & DMA_IT_TC) && sim_irq_on) DMA1_Channel5_IRQHandler();
+    }
+}
+
+void sim_uart_idle(void){
+    sim_usart1.STATR |= USART_FLAG_IDLE;
+    if (sim_usart_idle_ie && sim_irq_on) USART1_IRQHandler();
+}
+
+uint8_t sim_irq_enabled(void){
+    return sim_irq_on;
+}
+
+void __disable_irq(void){
+    sim_irq_on = 0;
+}
+
+void __enable_irq(void){
+    sim_irq_on = 1;
+}
+
+// Sleep until the next interrupt, the display tick
+void __WFI(void){
+    sim_tick();
+}
+
+// --- SDK ---
+
+void GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_InitStruct){
+    uint32_t mode = GPIO_InitStruct->GPIO_Mode & 0x0F;
+
+    if (GPIO_InitStruct->GPIO_Mode & 0x10) {
+        mode |= GPIO_InitStruct->GPIO_Speed;
+    }
+
+    for (int pin = 0; pin < 8; pin++) {
+        if (!(GPIO_InitStruct->GPIO_Pin & (1 << pin))) continue;
+
+        GPIOx->CFGLR = (GPIOx->CFGLR & ~(0xFUL << (pin * 4))) | (mode << (pin * 4));
+        if (GPIO_InitStruct->GPIO_Mode == GPIO_Mode_IPD) GPIOx->OUTDR &= ~(1UL << pin);
+        if (GPIO_InitStruct->GPIO_Mode == GPIO_Mode_IPU) GPIOx->OUTDR |= (1UL << pin);
+    }
+}
+
+void GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin){
+    GPIOx->OUTDR |= GPIO_Pin;
+}
+
+void GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin){
+    GPIOx->OUTDR &= ~(uint32_t)GPIO_Pin;
+}
+
+uint8_t GPIO_ReadInputDataBit(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin){
+    return (GPIOx->INDR & GPIO_Pin) ? 1 : 0;
+}
+
+void GPIO_PinRemapConfig(uint32_t GPIO_Remap, FunctionalState NewState){
+    if (GPIO_Remap == GPIO_PartialRemap1_TIM1 || GPIO_Remap == GPIO_FullRemap_TIM1) {
+        sim_tim1_remap = NewState ? GPIO_Remap : 0;
+    }
+}
+
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState){
+    (void)RCC_APB2Periph;
+    (void)NewState;
+}
+
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState){
+    (void)RCC_APB1Periph;
+    (void)NewState;
+}
+
+void SystemCoreClockUpdate(void){
+    uint32_t sysclk = sim_sysclk_src == RCC_SYSCLKSource_PLLCLK ? 48000000 : 24000000;
+
+    SystemCoreClock = sysclk / (sim_hpre == RCC_SYSCLK_Div3 ? 3 : 1);
+}
+
+void RCC_HCLKConfig(uint32_t RCC_SYSCLK){
+    sim_hpre = RCC_SYSCLK;
+}
+
+void RCC_SYSCLKConfig(uint32_t RCC_SYSCLKSource){
+    sim_sysclk_src = RCC_SYSCLKSource;
+}
+
+uint8_t RCC_GetSYSCLKSource(void){
+    return (uint8_t)(sim_sysclk_src << 2);
+}
+
+void RCC_PLLCmd(FunctionalState NewState){
+    sim_pll_on = NewState;
+}
+
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG){
+    return (RCC_FLAG == RCC_FLAG_PLLRDY && sim_pll_on) ? SET : RESET;
+}
+
+void FLASH_SetLatency(uint32_t FLASH_Latency){
+    sim_flash_latency = FLASH_Latency;
+}
+
+void TIM_PrescalerConfig(TIM_TypeDef *TIMx, uint16_t Prescaler, uint16_t TIM_PSCReloadMode){
+    TIMx->PSC = Prescaler;
+}
+
+// Mode, enable and polarity bits of one channel, like the SDK
+static void sim_tim_oc_init(TIM_TypeDef *TIMx, int ch, TIM_OCInitTypeDef *oc){
+    __IO uint16_t *chctlr = ch < 2 ? &TIMx->CHCTLR1 : &TIMx->CHCTLR2;
+    int shift = (ch & 1) * 8;
+    uint16_t ccer = (oc->TIM_OutputState ? 0x1 : 0) | (oc->TIM_OCPolarity ? 0x2 : 0) |
+                    (oc->TIM_OutputNState ? 0x4 : 0) | (oc->TIM_OCNPolarity ? 0x8 : 0);
+
+    *chctlr = (*chctlr & ~(0xFF << shift)) | ((oc->TIM_OCMode & 0x70) << shift);
+    TIMx->CCER = (TIMx->CCER & ~(0xF << (ch * 4))) | (ccer << (ch * 4));
+    (&TIMx->CH1CVR)[ch] = oc->TIM_Pulse;
+}
+
+void TIM_OC1Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct){
+    sim_tim_oc_init(TIMx, 0, TIM_OCInitStruct);
+}
+
+void TIM_OC2Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct){
+    sim_tim_oc_init(TIMx, 1, TIM_OCInitStruct);
+}
+
+void TIM_OC3Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct){
+    sim_tim_oc_init(TIMx, 2, TIM_OCInitStruct);
+}
+
+void TIM_OC4Init(TIM_TypeDef *TIMx, TIM_OCInitTypeDef *TIM_OCInitStruct){
+    sim_tim_oc_init(TIMx, 3, TIM_OCInitStruct);
+}
+
+void TIM_CtrlPWMOutputs(TIM_TypeDef *TIMx, FunctionalState NewState){
+    if (NewState) TIMx->BDTR |= 0x8000;
+    else TIMx->BDTR &= ~0x8000;
+}
+
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct){
+    TIMx->PSC = TIM_TimeBaseInitStruct->TIM_Prescaler;
+    TIMx->ATRLR = TIM_TimeBaseInitStruct->TIM_Period;
+}
+
+void TIM_ITConfig(TIM_TypeDef *TIMx, uint16_t TIM_IT, FunctionalState NewState){
+    if (NewState) TIMx->DMAINTENR |= TIM_IT;
+    else TIMx->DMAINTENR &= ~TIM_IT;
+}
+
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState){
+    if (NewState) TIMx->CTLR1 |= 1;
+    else TIMx->CTLR1 &= ~1;
+}
+
+ITStatus TIM_GetITStatus(TIM_TypeDef *TIMx, uint16_t TIM_IT){
+    return ((TIMx->INTFR & TIM_IT) && (TIMx->DMAINTENR & TIM_IT)) ? SET : RESET;
+}
+
+void TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t TIM_IT){
+    TIMx->INTFR &= ~TIM_IT;
+}
+
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *USART_InitStruct){
+    USARTx->CTLR1 = (USARTx->CTLR1 & 0x2000) | USART_InitStruct->USART_Mode;
+    USARTx->BRR = (uint16_t)(SystemCoreClock / USART_InitStruct->USART_BaudRate);
+}
+
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState){
+    if (NewState) USARTx->CTLR1 |= 0x2000;
+    else USARTx->CTLR1 &= ~0x2000;
+    USARTx->STATR |= USART_FLAG_TXE | USART_FLAG_TC;
+}
+
+void USART_ITConfig(USART_TypeDef *USARTx, uint16_t USART_IT, FunctionalState NewState){
+    if (USART_IT == USART_IT_IDLE) sim_usart_idle_ie = NewState;
+}
+
+ITStatus USART_GetITStatus(USART_TypeDef *USARTx, uint16_t USART_IT){
+    if (USART_IT == USART_IT_IDLE) return (sim_usart_idle_ie && (USARTx->STATR & USART_FLAG_IDLE)) ? SET : RESET;
+    return RESET;
+}
+
+FlagStatus USART_GetFlagStatus(USART_TypeDef *USARTx, uint16_t USART_FLAG){
+    return (USARTx->STATR & USART_FLAG) ? SET : RESET;
+}
+
+void USART_DMACmd(USART_TypeDef *USARTx, uint16_t USART_DMAReq, FunctionalState NewState){
+    if (NewState) USARTx->CTLR3 |= USART_DMAReq;
+    else USARTx->CTLR3 &= ~USART_DMAReq;
+}
+
+void USART_SendData(USART_TypeDef *USARTx, uint16_t Data){
+    if (sim_uart_tx) sim_uart_tx((uint8_t)Data);
+}
+
+// Reading DATAR after STATR clears IDLE on the chip, the sim clears it here
+uint16_t USART_ReceiveData(USART_TypeDef *USARTx){
+    USARTx->STATR &= ~USART_FLAG_IDLE;
+    return USARTx->DATAR;
+}
+
+void RCC_AHBPeriphClockCmd(uint32_t RCC_AHBPeriph, FunctionalState NewState){
+    (void)RCC_AHBPeriph;
+    (void)NewState;
+}
+
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *DMA_InitStruct){
+    DMAy_Channelx->CFGR = DMA_InitStruct->DMA_MemoryInc | DMA_InitStruct->DMA_Priority;
+    DMAy_Channelx->CNTR = DMA_InitStruct->DMA_BufferSize;
+    DMAy_Channelx->PADDR = DMA_InitStruct->DMA_PeripheralBaseAddr;
+    DMAy_Channelx->MADDR = DMA_InitStruct->DMA_MemoryBaseAddr;
+}
+
+void DMA_ITConfig(DMA_Channel_TypeDef *DMAy_Channelx, uint32_t DMA_IT, FunctionalState NewState){
+    if (NewState) DMAy_Channelx->CFGR |= DMA_IT;
+    else DMAy_Channelx->CFGR &= ~DMA_IT;
+}
+
+ITStatus DMA_GetITStatus(uint32_t DMAy_IT){
+    return (sim_dma1.INTFR & DMAy_IT) ? SET : RESET;
+}
+
+void DMA_ClearITPendingBit(uint32_t DMAy_IT){
+    sim_dma1.INTFR &= ~DMAy_IT;
+}
+
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct){
+    (void)NVIC_InitStruct;
+}
+
+void Delay_Init(void){
+}
+
+void Delay_Us(uint32_t n){
+    (void)n;
+}
+
+void Delay_Ms(uint32_t n){
+    (void)n;
+}
+
+void USART_Printf_Init(uint32_t baudrate){
+    (void)baudrate;
+}
+
+void I2C_Init(I2C_TypeDef *I2Cx, I2C_InitTypeDef *I2C_InitStruct){
+    I2Cx->CTLR2 = (uint16_t)(SystemCoreClock / 1000000);    // FREQ, PCLK in MHz
+    I2Cx->CKCFGR = (uint16_t)(SystemCoreClock / (I2C_InitStruct->I2C_ClockSpeed * 3));
+}
+
+void I2C_Cmd(I2C_TypeDef *I2Cx, FunctionalState NewState){
+    if (NewState) I2Cx->CTLR1 |= 0x0001;
+    else I2Cx->CTLR1 &= ~0x0001;
+}
+
+void I2C_GenerateSTART(I2C_TypeDef *I2Cx, FunctionalState NewState){
+    if (NewState && (I2Cx->CTLR1 & 0x0001)) sim_i2c_bus = SIM_I2C_START;
+}
+
+void I2C_GenerateSTOP(I2C_TypeDef *I2Cx, FunctionalState NewState){
+    if (NewState) sim_i2c_bus = SIM_I2C_IDLE;
+}
+
+void I2C_AcknowledgeConfig(I2C_TypeDef *I2Cx, FunctionalState NewState){
+    if (NewState) I2Cx->CTLR1 |= 0x0400;
+    else I2Cx->CTLR1 &= ~0x0400;
+}
+
+void I2C_Send7bitAddress(I2C_TypeDef *I2Cx, uint8_t Address, uint8_t I2C_Direction){
+    if (sim_i2c_bus != SIM_I2C_START) return;
+
+    sim_i2c_bytes++;
+    if (sim_i2c_device && (Address >> 1) == sim_i2c_device->addr) {
+        sim_i2c_bus = I2C_Direction == I2C_Direction_Receiver ? SIM_I2C_RX : SIM_I2C_TX;
+        sim_i2c_device->start(I2C_Direction == I2C_Direction_Receiver);
+    } else {
+        sim_i2c_bus = SIM_I2C_NACK;
+    }
+}
+
+void I2C_SendData(I2C_TypeDef *I2Cx, uint8_t Data){
+    if (sim_i2c_bus != SIM_I2C_TX) return;
+
+    sim_i2c_bytes++;
+    sim_i2c_device->write(Data);
+}
+
+uint8_t I2C_ReceiveData(I2C_TypeDef *I2Cx){
+    if (sim_i2c_bus != SIM_I2C_RX) return 0xFF;
+
+    sim_i2c_bytes++;
+    return sim_i2c_device->read();
+}
+
+// Transfers finish right away, so an event is there as soon as its
+// state is reached
+ErrorStatus I2C_CheckEvent(I2C_TypeDef *I2Cx, uint32_t I2C_EVENT){
+    switch (sim_i2c_bus) {
+    case SIM_I2C_START:
+        return I2C_EVENT == I2C_EVENT_MASTER_MODE_SELECT ? SUCCESS : ERROR;
+    case SIM_I2C_TX:
+        return (I2C_EVENT == I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED ||
+                I2C_EVENT == I2C_EVENT_MASTER_BYTE_TRANSMITTED) ? SUCCESS : ERROR;
+    case SIM_I2C_RX:
+        return (I2C_EVENT == I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED ||
+                I2C_EVENT == I2C_EVENT_MASTER_BYTE_RECEIVED) ? SUCCESS : ERROR;
+    default:
+        return ERROR;
+    }
+}
+
+FlagStatus I2C_GetFlagStatus(I2C_TypeDef *I2Cx, uint32_t I2C_FLAG){
+    return (I2C_FLAG == I2C_FLAG_BUSY && sim_i2c_bus != SIM_I2C_IDLE) ? SET : RESET;
+}
@@ -0,0 +1,342 @@
+/* Host simulation of the badge: runs the real led_charlie library and
+ * animations, with the display timer ISRs pumped from the main loop.
+ *
+ *   make -C sim && sim/star_sim [frames] [isr_ticks_per_frame]
+ *
+ * With --pty the USART1 stream receiver is attached to a pseudo terminal,
+ * so tools/star_stream.py can drive the simulated star:
+ *
+ *   sim/star_sim --pty [seconds]
+ *
+ * --bench checks the animations against golden frame hashes and
+ * measures their speed, see sim_bench.c.
+ *
+ * --clock steps through the sysclk levels and checks that the display
+ * PWM tick and the stream baud rate stay, then prints the level each
+ * animation runs at.
+ *
+ * --ring checks the ordering of the driver command ring, see sim_ring.c.
+ *
+ * --pwm checks the LED on-times read back from the pins and counts the
+ * display interrupts, see sim_pwm.c. star_sim_hw is the same simulator
+ * with the driver built for the hardware timer PWM (CHARLIE_HW_PWM).
+ *
+ * --usage checks the per LED on-time counters against the pins and prints
+ * the LED and pin heatmap, see sim_usage.c. The default run ends with the
+ * perf and usage reports of the firmware's debug command.
+ *
+ * --motion [trace.csv] runs the motion animation on accelerometer samples
+ * fed through a model of the SC7A20, see sim_motion.c.
+ *
+ * --render ANIM [seconds] [fps] prints the LED on-times of every video
+ * frame for tools/star_render.py, see sim_render.c.
+ *
+ * --ambient checks the auto-brightness filter and the LED light sensing
+ * of the driver, see sim_ambient.c.
+ *
+ * --scan compares the pin changes of the two multiplex scan orders,
+ * see sim_scan.c.
+ *
+ * --topology checks the generated charlie tables against the pin list
+ * in platformio.ini, see sim_topology.c.
+ *
+ * --ca checks the word-parallel neighbour counts of the cellular
+ * automata against a per LED count, see sim_ca.c.
+ *
+ * --seq checks the waits, triggers and child runs of the animation
+ * sequences, see sim_seq.c.
+ *
+ * --stream checks that a stream frame is never swapped in after the main
+ * loop presented its buffer, see sim_stream.c.
+ *
+ * star_sim_2port and star_sim_2port_hw run the driver on a second pin list
+ * over GPIOC and GPIOD (Makefile). It has no led_layout, so --usage,
+ * --motion, --render, --ca and --bench are left out there.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "charlie_perf.h"
+#include "charlie_usage.h"
+#include "animations.h"
+#include "animations_simple.h"
+#include "uart_stream.h"
+#include "sysclk.h"
+
+int sim_bench(int update);
+int sim_ring(void);
+int sim_pwm(void);
+int sim_usage(void);
+int sim_motion(const char *trace);
+int sim_render(const char *name, double seconds, uint32_t fps);
+int sim_ambient(void);
+int sim_scan(void);
+int sim_topology(void);
+int sim_stream(void);
+int sim_ca(void);
+int sim_seq(void);
+
+static int sim_pty_fd = -1;
+
+static void sim_pty_tx(uint8_t byte){
+    if (write(sim_pty_fd, &byte, 1) != 1) {
+        perror("pty write");
+    }
+}
+
+static int sim_open_pty(void){
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+        perror("pty");
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    printf("stream pty: %s\n", ptsname(fd));
+    fflush(stdout);
+
+    return fd;
+}
+
+// Real time loop, 1ms of ISR ticks per pass, bytes from the pty go into
+// the USART1 receiver, a pass without bytes is an idle line
+static int sim_run_pty(uint32_t seconds){
+    sim_pty_fd = sim_open_pty();
+    if (sim_pty_fd < 0) return 1;
+    sim_uart_tx = sim_pty_tx;
+
+    stream_init(115200);
+
+    stream_stats last = {0};
+    uint32_t ms = 0;
+    uint8_t had_rx = 0;
+
+    while (!seconds || ms < seconds * 1000) {
+        uint8_t buf[256];
+        ssize_t n = read(sim_pty_fd, buf, sizeof(buf));
+
+        for (ssize_t i = 0; i < n; i++) sim_uart_rx(buf[i]);
+        if (n <= 0 && had_rx) sim_uart_idle();
+        had_rx = n > 0;
+
+        for (uint32_t t = 0; t < SIM_TICK_HZ / 1000; t++) sim_tick();
+
+        stream_poll();
+        if (stream_anim() != STREAM_ANIM_LIVE && ms % 500 == 0) {
+            charlie_update_multiplex_pattern(twinkle_next_frame());
+        }
+
+        usleep(1000);
+        ms++;
+
+        if (ms % 1000 == 0) {
+            stream_stats s;
+
+            stream_get_stats(&s);
+            printf("stream: %lu packets/s, %lu bad sum, %lu bad header, %lu resyncs, %lu dropped, anim %u\n",
+                   (unsigned long)(s.packets - last.packets), (unsigned long)s.bad_sum,
+                   (unsigned long)s.bad_header, (unsigned long)s.resyncs, (unsigned long)s.dropped,
+                   stream_anim());
+            fflush(stdout);
+            last = s;
+        }
+    }
+
+    return 0;
+}
+
+#define CLOCK_LEVEL     41      // odd, the software PWM rounds it up below 48MHz
+#define CLOCK_SLOTS     50
+
+// One LED at CLOCK_LEVEL from the pins: PWM ticks per slot and lit per slot
+static void clock_measure(uint32_t *period, uint32_t *on){
+    uint32_t ticks = 0, lit = 0, slots = 0;
+    uint8_t was = 0xFF;
+    int overlap = 0;
+
+    // from the start of a slot
+    while (sim_lit_led(&overlap) == 0xFF) sim_tick();
+    while (slots <= CLOCK_SLOTS) {
+        uint8_t led = sim_lit_led(&overlap);
+
+        if (led != 0xFF && was == 0xFF) slots++;
+        if (slots > CLOCK_SLOTS) break;
+        if (led != 0xFF) lit++;
+        was = led;
+        sim_run(1);
+        ticks++;
+    }
+    *period = ticks / CLOCK_SLOTS;
+    *on = lit / CLOCK_SLOTS;
+}
+
+// Every clock level must keep the 400kHz PWM tick and the 115200 baud,
+// below 48MHz the software PWM interrupts less often with coarser levels.
+// Then the level each animation runs at with the display on (main.c).
+static int sim_run_clock(void){
+    static const sysclk_level steps[] = {SYSCLK_MID, SYSCLK_LOW, SYSCLK_HIGH, SYSCLK_LOW, SYSCLK_MID, SYSCLK_HIGH};
+    static const char * const names[] = {"low", "mid", "high"};
+    static const char * const anims[ANIM_NUM] = {
+        "live", "twinkle", "sparkle", "breathe", "wave", "life", "fire", "ripple", "motion", "show"
+    };
+    uint32_t one[CHARLIE_BITMASK_SIZE] = {1};
+    int fail = 0;
+
+    sim_reset();
+    charlie_init();
+    stream_init(115200);
+    sysclk_init();
+    sysclk_add_hook(charlie_set_timebase);
+    sysclk_add_hook(stream_set_timebase);
+    charlie_set_fast_pwm_mode(1);
+    charlie_set_brightness(255);
+    charlie_enable_multiplex(one);
+    charlie_set_led_level(0, CLOCK_LEVEL);
+
+    printf("level  hclk      wait  irq/s    tick/s   on/slot  baud\n");
+    for (unsigned i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        sysclk_request(SYSCLK_USER_ANIM, steps[i]);
+
+        uint32_t hclk = sysclk_hclk();
+#ifdef CHARLIE_HW_PWM
+        uint32_t tick = hclk / (TIM1->PSC + 1);    // TIM1 counts PWM ticks
+        uint32_t irqs = tick / (TIM1->ATRLR + 1);
+        uint32_t step = 1;
+#else
+        uint32_t irqs = hclk / ((TIM2->PSC + 1) * (TIM2->ATRLR + 1));
+        uint32_t step = SIM_TICK_HZ / irqs;         // PWM ticks per interrupt
+        uint32_t tick = irqs * step;
+#endif
+        uint32_t baud = hclk / USART1->BRR;
+        uint32_t period, on;
+
+        clock_measure(&period, &on);
+
+        // a slot stays 64 ticks, on for the level rounded up to the step
+        int ok = tick == SIM_TICK_HZ && period == 64 && on >= CLOCK_LEVEL && on < CLOCK_LEVEL + step &&
+                 baud > 115200 * 98 / 100 && baud < 115200 * 102 / 100;
+
+        printf("%-6s %-9lu %-5lu %-8lu %-8lu %-8lu %-7lu %s\n", names[sysclk_level_now()], (unsigned long)hclk,
+               (unsigned long)sim_flash_latency, (unsigned long)irqs, (unsigned long)tick,
+               (unsigned long)on, (unsigned long)baud, ok ? "ok" : "FAIL");
+        fail |= !ok;
+    }
+    printf("%lu clock switches\n", (unsigned long)sysclk_switches());
+
+    // the display at DISPLAY_SYSCLK (main.c), a stream only for live frames
+    sysclk_request(SYSCLK_USER_DISPLAY, SYSCLK_MID);
+    printf("anim     level\n");
+    for (uint8_t anim = 0; anim < ANIM_NUM; anim++) {
+        sysclk_request(SYSCLK_USER_ANIM, anim_sysclk(anim));
+        sysclk_request(SYSCLK_USER_STREAM, anim == STREAM_ANIM_LIVE ? SYSCLK_HIGH : SYSCLK_LOW);
+        printf("%-8s %-5s %lu\n", anims[anim], names[sysclk_level_now()], (unsigned long)sysclk_hclk());
+    }
+    sysclk_request(SYSCLK_USER_ANIM, anim_sysclk(ANIM_TWINKLE));
+    sysclk_request(SYSCLK_USER_STREAM, SYSCLK_LOW);
+    if (sysclk_level_now() != SYSCLK_MID) {
+        printf("clock: twinkle runs at %s\n", names[sysclk_level_now()]);
+        fail = 1;
+    }
+
+    return fail;
+}
+
+int main(int argc, char **argv){
+    if (argc > 1 && !strcmp(argv[1], "--clock")) {
+        return sim_run_clock();
+    }
+    if (argc > 1 && !strcmp(argv[1], "--ring")) {
+        return sim_ring();
+    }
+    if (argc > 1 && !strcmp(argv[1], "--pwm")) {
+        return sim_pwm();
+    }
+#if ANIM_LAYOUT
+    if (argc > 1 && !strcmp(argv[1], "--usage")) {
+        return sim_usage();
+    }
+    if (argc > 1 && !strcmp(argv[1], "--motion")) {
+        return sim_motion(argc > 2 ? argv[2] : 0);
+    }
+    if (argc > 1 && !strcmp(argv[1], "--render")) {
+        return sim_render(argc > 2 ? argv[2] : 0, argc > 3 ? strtod(argv[3], 0) : 10,
+                          argc > 4 ? strtoul(argv[4], 0, 0) : 25);
+    }
+#endif
+    if (argc > 1 && !strcmp(argv[1], "--ambient")) {
+        return sim_ambient();
+    }
+    if (argc > 1 && !strcmp(argv[1], "--scan")) {
+        return sim_scan();
+    }
+    if (argc > 1 && !strcmp(argv[1], "--seq")) {
+        return sim_seq();
+    }
+#if ANIM_LAYOUT
+    if (argc > 1 && !strcmp(argv[1], "--ca")) {
+        return sim_ca();
+    }
+#endif
+    if (argc > 1 && !strcmp(argv[1], "--stream")) {
+        return sim_stream();
+    }
+    if (argc > 1 && !strcmp(argv[1], "--topology")) {
+        return sim_topology();
+    }
+#if ANIM_LAYOUT
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        sim_reset();
+        charlie_init();
+        return sim_bench(argc > 2 && !strcmp(argv[2], "--update"));
+    }
+#endif
+
+    int pty = argc > 1 && !strcmp(argv[1], "--pty");
+
+    if (pty) {
+        argc--;
+        argv++;
+    }
+
+    uint32_t frames = argc > 1 ? strtoul(argv[1], 0, 0) : 100;
+    uint32_t ticks = argc > 2 ? strtoul(argv[2], 0, 0) : 40000;   // 100ms at 400kHz
+
+    sim_reset();
+    charlie_init();
+    perf_init();
+
+    // same setup as src/main.c
+    charlie_set_fast_pwm_mode(1);
+    charlie_set_brightness(40);
+    twinkle_init();
+    charlie_enable_multiplex(twinkle_next_frame());
+
+    if (pty) {
+        return sim_run_pty(argc > 1 ? frames : 0);
+    }
+
+    for (uint32_t f = 0; f < frames; f++) {
+        PERF_START(frame_start);
+        uint32_t *frame = twinkle_next_frame();
+        PERF_END(PERF_TASK_FRAME, frame_start);
+
+        PERF_START(update_start);
+        charlie_update_multiplex_pattern(frame);
+        PERF_END(PERF_TASK_UPDATE, update_start);
+
+        for (uint32_t t = 0; t < ticks; t++) {
+            sim_tick();
+        }
+    }
+
+    perf_report();
+    usage_report();
+
+    return 0;
+}
@@ -0,0 +1,372 @@
+/* Motion animation from accelerometer traces (motion.h, sc7a20.h).
+ *
+ *   sim/star_sim --motion              built-in scenario, checked
+ *   sim/star_sim --motion trace.csv    replay a recorded trace
+ *
+ * The samples go into a model of the SC7A20 on the simulated I2C1 bus, so
+ * the driver's FIFO burst reads, the batch filter and the animation all
+ * run as on the star: 20ms frames, a motion_poll every MOTION_POLL_MS.
+ *
+ * Traces are what the star_motion_trace build prints on USART1: one
+ * sample per line, "x,y,z" in mg on the sensor axes at 100Hz, lines
+ * starting with '#' are skipped.
+ *
+ * The scenario lies flat, tilts towards +x, then towards -y, lies flat,
+ * gets shaken and rests again. The light has to follow the tilt (level
+ * weighted centre of the LEDs, board coordinates), shakes have to set
+ * off sparkle bursts and the intensity has to come back down at rest.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "led_layout.h"
+#include "animations_motion.h"
+#include "motion.h"
+#include "sc7a20.h"
+#include "fixmath.h"
+
+#if LED_LAYOUT_NUM_LEDS != CHARLIE_NUM_LEDS
+#error "led_layout does not match the charlie topology, rerun tools/gen_led_layout.py"
+#endif
+
+#define MOTION_FRAME_MS     20
+#define MOTION_SAMPLE_MS    (1000 / SC7A20_ODR_HZ)
+#define MOTION_MAX_SAMPLES  (60 * SC7A20_ODR_HZ)     // a minute of trace
+
+// --- SC7A20 model: registers, stream mode FIFO, address auto increment ---
+
+#define MODEL_WHO_AM_I      0x0F
+#define MODEL_CTRL_REG1     0x20
+#define MODEL_CTRL_REG5     0x24
+#define MODEL_OUT_X_L       0x28
+#define MODEL_OUT_Z_H       0x2D
+#define MODEL_FIFO_SRC      0x2F
+
+static struct {
+    uint8_t reg[0x40];
+    uint8_t ptr;
+    uint8_t inc;
+    uint8_t addressed;      // register address of this write transfer seen
+    int16_t fifo[SC7A20_FIFO_SIZE][3];
+    uint8_t head;
+    uint8_t count;
+    uint8_t overrun;
+} model;
+
+static void model_start(uint8_t read){
+    if (!read) model.addressed = 0;
+}
+
+static void model_write(uint8_t byte){
+    if (!model.addressed) {
+        model.ptr = byte & 0x3F;
+        model.inc = byte & 0x80;
+        model.addressed = 1;
+        return;
+    }
+    model.reg[model.ptr] = byte;
+    if (model.inc) model.ptr = (model.ptr + 1) & 0x3F;
+}
+
+static uint8_t model_read(void){
+    uint8_t ptr = model.ptr;
+    uint8_t value;
+
+    if (ptr >= MODEL_OUT_X_L && ptr <= MODEL_OUT_Z_H) {
+        int16_t raw = model.fifo[model.head][(ptr - MODEL_OUT_X_L) >> 1];
+
+        value = (ptr & 1) ? (uint8_t)((uint16_t)raw >> 8) : (uint8_t)raw;
+
+        // last byte of a sample pops it, the address wraps to the next
+        if (ptr == MODEL_OUT_Z_H) {
+            if (model.count && (model.reg[MODEL_CTRL_REG5] & 0x40)) {
+                model.head = (model.head + 1) % SC7A20_FIFO_SIZE;
+                model.count--;
+                model.overrun = 0;
+            }
+            if (model.inc) model.ptr = MODEL_OUT_X_L;
+            return value;
+        }
+    } else if (ptr == MODEL_WHO_AM_I) {
+        value = 0x11;
+    } else if (ptr == MODEL_FIFO_SRC) {
+        value = (model.overrun ? 0x40 : 0) | (model.count ? 0 : 0x20) |
+                (model.count > 31 ? 31 : model.count);
+    } else {
+        value = model.reg[ptr];
+    }
+
+    if (model.inc) model.ptr = (ptr + 1) & 0x3F;
+
+    return value;
+}
+
+static const sim_i2c_target model_target = {SC7A20_ADDR, model_start, model_write, model_read};
+
+static void model_reset(void){
+    model = (typeof(model)){0};
+    sim_i2c_device = &model_target;
+}
+
+// One conversion, mg on the sensor axes, 12 bit left aligned like the chip
+static void model_sample(const sc7a20_sample *s){
+    const int16_t mg[3] = {s->x, s->y, s->z};
+    uint8_t slot;
+
+    if (!(model.reg[MODEL_CTRL_REG1] >> 4)) return;     // power down
+
+    if (model.count == SC7A20_FIFO_SIZE) {              // stream mode drops the oldest
+        model.head = (model.head + 1) % SC7A20_FIFO_SIZE;
+        model.count--;
+        model.overrun = 1;
+    }
+    slot = (model.head + model.count) % SC7A20_FIFO_SIZE;
+    for (int k = 0; k < 3; k++) {
+        int16_t v = mg[k] > 2047 ? 2047 : (mg[k] < -2048 ? -2048 : mg[k]);
+
+        model.fifo[slot][k] = (int16_t)(v * 16);
+    }
+    model.count++;
+}
+
+// --- Traces ---
+
+static sc7a20_sample trace[MOTION_MAX_SAMPLES];
+
+static uint32_t trace_load(const char *path){
+    FILE *f = fopen(path, "r");
+    char line[128];
+    uint32_t n = 0;
+
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    while (n < MOTION_MAX_SAMPLES && fgets(line, sizeof(line), f)) {
+        int x, y, z;
+
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%d,%d,%d", &x, &y, &z) == 3) {
+            trace[n++] = (sc7a20_sample){(int16_t)x, (int16_t)y, (int16_t)z};
+        }
+    }
+    fclose(f);
+
+    return n;
+}
+
+// Scenario phases, in samples
+enum {
+    PHASE_REST, PHASE_TILT_X, PHASE_TILT_Y, PHASE_FLAT, PHASE_SHAKE, PHASE_CALM, NUM_PHASES
+};
+
+static const uint16_t phase_end[NUM_PHASES] = {100, 300, 500, 600, 660, 960};
+static const char *const phase_name[NUM_PHASES] = {"rest", "tilt +x", "tilt -y", "flat", "shake", "calm"};
+
+static uint8_t phase_of(uint32_t i){
+    uint8_t p = 0;
+
+    while (p < NUM_PHASES - 1 && i >= phase_end[p]) p++;
+
+    return p;
+}
+
+// Board axes to the sensor ones, the inverse of MOTION_BOARD_*
+static sc7a20_sample board_sample(int16_t bx, int16_t by, int16_t bz){
+    sc7a20_sample s = {.x = (int16_t)-by, .y = (int16_t)-bx, .z = bz};
+
+    return s;
+}
+
+// Tilts ramp in over half a second to 30 degrees (500mg across), the
+// shake is 8Hz of +-1.5g along x
+static uint32_t trace_scenario(void){
+    for (uint32_t i = 0; i < phase_end[NUM_PHASES - 1]; i++) {
+        uint8_t p = phase_of(i);
+        uint32_t start = p ? phase_end[p - 1] : 0;
+        int16_t ramp = (int16_t)((i - start) >= 50 ? 500 : (i - start) * 10);
+
+        switch (p) {
+        case PHASE_TILT_X:
+            trace[i] = board_sample(-ramp, 0, 866);     // +x side down, reaction points -x
+            break;
+        case PHASE_TILT_Y:
+            trace[i] = board_sample(0, ramp, 866);      // -y side (top) down
+            break;
+        case PHASE_SHAKE:
+            trace[i] = board_sample((int16_t)(1500 * sin(2 * M_PI * 8 * (i - start) / SC7A20_ODR_HZ)), 0, 1000);
+            break;
+        default:
+            trace[i] = board_sample(0, 0, 1000);
+            break;
+        }
+    }
+
+    return phase_end[NUM_PHASES - 1];
+}
+
+// --- Replay ---
+
+typedef struct {
+    double cx, cy;          // level weighted centre of the star
+    uint8_t intensity;
+    uint8_t sparks;         // LEDs at full level
+    uint8_t shakes;
+} motion_frame_info;
+
+static void frame_info(const uint8_t *levels, const motion_state *m, uint8_t shakes, motion_frame_info *info){
+    double sum = 0, sx = 0, sy = 0;
+
+    info->sparks = 0;
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        sum += levels[led];
+        sx += (double)levels[led] * led_layout[led].x;
+        sy += (double)levels[led] * led_layout[led].y;
+        if (levels[led] == 255) info->sparks++;
+    }
+    info->cx = sum ? sx / sum : 128;
+    info->cy = sum ? sy / sum : 128;
+    info->intensity = m->intensity;
+    info->shakes = shakes;
+}
+
+// Frame callback: sample index at the end of the frame and what it showed
+typedef void (*motion_observer)(uint32_t sample, const motion_frame_info *info);
+
+static uint32_t motion_replay(uint32_t samples, motion_observer observe){
+    static uint8_t levels[CHARLIE_NUM_LEDS];
+    const uint32_t poll_frames = MOTION_POLL_MS / MOTION_FRAME_MS;
+    const uint32_t per_frame = MOTION_FRAME_MS / MOTION_SAMPLE_MS;
+    motion_state m = {0};
+    uint32_t polled = 0;
+
+    sim_reset();
+    model_reset();
+    fx_srand(0x5EED);
+    if (!sc7a20_init()) {
+        printf("motion: sensor not found on the bus\n");
+        return 0;
+    }
+    motion_init();
+    anim_motion_init();
+
+    for (uint32_t f = 0; (f + 1) * per_frame <= samples; f++) {
+        motion_frame_info info;
+        uint8_t shakes = 0;
+
+        for (uint32_t k = 0; k < per_frame; k++) model_sample(&trace[f * per_frame + k]);
+
+        if ((f + 1) % poll_frames == 0) {
+            polled += motion_poll(&m);
+            shakes = m.shakes;
+        }
+        anim_motion_update(m.tilt_x, m.tilt_y, m.intensity, shakes, levels);
+
+        frame_info(levels, &m, shakes, &info);
+        observe((f + 1) * per_frame - 1, &info);
+    }
+
+    return polled;
+}
+
+// --- Scenario checks ---
+
+static struct {
+    motion_frame_info end[NUM_PHASES];      // last frame of every phase
+    uint32_t shakes[NUM_PHASES];
+    uint8_t max_sparks[NUM_PHASES];
+    uint8_t max_intensity[NUM_PHASES];
+} seen;
+
+static void scenario_observe(uint32_t sample, const motion_frame_info *info){
+    uint8_t p = phase_of(sample);
+
+    seen.end[p] = *info;
+    seen.shakes[p] += info->shakes;
+    if (info->sparks > seen.max_sparks[p]) seen.max_sparks[p] = info->sparks;
+    if (info->intensity > seen.max_intensity[p]) seen.max_intensity[p] = info->intensity;
+}
+
+static int motion_expect(int ok, const char *what){
+    if (!ok) printf("motion: expected %s\n", what);
+
+    return !ok;
+}
+
+static int motion_scenario(void){
+    uint32_t samples = trace_scenario();
+    int errors = 0;
+
+    {
+        sc7a20_sample s = board_sample(1, 2, 3);
+        errors += motion_expect(MOTION_BOARD_X(&s) == 1 && MOTION_BOARD_Y(&s) == 2 &&
+                                MOTION_BOARD_Z(&s) == 3, "the scenario's axes to match MOTION_BOARD_*");
+    }
+
+    memset(&seen, 0, sizeof(seen));
+    uint32_t polled = motion_replay(samples, scenario_observe);
+
+    printf("phase    centre x  centre y  intensity(max) shakes sparks(max)\n");
+    for (int p = 0; p < NUM_PHASES; p++) {
+        printf("%-8s %8.1f %9.1f %6u (%3u) %9lu %7u\n", phase_name[p], seen.end[p].cx, seen.end[p].cy,
+               seen.end[p].intensity, seen.max_intensity[p], (unsigned long)seen.shakes[p], seen.max_sparks[p]);
+    }
+
+    const motion_frame_info *rest = &seen.end[PHASE_REST];
+
+    errors += motion_expect(polled == samples, "every sample to reach the filter");
+    errors += motion_expect(rest->intensity < 16 && !seen.shakes[PHASE_REST], "a quiet star at rest");
+    errors += motion_expect(seen.end[PHASE_TILT_X].cx > rest->cx + 16, "the light to move to +x");
+    errors += motion_expect(seen.end[PHASE_TILT_Y].cy < rest->cy - 16, "the light to move to -y");
+    errors += motion_expect(seen.end[PHASE_FLAT].cx < rest->cx + 8 && seen.end[PHASE_FLAT].cx > rest->cx - 8 &&
+                            seen.end[PHASE_FLAT].cy < rest->cy + 8 && seen.end[PHASE_FLAT].cy > rest->cy - 8,
+                            "the light back in the middle when flat");
+    errors += motion_expect(seen.shakes[PHASE_SHAKE] >= 3, "shakes counted while shaking");
+    errors += motion_expect(seen.max_sparks[PHASE_SHAKE] >= 8, "sparkle bursts while shaking");
+    errors += motion_expect(seen.max_intensity[PHASE_SHAKE] >= 128, "a high intensity while shaking");
+    errors += motion_expect(seen.end[PHASE_CALM].intensity < 16,
+                            "the intensity back down after the shake");
+
+    printf("i2c: %lu bytes for %lu samples, %.1f bytes per sample in %lu ms batches\n",
+           (unsigned long)sim_i2c_bytes, (unsigned long)polled, (double)sim_i2c_bytes / (polled ? polled : 1),
+           (unsigned long)MOTION_POLL_MS);
+    printf("motion: %s\n", errors ? "FAIL" : "ok");
+
+    return errors != 0;
+}
+
+// --- Recorded traces: one line per second ---
+
+static struct {
+    uint32_t shakes;
+    uint8_t max_intensity;
+} replay_second;
+
+static void replay_observe(uint32_t sample, const motion_frame_info *info){
+    replay_second.shakes += info->shakes;
+    if (info->intensity > replay_second.max_intensity) replay_second.max_intensity = info->intensity;
+
+    if ((sample + 1) % SC7A20_ODR_HZ == 0) {
+        printf("%4lus  centre %5.1f,%5.1f  intensity %3u (max %3u)  shakes %lu  sparks %u\n",
+               (unsigned long)((sample + 1) / SC7A20_ODR_HZ), info->cx, info->cy, info->intensity,
+               replay_second.max_intensity, (unsigned long)replay_second.shakes, info->sparks);
+        replay_second.shakes = 0;
+        replay_second.max_intensity = 0;
+    }
+}
+
+int sim_motion(const char *path){
+    if (!path) return motion_scenario();
+
+    uint32_t samples = trace_load(path);
+
+    if (!samples) return 1;
+    printf("%s: %lu samples (%.1fs)\n", path, (unsigned long)samples, (double)samples / SC7A20_ODR_HZ);
+    motion_replay(samples, replay_observe);
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+/* Light output and interrupt rate of the display driver.
+ *
+ *   sim/star_sim --pwm         software PWM, TIM2 interrupts every tick
+ *   sim/star_sim_hw --pwm      CHARLIE_HW_PWM, TIM1 interrupts per LED slot
+ *
+ * One second of display time with all LEDs multiplexed at different
+ * levels, in both PWM resolutions. The LED lit in every tick is read back
+ * from the charlie pins, its on-time must be exactly what the software
+ * PWM gives: slots per LED times min(level, period). Only one LED may be
+ * lit at a time. The interrupt rate must be one per tick in software and
+ * at most two per LED slot with the hardware timer.
+ */
+#include <stdio.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "fixmath.h"
+
+// Pin and LED tables of the driver, the sim only needs a few
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-const-variable"
+#define CHARLIE_TOPOLOGY_TABLES
+#include "charlie_topology.h"
+#pragma GCC diagnostic pop
+
+#define PWM_TICK_HZ     400000
+#define PWM_NONE        0xFF
+
+int sim_pin_level(uint8_t pin){
+    GPIO_TypeDef *port = charlie_ports[charlie_pins[pin].port];
+    int bit = __builtin_ctz(charlie_pins[pin].pin);
+
+    if (!((port->CFGLR >> (bit * 4)) & 0x3)) return -1;     // MODE 00 = input
+
+    return (port->OUTDR >> bit) & 1;
+}
+
+// LED lit by the pins, PWM_NONE if dark. Current flows from every high
+// to every low pin, more than one such pair counts as an error.
+uint8_t sim_lit_led(int *errors){
+    int high = -1, low = -1, highs = 0, lows = 0;
+
+    for (uint8_t pin = 0; pin < CHARLIE_NUM_PINS; pin++) {
+        int level = sim_pin_level(pin);
+
+        if (level == 1) {
+            high = pin;
+            highs++;
+        } else if (level == 0) {
+            low = pin;
+            lows++;
+        }
+    }
+    if (!highs || !lows) return PWM_NONE;
+    if (highs * lows > 1) (*errors)++;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        if (full_charlie_matrix[led].anode == high && full_charlie_matrix[led].cathode == low) return led;
+    }
+
+    return PWM_NONE;
+}
+
+static int pwm_run(uint8_t fast){
+    uint16_t period = fast ? 64 : 256;
+    uint32_t scans = PWM_TICK_HZ / (period * CHARLIE_NUM_LEDS);
+    uint32_t ticks = scans * period * CHARLIE_NUM_LEDS;
+    uint32_t all[CHARLIE_BITMASK_SIZE] = {0};
+    uint32_t on[CHARLIE_NUM_LEDS] = {0};
+    uint32_t irqs = 0;
+    int errors = 0, overlap = 0;
+
+    sim_reset();
+    charlie_init();
+    charlie_set_fast_pwm_mode(fast);
+    charlie_set_brightness(255);
+
+    uint8_t *levels = charlie_levels_back_buffer();
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        all[led / 32] |= 1UL << (led % 32);
+        levels[led] = led * 6 + 3;
+    }
+    charlie_present_levels();
+    charlie_enable_multiplex(all);
+
+    // multiplexing starts at a scan boundary, then a whole number of slots
+    // until the next period starts
+    for (uint32_t t = 0; t < 4 * period * CHARLIE_NUM_LEDS; t++) sim_tick();
+
+    for (uint32_t t = 0; t < ticks; t++) {
+        irqs += sim_tick();
+
+        uint8_t led = sim_lit_led(&overlap);
+        if (led != PWM_NONE) on[led]++;
+    }
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        uint8_t level = fx_scale8(255, led * 6 + 3);
+        uint32_t expect = scans * (level < period ? level : period);
+
+        if (on[led] != expect && errors++ < 5) {
+            printf("pwm: LED %u on for %lu ticks, expected %lu\n", led,
+                   (unsigned long)on[led], (unsigned long)expect);
+        }
+    }
+
+    uint32_t per_s = (uint32_t)((uint64_t)irqs * PWM_TICK_HZ / ticks);
+    uint32_t slots = PWM_TICK_HZ / period;
+
+#ifdef CHARLIE_HW_PWM
+    // one update per slot, plus the compare interrupt of LEDs without a channel pin
+    if (per_s < slots || per_s > 2 * slots) errors++;
+#else
+    if (per_s != PWM_TICK_HZ) errors++;
+#endif
+
+    printf("%-6u %-8lu %-9lu %-6lu %-8lu %s\n", period, (unsigned long)slots, (unsigned long)per_s,
+           (unsigned long)(PWM_TICK_HZ / (per_s ? per_s : 1)), (unsigned long)(on[0] + on[CHARLIE_NUM_LEDS - 1]),
+           errors || overlap ? "FAIL" : "ok");
+    if (overlap) printf("pwm: %d ticks with more than one LED driven\n", overlap);
+
+    return errors + overlap;
+}
+
+int sim_pwm(void){
+#ifdef CHARLIE_HW_PWM
+    printf("hardware PWM (TIM1), one second of display time\n");
+#else
+    printf("software PWM (TIM2), one second of display time\n");
+#endif
+    printf("period slots/s  irq/s     ticks/irq on(first+last)\n");
+
+    int errors = pwm_run(1) + pwm_run(0);
+
+    printf("pwm: %s\n", errors ? "FAIL" : "ok");
+
+    return errors != 0;
+}
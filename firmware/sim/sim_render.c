@@ -0,0 +1,120 @@
+/* What the eye sees of an animation, for tools/star_render.py.
+ *
+ *   sim/star_sim_hw --render ANIM [seconds] [fps]
+ *
+ * Plays one of the bench animations (sim_bench.c) at the frame period of
+ * the firmware main loop, on the driver with the firmware's settings
+ * (64-step PWM, brightness 40). Every video frame prints the share of
+ * the frame each LED was lit, from the per slot on-time counters of
+ * charlie_usage.h, so PWM duty and multiplex dimming are both in it:
+ *
+ *   frame <ms> <duty of LED 0> ... <duty of LED n-1>     duty in 1/65535
+ *
+ * star_sim_hw is the one to use: its display timer runs from event to
+ * event (sim_run) and renders well over 1000x real time. star_sim
+ * pumps the software PWM ISR every tick, same output, much slower.
+ * Both drivers give the same on-times (make check, --pwm).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "charlie_usage.h"
+
+#define RENDER_TICK_HZ      400000      // PWM ticks, CHARLIE_TICK_HZ in led_charlie.c
+#define RENDER_BRIGHTNESS   40          // src/main.c
+
+static void render_levels(const uint8_t *src){
+    uint8_t *levels = charlie_levels_back_buffer();
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) levels[led] = src ? src[led] : 255;
+    charlie_present_levels();
+}
+
+static uint32_t* render_next(const sim_anim *a){
+    uint32_t *pattern = a->next();
+    uint8_t *levels = sim_anim_levels();
+
+    if (levels) render_levels(levels);
+
+    return pattern;
+}
+
+static double render_seconds(void){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int sim_render(const char *name, double seconds, uint32_t fps){
+    static usage_data prev, now;
+    const sim_anim *a = sim_anim_find(name ? name : "");
+
+    if (!a) {
+        fprintf(stderr, "render: animations:");
+        sim_anim_list(stderr);
+        return 1;
+    }
+    if (!fps || fps > 1000) fps = 25;
+
+    const uint32_t frame_ticks = a->frame_ms * (RENDER_TICK_HZ / 1000);
+    const uint32_t video_ticks = RENDER_TICK_HZ / fps;
+    const uint64_t end = (uint64_t)(seconds * RENDER_TICK_HZ);
+    uint64_t t = 0, next_frame = frame_ticks, next_video = video_ticks;
+    uint32_t videos = 0;
+
+    sim_reset();
+    sim_host_time = 0;          // no perf timings wanted here
+    charlie_init();
+    charlie_set_fast_pwm_mode(1);
+    charlie_set_brightness(RENDER_BRIGHTNESS);
+    render_levels(0);
+    render_levels(0);
+    a->init();
+    charlie_enable_multiplex(render_next(a));
+
+    printf("# %s %.1fs %lu fps, %u LEDs\n", a->name, seconds, (unsigned long)fps, CHARLIE_NUM_LEDS);
+
+    double t0 = render_seconds();
+
+    usage_reset();
+    usage_snapshot(&prev);
+    while (next_video <= end) {
+        uint64_t stop = next_frame < next_video ? next_frame : next_video;
+
+        sim_run((uint32_t)(stop - t));
+        t = stop;
+
+        if (t == next_frame) {
+            charlie_update_multiplex_pattern(render_next(a));
+            next_frame += frame_ticks;
+        }
+        if (t == next_video) {
+            uint32_t ticks;
+
+            usage_snapshot(&now);
+            ticks = now.ticks - prev.ticks;
+            printf("frame %lu", (unsigned long)(t * 1000 / RENDER_TICK_HZ));
+            for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+                uint32_t on = now.on[led] - prev.on[led];
+
+                printf(" %lu", (unsigned long)(ticks ? (uint64_t)on * 65535 / ticks : 0));
+            }
+            printf("\n");
+            prev = now;
+            next_video += video_ticks;
+            videos++;
+        }
+    }
+
+    double took = render_seconds() - t0;
+
+    fprintf(stderr, "render: %s, %lu frames of %.1fs in %.2fs, %.0fx real time\n", a->name,
+            (unsigned long)videos, (double)t / RENDER_TICK_HZ, took, (double)t / RENDER_TICK_HZ / took);
+
+    return 0;
+}
@@ -0,0 +1,429 @@
+/* Ordering check of the driver command ring (led_charlie.h).
+ *
+ *   sim/star_sim --ring
+ *
+ * 1. Random posts interleaved with ISR ticks against a model of the ring:
+ *    commands apply in post order, never before their scan, and only at
+ *    a scan boundary. A full ring refuses the post.
+ * 2. The same ring with the ISR in a second thread, so posts really race
+ *    the drain: every brightness value must show up in order.
+ * 3. Batched mask updates against a model pattern, mixed with single LED
+ *    posts: compare and swap applies on an unchanged pattern and is
+ *    refused on a changed one. Then all LEDs flipped at once with the ISR
+ *    in a thread, it must never see half of an update.
+ * 4. Multiplexing ended by the ring while the scan searches for the next
+ *    LED: after charlie_disable_multiplex() the star stays dark, after
+ *    charlie_single() only that LED lights, for every single LED pattern.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "fixmath.h"
+
+#define RING_OPS        200000
+#define RING_THREAD_OPS 20000
+
+typedef struct {
+    uint8_t brightness;
+    uint8_t is_pattern;     // applies, but leaves the brightness
+    uint8_t timed;
+    uint32_t scan;
+} ring_model_cmd;
+
+static ring_model_cmd model[CHARLIE_CMD_RING_SIZE];
+static uint8_t model_head, model_tail;
+static int ring_errors;
+
+static void ring_pattern(uint32_t *pattern, uint8_t leds){
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) pattern[i] = 0;
+    for (uint8_t i = 0; i < leds; i++) {
+        uint8_t led = fx_range8(fx_rand8(), CHARLIE_NUM_LEDS);
+        pattern[led / 32] |= 1UL << (led % 32);
+    }
+}
+
+// Posts to the driver and the model, both have to agree on a full ring
+static uint8_t ring_post(const charlie_cmd *cmd, ring_model_cmd m){
+    uint8_t full = ((model_head + 1) & (CHARLIE_CMD_RING_SIZE - 1)) == model_tail;
+    uint8_t ok = charlie_try_post(cmd);
+
+    if (ok == full && ring_errors++ < 10) {
+        printf("ring: post %s with a %s ring\n", ok ? "accepted" : "refused", full ? "full" : "free");
+    }
+    if (ok) {
+        model[model_head] = m;
+        model_head = (model_head + 1) & (CHARLIE_CMD_RING_SIZE - 1);
+    }
+
+    return ok;
+}
+
+static int ring_model_run(void){
+    uint32_t pattern[CHARLIE_BITMASK_SIZE];
+    uint32_t posted = 0, refused = 0, applied = 0;
+    uint8_t expect;
+
+    sim_reset();
+    charlie_init();
+    charlie_set_fast_pwm_mode(1);
+    fx_srand(0xC0FFEE);
+
+    ring_pattern(pattern, 5);
+    charlie_enable_multiplex(pattern);
+    charlie_set_brightness(0);
+    for (int t = 0; t < 10000; t++) sim_tick();
+    expect = charlie_get_brightness();
+    model_head = model_tail = 0;
+    ring_errors = 0;
+
+    for (uint32_t op = 0; op < RING_OPS; op++) {
+        uint8_t r = fx_rand8();
+
+        if (r < 12) {
+            // brightness, a third of them for a scan a little ahead (or
+            // just behind), and now and then a new frame through the ring
+            ring_model_cmd m = {.brightness = fx_rand8()};
+            charlie_cmd cmd = {.type = CHARLIE_CMD_BRIGHTNESS, .arg = m.brightness};
+
+            if (r >= 11) {
+                m.is_pattern = 1;
+                cmd.type = CHARLIE_CMD_PATTERN;
+                ring_pattern(cmd.pattern, fx_range8(fx_rand8(), 8));
+            } else if (fx_rand8() < 85) {
+                m.timed = 1;
+                m.scan = charlie_scan_count() + fx_range8(fx_rand8(), 12) - 2;
+                cmd.flags = CHARLIE_CMD_AT_SCAN;
+                cmd.scan = m.scan;
+            }
+
+            if (ring_post(&cmd, m)) posted++;
+            else refused++;
+        } else {
+            uint32_t before = charlie_scan_count();
+
+            sim_tick();
+
+            uint32_t scans = charlie_scan_count();
+
+            // model drain: at every boundary, in order, stop at the first one not due
+            if (scans != before) {
+                while (model_tail != model_head) {
+                    ring_model_cmd *m = &model[model_tail];
+
+                    if (m->timed && (int32_t)(scans - m->scan) < 0) break;
+                    if (!m->is_pattern) expect = m->brightness;
+                    model_tail = (model_tail + 1) & (CHARLIE_CMD_RING_SIZE - 1);
+                    applied++;
+                }
+            }
+
+            if (charlie_get_brightness() != expect && ring_errors++ < 10) {
+                printf("ring: scan %lu brightness %u, expected %u%s\n", (unsigned long)scans,
+                       charlie_get_brightness(), expect, scans == before ? " (no boundary)" : "");
+            }
+        }
+    }
+
+    printf("ring model: %lu posted, %lu refused (full), %lu applied, %d errors\n",
+           (unsigned long)posted, (unsigned long)refused, (unsigned long)applied, ring_errors);
+
+    return ring_errors;
+}
+
+// --- Producer and ISR on two threads ---
+
+static volatile int ring_thread_done;
+static volatile int ring_thread_errors;
+
+// One core in the sandbox too: the drain is done at a scan boundary, let
+// the producer refill the ring instead of ticking out the time slice
+static void ring_thread_tick(void){
+    uint32_t scan = charlie_scan_count();
+
+    sim_tick();
+    if (charlie_scan_count() != scan) sched_yield();
+}
+
+static void *ring_isr_thread(void *arg){
+    uint8_t last = charlie_get_brightness();
+    (void)arg;
+
+    while (!ring_thread_done) {
+        ring_thread_tick();
+
+        uint8_t now = charlie_get_brightness();
+        uint8_t step = now - last;
+
+        // several can land at one boundary, never more than the ring holds
+        if (step >= CHARLIE_CMD_RING_SIZE) ring_thread_errors++;
+        last = now;
+    }
+
+    return 0;
+}
+
+static int ring_thread_run(void){
+    pthread_t isr;
+
+    sim_reset();
+    charlie_init();
+    charlie_set_fast_pwm_mode(1);
+    {
+        uint32_t pattern[CHARLIE_BITMASK_SIZE];
+
+        fx_srand(0xBEEF);
+        ring_pattern(pattern, 3);
+        charlie_enable_multiplex(pattern);
+    }
+    charlie_set_brightness(0);
+    for (int t = 0; t < 10000; t++) sim_tick();
+
+    ring_thread_done = 0;
+    ring_thread_errors = 0;
+    pthread_create(&isr, 0, ring_isr_thread, 0);
+
+    for (uint32_t i = 1; i <= RING_THREAD_OPS; i++) {
+        charlie_set_brightness((uint8_t)i);
+    }
+    charlie_sync();
+
+    ring_thread_done = 1;
+    pthread_join(isr, 0);
+
+    uint8_t final = charlie_get_brightness();
+    int errors = ring_thread_errors + (final != (uint8_t)RING_THREAD_OPS);
+
+    printf("ring threads: %d posts, final brightness %u (expected %u), %d order errors\n",
+           RING_THREAD_OPS, final, (uint8_t)RING_THREAD_OPS, ring_thread_errors);
+
+    return errors;
+}
+
+// --- Batched mask updates ---
+
+#define RING_MASK_OPS   4000
+
+static void ring_masks_random(charlie_masks *m){
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        m->set[i] = m->clear[i] = m->toggle[i] = 0;
+    }
+    for (uint8_t i = fx_range8(fx_rand8(), 12); i; i--) {
+        uint8_t led = fx_range8(fx_rand8(), CHARLIE_NUM_LEDS);
+        uint8_t r = fx_rand8();
+        uint32_t *mask = r < 85 ? m->set : r < 170 ? m->clear : m->toggle;
+
+        mask[led / 32] |= 1UL << (led % 32);
+    }
+}
+
+static void ring_masks_model(uint32_t *pattern, const charlie_masks *m){
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        pattern[i] = ((pattern[i] | m->set[i]) & ~m->clear[i]) ^ m->toggle[i];
+    }
+    if (CHARLIE_NUM_LEDS % 32) pattern[CHARLIE_BITMASK_SIZE - 1] &= (1UL << (CHARLIE_NUM_LEDS % 32)) - 1;
+}
+
+// Single threaded, the ISR drains at the next scan boundary
+static void ring_settle(void){
+    uint32_t scan = charlie_scan_count();
+
+    while (charlie_scan_count() - scan < 2) sim_tick();
+}
+
+static int ring_masks_check(const uint32_t *expect, uint32_t op){
+    uint32_t shown[CHARLIE_BITMASK_SIZE];
+    int errors = 0;
+
+    charlie_get_pattern(shown);
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        if (shown[i] != expect[i] && errors++ < 1) {
+            printf("ring masks: op %lu word %d is %08lx, expected %08lx\n", (unsigned long)op, i,
+                   (unsigned long)shown[i], (unsigned long)expect[i]);
+        }
+    }
+
+    return errors;
+}
+
+static volatile uint32_t ring_torn;
+
+static void *ring_masks_isr_thread(void *arg){
+    uint32_t shown[CHARLIE_BITMASK_SIZE];
+    (void)arg;
+
+    while (!ring_thread_done) {
+        ring_thread_tick();
+        charlie_get_pattern(shown);
+
+        // all on or all off, anything else is a torn update
+        for (int i = 1; i < CHARLIE_BITMASK_SIZE; i++) {
+            if ((shown[i] != 0) != (shown[0] != 0)) ring_torn++;
+        }
+    }
+
+    return 0;
+}
+
+static int ring_masks_run(void){
+    uint32_t expect[CHARLIE_BITMASK_SIZE];
+    uint32_t applied = 0, swapped = 0, refused = 0;
+    int errors = 0;
+    charlie_masks m;
+
+    sim_reset();
+    charlie_init();
+    charlie_set_fast_pwm_mode(1);
+    fx_srand(0xF00D);
+    ring_pattern(expect, 6);
+    charlie_enable_multiplex(expect);
+    ring_settle();
+
+    for (uint32_t op = 0; op < RING_MASK_OPS && errors < 5; op++) {
+        uint8_t r = fx_rand8();
+
+        // no ISR thread here, charlie_apply_masks() must find the ring free
+        ring_settle();
+        ring_masks_random(&m);
+        if (r < 96) {
+            charlie_apply_masks(&m);
+            ring_masks_model(expect, &m);
+            applied++;
+        } else {
+            // compare and swap, a third of them raced by a single LED
+            uint32_t version = charlie_pattern_version();
+            uint32_t before = charlie_masks_refused();
+            uint8_t raced = r >= 176;
+
+            if (raced) {
+                uint8_t led = fx_range8(fx_rand8(), CHARLIE_NUM_LEDS);
+                uint8_t on = fx_rand8() & 1;
+
+                charlie_set_led(led, on);
+                if (on) expect[led / 32] |= 1UL << (led % 32);
+                else expect[led / 32] &= ~(1UL << (led % 32));
+            }
+            if (!charlie_try_apply_masks_if(&m, version)) {
+                printf("ring masks: op %lu compare and swap refused by a free ring\n", (unsigned long)op);
+                errors++;
+            }
+            ring_settle();
+            if (charlie_masks_refused() - before != raced) {
+                printf("ring masks: op %lu compare and swap %s\n", (unsigned long)op,
+                       raced ? "applied on a changed pattern" : "refused on an unchanged one");
+                errors++;
+            }
+            if (!raced) ring_masks_model(expect, &m);
+            if (raced) refused++;
+            else swapped++;
+        }
+        if (fx_rand8() < 64) {
+            ring_settle();
+            errors += ring_masks_check(expect, op);
+        }
+    }
+    ring_settle();
+    errors += ring_masks_check(expect, RING_MASK_OPS);
+
+    printf("ring masks: %lu applied, %lu swapped, %lu refused, %d errors\n", (unsigned long)applied,
+           (unsigned long)swapped, (unsigned long)refused, errors);
+
+    // every LED flipped in one update, racing the ISR thread
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        m.set[i] = m.toggle[i] = 0;
+        m.clear[i] = 0xFFFFFFFFUL;
+    }
+    charlie_apply_masks(&m);
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) {
+        m.clear[i] = 0;
+        m.toggle[i] = 0xFFFFFFFFUL;
+    }
+    ring_settle();
+
+    ring_torn = 0;
+    ring_thread_done = 0;
+    pthread_t isr;
+    pthread_create(&isr, 0, ring_masks_isr_thread, 0);
+    for (uint32_t i = 0; i < RING_THREAD_OPS; i++) charlie_apply_masks(&m);
+    charlie_sync();
+    ring_thread_done = 1;
+    pthread_join(isr, 0);
+
+    charlie_get_pattern(expect);
+    printf("ring masks threads: %d flips, %lu torn, star %s (expected off)\n", RING_THREAD_OPS,
+           (unsigned long)ring_torn, expect[0] ? "on" : "off");
+
+    return errors + (ring_torn != 0) + (expect[0] != 0);
+}
+
+// --- Multiplexing ended from the ring ---
+
+#define RING_OFF_TICKS  5000
+#define RING_DARK       0xFF
+
+// LED lit over RING_OFF_TICKS once the ring is drained, RING_DARK if none.
+// Counts every tick another LED shows.
+static uint8_t ring_lit_after(uint8_t expect, int *errors){
+    int overlap = 0;
+    uint8_t seen = RING_DARK;
+
+    ring_settle();
+    for (int t = 0; t < RING_OFF_TICKS; t++) {
+        uint8_t led = sim_lit_led(&overlap);
+
+        sim_tick();
+        if (led == RING_DARK) continue;
+        if (led != expect) (*errors)++;
+        seen = led;
+    }
+
+    return seen;
+}
+
+static int ring_off_run(void){
+    uint32_t pattern[CHARLIE_BITMASK_SIZE];
+    int off_lit = 0, single_wrong = 0, single_dark = 0;
+
+    sim_reset();
+    charlie_init();
+    charlie_set_brightness(255);
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        uint8_t other = led ? led - 1 : CHARLIE_NUM_LEDS - 1;
+
+        // one LED, so most searches run through the end of a scan
+        for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) pattern[i] = 0;
+        pattern[led / 32] = 1UL << (led % 32);
+        charlie_set_fast_pwm_mode(led & 1);
+        charlie_enable_multiplex(pattern);
+        ring_settle();
+
+        charlie_disable_multiplex();
+        if (ring_lit_after(RING_DARK, &off_lit) != RING_DARK && off_lit < 10) {
+            printf("ring off: LED %u lit after charlie_disable_multiplex\n", led);
+        }
+
+        charlie_enable_multiplex(pattern);
+        ring_settle();
+        charlie_single(other, 1);
+        if (ring_lit_after(other, &single_wrong) != other) single_dark++;
+        charlie_single(other, 0);
+        ring_lit_after(RING_DARK, &single_wrong);
+    }
+
+    printf("ring off: %u patterns, %d ticks lit after disable, %d ticks of another LED with single, "
+           "%d singles dark\n", CHARLIE_NUM_LEDS, off_lit, single_wrong, single_dark);
+
+    return off_lit + single_wrong + single_dark;
+}
+
+int sim_ring(void){
+    int errors = ring_model_run() + ring_thread_run() + ring_masks_run() + ring_off_run();
+
+    printf("ring: %s\n", errors ? "FAIL" : "ok");
+
+    return errors != 0;
+}
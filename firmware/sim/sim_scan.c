@@ -0,0 +1,140 @@
+/* Pin changes of the two multiplex scan orders.
+ *
+ *   sim/star_sim --scan        software PWM, cathode only release
+ *   sim/star_sim_hw --scan     CHARLIE_HW_PWM, only the order changes
+ *
+ * Every pattern is shown in LED order (CHARLIE_SCAN_INDEX) and in the
+ * generated order (CHARLIE_SCAN_PINS) for a whole number of scans. Each
+ * tick the charlie pins are read back, every pin whose driven level
+ * changed counts, and so does every tick lit per LED. Both orders must give each
+ * LED exactly the on-time of the software PWM with one LED lit at a time;
+ * scanning by pins must not change more pins, and with software PWM fewer.
+ */
+#include <stdio.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "fixmath.h"
+
+#define SCAN_PERIOD     64      // fast PWM mode
+#define SCAN_SCANS      20
+#define SCAN_NONE       0xFF
+
+typedef struct {
+    uint32_t changes;
+    uint32_t slots;
+    int errors;
+} scan_result;
+
+static uint8_t scan_level(uint8_t led){
+    return led * 6 + 3;
+}
+
+static scan_result scan_run(const uint32_t *pattern, uint8_t order){
+    uint32_t on[CHARLIE_NUM_LEDS] = {0};
+    int8_t pins[CHARLIE_NUM_PINS];
+    uint32_t enabled = 0;
+    scan_result r = {0};
+    int overlap = 0;
+
+    sim_reset();
+    charlie_init();
+    charlie_set_fast_pwm_mode(1);
+    charlie_set_brightness(255);
+    charlie_set_scan_order(order);
+
+    uint8_t *levels = charlie_levels_back_buffer();
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        levels[led] = scan_level(led);
+        if (pattern[led / 32] & (1UL << (led % 32))) enabled++;
+    }
+    charlie_present_levels();
+    charlie_enable_multiplex(pattern);
+
+    // whole slots from the multiplex start, any run of enabled slots has each LED once
+    for (uint32_t t = 0; t < 4 * SCAN_PERIOD * CHARLIE_NUM_LEDS; t++) sim_tick();
+
+    for (uint8_t pin = 0; pin < CHARLIE_NUM_PINS; pin++) pins[pin] = sim_pin_level(pin);
+
+    for (uint32_t t = 0; t < SCAN_SCANS * SCAN_PERIOD * enabled; t++) {
+        sim_tick();
+
+        for (uint8_t pin = 0; pin < CHARLIE_NUM_PINS; pin++) {
+            int8_t level = sim_pin_level(pin);
+
+            if (level != pins[pin]) r.changes++;
+            pins[pin] = level;
+        }
+
+        uint8_t led = sim_lit_led(&overlap);
+        if (led != SCAN_NONE) on[led]++;
+    }
+    r.slots = SCAN_SCANS * enabled;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        uint8_t level = fx_scale8(255, scan_level(led));
+        uint32_t expect = 0;
+
+        if (pattern[led / 32] & (1UL << (led % 32))) expect = SCAN_SCANS * (level < SCAN_PERIOD ? level : SCAN_PERIOD);
+        if (on[led] != expect && r.errors++ < 5) {
+            printf("scan: LED %u on for %lu ticks, expected %lu\n", led,
+                   (unsigned long)on[led], (unsigned long)expect);
+        }
+    }
+    if (overlap) {
+        printf("scan: %d ticks with more than one LED driven\n", overlap);
+        r.errors++;
+    }
+
+    return r;
+}
+
+static int scan_pattern(const char *name, const uint32_t *pattern){
+    scan_result by_index = scan_run(pattern, CHARLIE_SCAN_INDEX);
+    scan_result by_pins = scan_run(pattern, CHARLIE_SCAN_PINS);
+    int errors = by_index.errors + by_pins.errors;
+
+#ifdef CHARLIE_HW_PWM
+    if (by_pins.changes > by_index.changes) errors++;
+#else
+    if (by_pins.changes >= by_index.changes) errors++;
+#endif
+
+    // changes per slot in hundredths
+    printf("%-8s %-6lu %-10lu %-10lu %s\n", name, (unsigned long)by_index.slots,
+           (unsigned long)(by_index.changes * 100 / by_index.slots),
+           (unsigned long)(by_pins.changes * 100 / by_pins.slots), errors ? "FAIL" : "ok");
+
+    return errors;
+}
+
+int sim_scan(void){
+    uint32_t all[CHARLIE_BITMASK_SIZE] = {0};
+    uint32_t half[CHARLIE_BITMASK_SIZE] = {0};
+    uint32_t sparse[CHARLIE_BITMASK_SIZE] = {0};
+    uint32_t seed = 0x2545F491;
+    int errors = 0;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        all[led / 32] |= 1UL << (led % 32);
+        seed = seed * 1103515245 + 12345;
+        if (seed & 0x10000) half[led / 32] |= 1UL << (led % 32);
+        if (led % 5 == 2) sparse[led / 32] |= 1UL << (led % 32);
+    }
+
+#ifdef CHARLIE_HW_PWM
+    printf("hardware PWM (TIM1), %u scans per pattern\n", SCAN_SCANS);
+#else
+    printf("software PWM (TIM2), %u scans per pattern\n", SCAN_SCANS);
+#endif
+    printf("pattern  slots  index/100  pins/100   (pin changes per LED slot)\n");
+
+    errors += scan_pattern("all", all);
+    errors += scan_pattern("half", half);
+    errors += scan_pattern("sparse", sparse);
+
+    printf("scan: %s\n", errors ? "FAIL" : "ok");
+
+    return errors != 0;
+}
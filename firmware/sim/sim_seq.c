@@ -0,0 +1,163 @@
+/* Protothread sequences of the animations (anim_seq.h).
+ *
+ *   sim/star_sim --seq
+ *
+ * Test sequences log the frame tick of every point they reach, stepped
+ * once per tick like the show animation does:
+ *   SEQ_WAIT(n) resumes exactly n ticks later, SEQ_WAIT(0) not at all,
+ *   SEQ_WAIT_TRIGGER takes only its own bits, a pending one passes at once,
+ *   SEQ_RUN steps the child from its top on the same tick and goes on the
+ *   tick the child ends, SEQ_RESTART starts over on the next tick,
+ *   SEQ_EXIT returns ANIM_SEQ_DONE and no step calls the sequence after.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+#include "anim_seq.h"
+
+#define SEQ_LOG_MAX     32
+#define SEQ_TICKS       40
+#define SEQ_BIT_GO      0x01
+#define SEQ_BIT_OTHER   0x02
+
+static uint16_t seq_tick;
+static uint16_t seq_log[SEQ_LOG_MAX];
+static uint8_t seq_logged;
+static uint16_t seq_calls;
+static int seq_errors;
+static anim_seq seq_child;
+
+static void seq_mark(void){
+    if (seq_logged < SEQ_LOG_MAX) seq_log[seq_logged++] = seq_tick;
+}
+
+static void seq_fail(const char *what, long got, long expected){
+    if (seq_errors++ < 10) printf("seq: %s: %ld, expected %ld\n", what, got, expected);
+}
+
+// Steps s once per tick from tick 0 until it is done or SEQ_TICKS
+static uint16_t seq_run(anim_seq *s, anim_seq_fn fn, uint8_t trigger_at, uint8_t bits){
+    anim_seq_start(s, fn);
+    seq_logged = 0;
+    seq_calls = 0;
+
+    for (seq_tick = 0; seq_tick < SEQ_TICKS; seq_tick++) {
+        if (bits && seq_tick == trigger_at) anim_seq_trigger(s, bits);
+        if (anim_seq_step(s) == ANIM_SEQ_DONE) break;
+    }
+
+    return seq_tick;
+}
+
+static void seq_expect_log(const char *name, const uint16_t *expect, uint8_t n){
+    if (seq_logged != n) seq_fail(name, seq_logged, n);
+    for (uint8_t i = 0; i < n && i < seq_logged; i++) {
+        if (seq_log[i] != expect[i]) seq_fail(name, seq_log[i], expect[i]);
+    }
+}
+
+static uint8_t seq_waits(anim_seq *s){
+    seq_calls++;
+    SEQ_BEGIN(s);
+    seq_mark();
+    SEQ_WAIT(s, 3);
+    seq_mark();
+    SEQ_WAIT(s, 0);
+    seq_mark();
+    SEQ_WAIT(s, 1);
+    seq_mark();
+    SEQ_YIELD(s);
+    seq_mark();
+    SEQ_END(s);
+}
+
+static uint8_t seq_triggers(anim_seq *s){
+    SEQ_BEGIN(s);
+    seq_mark();
+    SEQ_WAIT_TRIGGER(s, SEQ_BIT_GO);
+    seq_mark();
+    // OTHER stays pending, GO was taken
+    if (anim_seq_take(s, SEQ_BIT_OTHER)) seq_mark();
+    SEQ_WAIT_TRIGGER(s, SEQ_BIT_GO);
+    seq_mark();
+    SEQ_END(s);
+}
+
+static uint8_t seq_child_fn(anim_seq *s){
+    SEQ_BEGIN(s);
+    seq_mark();
+    SEQ_WAIT(s, 2);
+    seq_mark();
+    SEQ_END(s);
+}
+
+static uint8_t seq_parent(anim_seq *s){
+    SEQ_BEGIN(s);
+    seq_mark();
+    SEQ_YIELD(s);
+    SEQ_RUN(s, &seq_child, seq_child_fn);
+    seq_mark();
+    SEQ_EXIT(s);
+    seq_mark();     // never reached
+    SEQ_END(s);
+}
+
+static uint8_t seq_restarts(anim_seq *s){
+    SEQ_BEGIN(s);
+    seq_mark();
+    if (s->i++ < 2) SEQ_RESTART(s);
+    SEQ_YIELD(s);
+    seq_mark();
+    SEQ_END(s);
+}
+
+int sim_seq(void){
+    anim_seq s;
+    uint16_t end;
+
+    // tick 0, +3, +0, +1, yield +1, then off the end
+    static const uint16_t waits[] = {0, 3, 3, 4, 5};
+    end = seq_run(&s, seq_waits, 0, 0);
+    seq_expect_log("SEQ_WAIT tick", waits, 5);
+    if (end != 5) seq_fail("SEQ_WAIT sequence done at tick", end, 5);
+    if (seq_calls != 4) seq_fail("calls through the waits", seq_calls, 4);
+
+    // GO and OTHER at tick 4: the first wait passes there, OTHER is still
+    // pending after it, the second wait never gets a GO
+    static const uint16_t triggers[] = {0, 4, 4};
+    end = seq_run(&s, seq_triggers, 4, SEQ_BIT_GO | SEQ_BIT_OTHER);
+    seq_expect_log("SEQ_WAIT_TRIGGER tick", triggers, 3);
+    if (end != SEQ_TICKS) seq_fail("SEQ_WAIT_TRIGGER without trigger done at tick", end, SEQ_TICKS);
+    if (s.triggers) seq_fail("trigger bits left", s.triggers, 0);
+
+    // a GO before the wait passes at once
+    static const uint16_t pending[] = {0, 0, 0};
+    anim_seq_start(&s, seq_triggers);
+    anim_seq_trigger(&s, SEQ_BIT_GO | SEQ_BIT_OTHER);
+    seq_logged = 0;
+    seq_tick = 0;
+    anim_seq_step(&s);
+    seq_expect_log("pending SEQ_WAIT_TRIGGER tick", pending, 3);
+
+    // parent at 0, child from its top at 1, child ends at 3, parent on at 3
+    static const uint16_t run[] = {0, 1, 3, 3};
+    end = seq_run(&s, seq_parent, 0, 0);
+    seq_expect_log("SEQ_RUN tick", run, 4);
+    if (end != 3) seq_fail("SEQ_EXIT returned ANIM_SEQ_DONE at tick", end, 3);
+    if (anim_seq_running(&s)) seq_fail("running after SEQ_EXIT", 1, 0);
+    if (anim_seq_running(&seq_child)) seq_fail("child running after SEQ_RUN", 1, 0);
+    if (anim_seq_step(&s) != ANIM_SEQ_DONE) seq_fail("step after SEQ_EXIT", 1, 0);
+    if (seq_logged != 4) seq_fail("marks after SEQ_EXIT", seq_logged, 4);
+
+    // top at 0, 1, 2 (two restarts), then yield and the end at 3
+    static const uint16_t restarts[] = {0, 1, 2, 3};
+    end = seq_run(&s, seq_restarts, 0, 0);
+    seq_expect_log("SEQ_RESTART tick", restarts, 4);
+    if (end != 3) seq_fail("SEQ_RESTART sequence done at tick", end, 3);
+
+    printf("waits, triggers, child run, exit, restart\n");
+    printf("seq: %s\n", seq_errors ? "FAIL" : "ok");
+
+    return seq_errors != 0;
+}
@@ -0,0 +1,160 @@
+/* Stream receiver against a main loop presenting frames of its own.
+ *
+ *   sim/star_sim --stream
+ *
+ * Packets are fed byte by byte into the USART1 DMA. A frame payload lands
+ * in the back buffer chosen at its header: with nothing else going on it
+ * is swapped in; when the main loop presents that buffer halfway through
+ * the payload, the packet is dropped and nothing is swapped after it, the
+ * main loop's frame stays the one on display. A bad checksum shows nothing.
+ *
+ * Presents against the driver's command ring: a main loop pattern still
+ * in the ring when a host pattern is presented must not overwrite it, a
+ * level command lands in the levels presented before it applies.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "uart_stream.h"
+
+#define STREAM_RING_TICKS   (4 * 256)    // a few PWM periods, each drains the ring
+
+static int stream_errors;
+
+static void stream_check(int ok, const char *what){
+    if (!ok && stream_errors++ < 10) printf("stream: %s\n", what);
+}
+
+static void stream_send_bytes(const uint8_t *data, uint8_t len){
+    for (uint8_t i = 0; i < len; i++) sim_uart_rx(data[i]);
+}
+
+static void stream_send_header(uint8_t cmd, const uint8_t *payload, uint8_t len){
+    uint8_t header[STREAM_HEADER_SIZE] = {STREAM_SYNC, cmd, len, 0};
+
+    for (uint8_t i = 0; i < len; i++) header[3] += payload[i];
+    stream_send_bytes(header, STREAM_HEADER_SIZE);
+}
+
+static void stream_levels(uint8_t *levels, uint8_t seed){
+    for (uint8_t i = 0; i < CHARLIE_NUM_LEDS; i++) levels[i] = seed + i * 7;
+}
+
+// What the main loop does for a smooth animation: fill the back buffer, present
+static void stream_main_frame(uint8_t level){
+    uint8_t *levels = charlie_levels_back_buffer();
+
+    memset(levels, level, CHARLIE_NUM_LEDS);
+    charlie_present_levels();
+}
+
+int sim_stream(void){
+    uint8_t host[CHARLIE_NUM_LEDS];
+    uint8_t main_frame[CHARLIE_NUM_LEDS];
+    stream_stats before, after;
+    uint8_t *dst, *back;
+
+    sim_reset();
+    charlie_init();
+    stream_init(115200);
+    stream_get_stats(&before);
+
+    // a frame on its own is swapped in
+    stream_levels(host, 1);
+    dst = charlie_levels_back_buffer();
+    stream_send_header(STREAM_CMD_LEVELS, host, CHARLIE_NUM_LEDS);
+    stream_send_bytes(host, CHARLIE_NUM_LEDS);
+    stream_get_stats(&after);
+    stream_check(after.packets == before.packets + 1, "levels packet not applied");
+    stream_check(charlie_levels_back_buffer() != dst, "levels packet not presented");
+    stream_check(!memcmp(dst, host, CHARLIE_NUM_LEDS), "levels packet shows other levels");
+    printf("levels packet: %s\n", after.packets == before.packets + 1 ? "presented" : "lost");
+    before = after;
+
+    // the main loop presents the payload's buffer while it comes in
+    stream_levels(host, 50);
+    memset(main_frame, 200, CHARLIE_NUM_LEDS);
+    dst = charlie_levels_back_buffer();
+    stream_send_header(STREAM_CMD_LEVELS, host, CHARLIE_NUM_LEDS);
+    stream_send_bytes(host, CHARLIE_NUM_LEDS / 2);
+    stream_main_frame(200);
+    back = charlie_levels_back_buffer();
+    stream_check(back != dst, "main loop frame not presented");
+    stream_send_bytes(host + CHARLIE_NUM_LEDS / 2, CHARLIE_NUM_LEDS - CHARLIE_NUM_LEDS / 2);
+    stream_get_stats(&after);
+    stream_check(after.dropped == before.dropped + 1, "packet into a presented buffer not dropped");
+    stream_check(after.packets == before.packets, "packet into a presented buffer applied");
+    stream_check(charlie_levels_back_buffer() == back, "stale buffer presented after the packet");
+    stream_check(!memcmp(dst, main_frame, CHARLIE_NUM_LEDS / 2), "main loop frame overwritten");
+    printf("levels packet, main loop presents meanwhile: %s\n",
+           after.dropped == before.dropped + 1 ? "dropped" : "applied");
+    before = after;
+
+    // the next packet after a drop goes into the new back buffer
+    stream_levels(host, 99);
+    stream_send_header(STREAM_CMD_LEVELS, host, CHARLIE_NUM_LEDS);
+    stream_send_bytes(host, CHARLIE_NUM_LEDS);
+    stream_get_stats(&after);
+    stream_check(after.packets == before.packets + 1, "packet after a drop not applied");
+    stream_check(charlie_levels_back_buffer() == dst, "packet after a drop not presented");
+    stream_check(!memcmp(back, host, CHARLIE_NUM_LEDS), "packet after a drop shows other levels");
+    before = after;
+
+    // a bad checksum shows nothing
+    dst = charlie_levels_back_buffer();
+    stream_send_header(STREAM_CMD_LEVELS, host, CHARLIE_NUM_LEDS);
+    host[3]++;
+    stream_send_bytes(host, CHARLIE_NUM_LEDS);
+    stream_get_stats(&after);
+    stream_check(after.bad_sum == before.bad_sum + 1, "bad checksum not counted");
+    stream_check(charlie_levels_back_buffer() == dst, "bad checksum presented");
+    printf("levels packet, bad checksum: %s\n", after.bad_sum == before.bad_sum + 1 ? "ignored" : "applied");
+    before = after;
+
+    // pattern frames switch to the live animation
+    uint32_t pattern[CHARLIE_BITMASK_SIZE];
+    uint32_t shown[CHARLIE_BITMASK_SIZE];
+
+    for (int i = 0; i < CHARLIE_BITMASK_SIZE; i++) pattern[i] = 0x5A5A5A5AUL >> i;
+    stream_set_anim(1);
+    stream_send_header(STREAM_CMD_PATTERN, (const uint8_t*)pattern, sizeof(pattern));
+    stream_send_bytes((const uint8_t*)pattern, sizeof(pattern));
+    charlie_get_pattern(shown);
+    stream_check(!memcmp(shown, pattern, sizeof(pattern)), "pattern packet not shown");
+    stream_check(stream_anim() == STREAM_ANIM_LIVE, "pattern packet did not go live");
+
+    // the last main loop frame is still in the ring when the host's first one comes
+    uint32_t main_pattern[CHARLIE_BITMASK_SIZE] = {0x0F0F0F0FUL};
+
+    stream_set_anim(1);
+    charlie_update_multiplex_pattern(main_pattern);
+    pattern[0] ^= 0xFFFF;
+    stream_send_header(STREAM_CMD_PATTERN, (const uint8_t*)pattern, sizeof(pattern));
+    stream_send_bytes((const uint8_t*)pattern, sizeof(pattern));
+    sim_run(STREAM_RING_TICKS);
+    charlie_get_pattern(shown);
+    stream_check(!memcmp(shown, pattern, sizeof(pattern)), "queued main loop pattern overwrote the host frame");
+    printf("pattern packet, main loop frame in the ring: %s\n",
+           memcmp(shown, pattern, sizeof(pattern)) ? "overwritten" : "kept");
+
+    // without a present in between the main loop frame shows
+    charlie_update_multiplex_pattern(main_pattern);
+    sim_run(STREAM_RING_TICKS);
+    charlie_get_pattern(shown);
+    stream_check(!memcmp(shown, main_pattern, sizeof(main_pattern)), "main loop pattern not shown");
+
+    // a level command applies to the levels shown at the time
+    uint8_t *front;
+
+    charlie_set_led_level(5, 77);
+    front = charlie_levels_back_buffer();
+    stream_main_frame(10);
+    sim_run(STREAM_RING_TICKS);
+    stream_check(front[5] == 77 && front[4] == 10, "level command missed the presented levels");
+
+    printf("stream: %s\n", stream_errors ? "FAIL" : "ok");
+
+    return stream_errors != 0;
+}
@@ -0,0 +1,207 @@
+/* Generated charlie tables against the pin list they came from.
+ *
+ *   sim/star_sim --topology       charlie_topology.h
+ *   sim/star_sim_hw --topology    also the TIM1 channel table
+ *
+ * The pin list is read from custom_charlie_pins in ../platformio.ini, the
+ * same line tools/gen_charlie_topology.py generated the header from, or
+ * from SIM_TOPO_PINS for the second pin list of star_sim_2port. Every
+ * LED is lit from charlie_led_regs_table on the sim ports: its anode must
+ * read high, its cathode low and every other charlie pin float, with the
+ * CFGLR bits of other pins untouched. The matrix must hold every ordered
+ * pin pair once and the scan order every LED once.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-const-variable"
+#define CHARLIE_TOPOLOGY_TABLES
+#include "charlie_topology.h"
+#pragma GCC diagnostic pop
+
+#define TOPO_INI        "../platformio.ini"
+#define TOPO_KEY        "custom_charlie_pins"
+#define TOPO_MAX_PINS   24
+#define TOPO_OTHER      0x88888888UL    // input pull, in the nibbles of other pins
+#define CFG_AF_PP       0xB
+
+typedef struct {
+    char port;
+    uint8_t bit;
+} topo_pin;
+
+// Pin names like PC3 separated by blanks
+static int topo_parse_pins(char *list, topo_pin *pins){
+    int n = 0;
+
+    for (char *tok = strtok(list, " \t\r\n"); tok && n < TOPO_MAX_PINS; tok = strtok(0, " \t\r\n")) {
+        pins[n].port = tok[1];
+        pins[n].bit = tok[2] - '0';
+        n++;
+    }
+
+    return n;
+}
+
+// First active custom_charlie_pins line (or SIM_TOPO_PINS), 0 if there is none
+static int topo_read_pins(topo_pin *pins){
+#ifdef SIM_TOPO_PINS
+    char list[] = SIM_TOPO_PINS;
+
+    return topo_parse_pins(list, pins);
+#else
+    FILE *f = fopen(TOPO_INI, "r");
+    char line[256];
+    int n = 0;
+
+    if (!f) {
+        perror(TOPO_INI);
+        return 0;
+    }
+    while (!n && fgets(line, sizeof(line), f)) {
+        char *p = line + strspn(line, " \t");
+
+        if (strncmp(p, TOPO_KEY, strlen(TOPO_KEY))) continue;
+        p = strchr(p, '=');
+        if (p) n = topo_parse_pins(p + 1, pins);
+    }
+    fclose(f);
+
+    return n;
+#endif
+}
+
+static GPIO_TypeDef *topo_port(char port){
+    return port == 'A' ? GPIOA : port == 'C' ? GPIOC : port == 'D' ? GPIOD : 0;
+}
+
+static void topo_fail(int *errors, const char *what, int i){
+    if ((*errors)++ < 10) printf("topology: %s (%d)\n", what, i);
+}
+
+// Ports with every charlie pin floating and the others on TOPO_OTHER
+static void topo_ports_reset(void){
+    for (int p = 0; p < CHARLIE_NUM_PORTS; p++) {
+        GPIO_TypeDef *port = charlie_ports[p];
+
+        port->CFGLR = (TOPO_OTHER & ~charlie_cfg_mask[p]) | charlie_cfg_tri[p];
+        port->OUTDR = 0x55;
+        port->BSHR = 0;
+    }
+}
+
+static void topo_check_lit(uint8_t led, int *errors){
+    const charlie_led_config *m = &full_charlie_matrix[led];
+
+    for (int p = 0; p < CHARLIE_NUM_PORTS; p++) {
+        if ((charlie_ports[p]->CFGLR & ~charlie_cfg_mask[p]) != (TOPO_OTHER & ~charlie_cfg_mask[p])) {
+            topo_fail(errors, "LED touches CFGLR bits of other pins", led);
+        }
+    }
+    for (uint8_t pin = 0; pin < CHARLIE_NUM_PINS; pin++) {
+        int expect = pin == m->anode ? 1 : pin == m->cathode ? 0 : -1;
+
+        if (sim_pin_level(pin) != expect) topo_fail(errors, "LED drives the wrong pins", led);
+    }
+}
+
+int sim_topology(void){
+    topo_pin pins[TOPO_MAX_PINS];
+    int n = topo_read_pins(pins);
+    int errors = 0;
+
+    printf("%s = %d pins, %u LEDs on %u ports\n", TOPO_KEY, n, CHARLIE_NUM_LEDS, CHARLIE_NUM_PORTS);
+    if (n != CHARLIE_NUM_PINS) topo_fail(&errors, "pin count differs from " TOPO_INI, n);
+    if (CHARLIE_NUM_LEDS != CHARLIE_NUM_PINS * (CHARLIE_NUM_PINS - 1)) topo_fail(&errors, "LED count", CHARLIE_NUM_LEDS);
+    if (CHARLIE_BITMASK_SIZE != (CHARLIE_NUM_LEDS + 31) / 32) topo_fail(&errors, "bitmask size", CHARLIE_BITMASK_SIZE);
+
+    // pins, their port and CFGLR bits
+    uint32_t mask[CHARLIE_NUM_PORTS] = {0};
+
+    for (uint8_t pin = 0; pin < CHARLIE_NUM_PINS && pin < n; pin++) {
+        const charlie_pin_config *c = &charlie_pins[pin];
+
+        if (charlie_ports[c->port] != topo_port(pins[pin].port)) topo_fail(&errors, "pin on the wrong port", pin);
+        if (c->pin != 1U << pins[pin].bit) topo_fail(&errors, "pin bit", pin);
+        if (charlie_pin_cfg[pin] != 0xFUL << (pins[pin].bit * 4)) topo_fail(&errors, "charlie_pin_cfg", pin);
+        mask[c->port] |= charlie_pin_cfg[pin];
+    }
+    for (int p = 0; p < CHARLIE_NUM_PORTS; p++) {
+        if (charlie_cfg_mask[p] != mask[p]) topo_fail(&errors, "charlie_cfg_mask", p);
+        if (charlie_cfg_tri[p] != (mask[p] & 0x44444444UL)) topo_fail(&errors, "charlie_cfg_tri", p);
+    }
+
+    // every ordered pin pair once
+    uint8_t seen[CHARLIE_NUM_PINS][CHARLIE_NUM_PINS] = {{0}};
+    uint8_t scanned[CHARLIE_NUM_LEDS] = {0};
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        const charlie_led_config *m = &full_charlie_matrix[led];
+
+        if (m->anode >= CHARLIE_NUM_PINS || m->cathode >= CHARLIE_NUM_PINS || m->anode == m->cathode) {
+            topo_fail(&errors, "LED pins", led);
+            continue;
+        }
+        if (seen[m->anode][m->cathode]++) topo_fail(&errors, "LED listed twice", led);
+        if (charlie_scan_order[led] >= CHARLIE_NUM_LEDS || scanned[charlie_scan_order[led]]++) {
+            topo_fail(&errors, "charlie_scan_order is no permutation", led);
+        }
+    }
+
+    // lit on the sim ports, output level first like charlie_light_led
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        const charlie_led_regs *regs = &charlie_led_regs_table[led];
+
+        topo_ports_reset();
+        for (int p = 0; p < CHARLIE_NUM_PORTS; p++) {
+            GPIO_TypeDef *port = charlie_ports[p];
+
+            port->BSHR = regs->bshr[p];
+            sim_gpio_sync(port);
+            port->CFGLR = (port->CFGLR & ~charlie_cfg_mask[p]) | regs->cfglr[p];
+        }
+        topo_check_lit(led, &errors);
+    }
+
+#ifdef CHARLIE_HW_PWM
+    // channel pin in AF mode on the anode or cathode, the rest as without it
+    uint8_t covered = 0;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        const charlie_hw_regs *hw = &charlie_hw_regs_table[led];
+        const charlie_led_regs *regs = &charlie_led_regs_table[led];
+        const charlie_led_config *m = &full_charlie_matrix[led];
+        int af = -1, afs = 0;
+
+        for (uint8_t pin = 0; pin < CHARLIE_NUM_PINS; pin++) {
+            const charlie_pin_config *c = &charlie_pins[pin];
+            uint32_t nib = hw->cfglr[c->port] & charlie_pin_cfg[pin];
+
+            if (nib == (charlie_pin_cfg[pin] & (CFG_AF_PP * 0x11111111UL))) {
+                af = pin;
+                afs++;
+            } else if (nib != (regs->cfglr[c->port] & charlie_pin_cfg[pin])) {
+                topo_fail(&errors, "hw table differs off the channel pin", led);
+            }
+        }
+        if (!hw->ccer) {
+            if (afs || hw->ch != CHARLIE_HW_FALLBACK_CH) topo_fail(&errors, "LED without channel", led);
+            continue;
+        }
+        covered++;
+        if (afs != 1 || (af != m->anode && af != m->cathode)) topo_fail(&errors, "channel pin", led);
+        if (hw->ch > 3 || (hw->ccer & ~(0xFU << (hw->ch * 4)))) topo_fail(&errors, "CCER bits", led);
+        // a cathode channel runs inverted
+        if (!(hw->ccer & (0xAU << (hw->ch * 4))) != (af == m->anode)) topo_fail(&errors, "channel polarity", led);
+    }
+    printf("%u of %u LEDs on a TIM1 channel\n", covered, CHARLIE_NUM_LEDS);
+#endif
+
+    printf("topology: %s\n", errors ? "FAIL" : "ok");
+
+    return errors != 0;
+}
@@ -0,0 +1,158 @@
+/* Per LED on-time accounting against the pins (charlie_usage.h).
+ *
+ *   sim/star_sim --usage       software PWM
+ *   sim/star_sim_hw --usage    CHARLIE_HW_PWM
+ *
+ * Runs the forest fire animation with its per LED levels for a few
+ * seconds of display time, in both PWM resolutions. The LED lit in every
+ * tick is read back from the charlie pins, the counters the ISR keeps once
+ * per slot must match those on-times exactly. Prints the usage as a
+ * heatmap on the board layout, the load of every pin as source and sink
+ * and the LEDs that were never lit.
+ */
+#include <stdio.h>
+
+#include "sim.h"
+#include "led_charlie.h"
+#include "charlie_usage.h"
+#include "animations_ca.h"
+#include "led_layout.h"
+#include "fixmath.h"
+
+#if LED_LAYOUT_NUM_LEDS != CHARLIE_NUM_LEDS
+#error "led_layout does not match the charlie topology, rerun tools/gen_led_layout.py"
+#endif
+
+#define USAGE_FRAME_TICKS   8000        // 20ms frames
+#define USAGE_FRAMES        200         // 4s of display time
+#define USAGE_NONE          0xFF
+
+#define USAGE_MAP_W         32          // heatmap cells, layout x / 8
+#define USAGE_MAP_H         16          // layout y / 16
+
+// Board layout, hottest LED = 9, '.' never lit
+static void usage_heatmap(const usage_data *d){
+    char map[USAGE_MAP_H][USAGE_MAP_W + 1];
+    uint32_t max = 1;
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        if (d->on[led] > max) max = d->on[led];
+    }
+
+    for (int y = 0; y < USAGE_MAP_H; y++) {
+        for (int x = 0; x < USAGE_MAP_W; x++) map[y][x] = ' ';
+        map[y][USAGE_MAP_W] = 0;
+    }
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        char *cell = &map[led_layout[led].y / 16][led_layout[led].x / 8];
+        char c = d->on[led] ? '0' + (char)((uint64_t)d->on[led] * 9 / max) : '.';
+
+        if (*cell == ' ' || *cell == '.' || (c != '.' && c > *cell)) *cell = c;
+    }
+
+    for (int y = 0; y < USAGE_MAP_H; y++) printf("  |%s|\n", map[y]);
+}
+
+static void usage_pins_print(const usage_data *d){
+    usage_pins pins;
+
+    usage_pin_load(d, &pins);
+    printf("pin    source  sink\n");
+    for (uint8_t p = 0; p < CHARLIE_NUM_PINS; p++) {
+        printf("%-6u %5.2f%% %5.2f%%\n", p, 100.0 * pins.source[p] / d->ticks, 100.0 * pins.sink[p] / d->ticks);
+    }
+}
+
+// LED lit in the current tick, read from the pins
+static void usage_count(uint32_t *on, uint32_t *ticks, int *overlap){
+    uint8_t led = sim_lit_led(overlap);
+
+    if (led != USAGE_NONE) on[led]++;
+    (*ticks)++;
+}
+
+static int usage_run(uint8_t fast){
+    static usage_data d;
+    uint32_t on[CHARLIE_NUM_LEDS] = {0};
+    uint32_t ticks = 0, total = 0, slots;
+    int errors = 0, overlap = 0;
+
+    sim_reset();
+    charlie_init();
+    charlie_set_fast_pwm_mode(fast);
+    charlie_set_brightness(255);
+    fx_srand(0x5EED);
+    anim_fire_init(4, 40);
+    charlie_enable_multiplex(anim_fire_update(0));
+    for (int t = 0; t < 10000; t++) sim_tick();
+
+    // counting starts at a slot boundary: the tick whose ISR accounts a
+    // slot is the first PWM tick of it
+    usage_reset();
+    while (!usage_slots) sim_tick();
+    usage_count(on, &ticks, &overlap);
+
+    for (uint32_t f = 0; f < USAGE_FRAMES; f++) {
+        uint8_t *levels = charlie_levels_back_buffer();
+        uint32_t *pattern = anim_fire_update(levels);
+
+        charlie_present_levels();
+        charlie_update_multiplex_pattern(pattern);
+
+        for (uint32_t t = 0; t < USAGE_FRAME_TICKS; t++) {
+            sim_tick();
+            usage_count(on, &ticks, &overlap);
+        }
+    }
+
+    // and ends right before the next one
+    for (;;) {
+        usage_snapshot(&d);
+        slots = usage_slots;
+        sim_tick();
+        if (usage_slots != slots) break;
+        usage_count(on, &ticks, &overlap);
+    }
+
+    for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+        total += d.on[led];
+        if (d.on[led] != on[led] && errors++ < 5) {
+            printf("usage: LED %u counted %lu ticks, pins show %lu\n", led,
+                   (unsigned long)d.on[led], (unsigned long)on[led]);
+        }
+    }
+    if (d.ticks != ticks && errors++ < 5) {
+        printf("usage: %lu ticks accounted, %lu run\n", (unsigned long)d.ticks, (unsigned long)ticks);
+    }
+
+    printf("%u-step PWM: %lu ticks, %lu slots, %.3f LEDs lit on average, %s\n", fast ? 64 : 256,
+           (unsigned long)d.ticks, (unsigned long)d.slots, (double)total / d.ticks,
+           errors || overlap ? "FAIL" : "ok");
+    if (overlap) printf("usage: %d ticks with more than one LED driven\n", overlap);
+
+    if (!fast) {
+        uint8_t unused = 0;
+
+        usage_heatmap(&d);
+        usage_pins_print(&d);
+        printf("never lit:");
+        for (uint8_t led = 0; led < CHARLIE_NUM_LEDS; led++) {
+            if (!d.on[led]) {
+                printf(" %u", led);
+                unused++;
+            }
+        }
+        printf("%s\n", unused ? "" : " none");
+    }
+
+    return errors + overlap;
+}
+
+int sim_usage(void){
+    int errors = usage_run(1) + usage_run(0);
+
+    printf("usage: %s\n", errors ? "FAIL" : "ok");
+
+    return errors != 0;
+}
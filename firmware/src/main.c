@@ -3,18 +3,45 @@
 #include <stdlib.h>
 
 #include "led_charlie.h"
+#include "charlie_perf.h"
+#include "charlie_usage.h"
+#include "charlie_ambient.h"
+#include "animations.h"
 #include "animations_simple.h"
+#include "animations_wave.h"
+#include "animations_ca.h"
+#include "animations_motion.h"
+#include "animations_seq.h"
+#include "fixmath.h"
+#include "uart_stream.h"
+#include "sysclk.h"
+#include "sc7a20.h"
+#include "motion.h"
+
+#define MAIN_TICK_MS        10      // main loop pass, frame waits count these
+#define MOTION_POLL_FRAMES  (MOTION_POLL_MS / 20)
+#define AMBIENT_PASSES      (AMBIENT_PERIOD_MS / 10)
+#define BRIGHTNESS          40      // in a lit room, auto-brightness dims from here
+
+/* The display gets by with 24MHz: TIM1 PWM interrupts once per LED slot,
+ * the software PWM interrupts every 2nd tick there with half the levels */
+#define DISPLAY_SYSCLK      SYSCLK_MID
+
+#ifdef CHARLIE_FAST_BOOT
+// SysTick count at main entry, next to charlie_boot_cycles (also for the debugger)
+uint32_t boot_main_cycles;
+#endif
 
 void NMI_Handler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
 void HardFault_Handler(void) __attribute__((interrupt("WCH-Interrupt-fast")));
 void Delay_Init(void);
 void Delay_Ms(uint32_t n);
 
-// Remaps I2C to PD0 (SDA) and PD1 (SCL)
+// Remaps I2C to PD0 (SDA) and PD1 (SCL), the full remap would be PC5 / PC6
 // Warning: Disables SWD!
 void i2c_remap(void){
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
-    GPIO_PinRemapConfig(GPIO_FullRemap_I2C1, ENABLE);
+    GPIO_PinRemapConfig(GPIO_PartialRemap_I2C1, ENABLE);
 }
 
 int is_button_pressed(void){
@@ -31,9 +58,49 @@ void init_button(void){
     GPIO_Init(GPIOD, &button_init);
 }
 
+// SysTick cycles of a main loop pass, kept at MAIN_TICK_MS over clock switches (sysclk hook)
+static uint32_t main_tick_cycles = 48000000 / 1000 * MAIN_TICK_MS;
+
+void main_set_timebase(uint32_t hclk){
+    main_tick_cycles = hclk / 1000 * MAIN_TICK_MS;
+}
+
+// Free running SysTick on HCLK, the same setup as perf_init() and the fast
+// boot, so a counter already running is left as it is
+static void main_systick_start(void){
+    SysTick->CMP = 0xFFFFFFFF;
+    SysTick->CTLR = (1 << 2) | (1 << 0);   // STCLK = HCLK, STE, no interrupt
+}
+
+// Sleeps until MAIN_TICK_MS after the pass started, frame time included.
+// The display interrupt wakes the core at least once per LED slot.
+static uint32_t main_wait_tick(uint32_t start){
+    while(SysTick->CNT - start < main_tick_cycles) __WFI();
+    return SysTick->CNT;
+}
+
+// Both level buffers, so switching away from a smooth animation leaves no dim LEDs
+void set_all_levels(uint8_t level){
+    for(int b = 0; b < 2; b++){
+        uint8_t *levels = charlie_levels_back_buffer();
+        for(int i = 0; i < CHARLIE_NUM_LEDS; i++) levels[i] = level;
+        charlie_present_levels();
+    }
+}
+
 int main(void){
+#ifdef CHARLIE_FAST_BOOT
+    /* Boot frame multiplexed straight away, still on the reset clock.
+     * The PLL lock (SystemInit) is only waited for after that. */
+    boot_main_cycles = SysTick->CNT;
+    charlie_init();
+    charlie_enable_multiplex(charlie_boot_frame);
+    SystemInit();
+    init_button();
+#else
     init_button();
     charlie_init();
+#endif
     if(is_button_pressed()){
         while(1){   // Wait for SWD...
             charlie_single(17, 1);
@@ -47,30 +114,194 @@ int main(void){
 
     //charlie_test();
 
+    stream_init(115200);
+#ifdef CHARLIE_FAST_BOOT
+    printf("boot: first light %lu cycles, main %lu cycles (reset clock)\r\n",
+           (unsigned long)charlie_boot_cycles, (unsigned long)boot_main_cycles);
+#endif
+#ifdef CHARLIE_PERF
+    perf_init();
+    fx_bench_report();
+#endif
+
+    /* Accelerometer: 100Hz into its FIFO, read in batches by the motion animation */
+    uint8_t motion_ok = sc7a20_init();
+    motion_state motion = {0};
+    uint8_t motion_frames = 0;
+    motion_init();
+
+    /* Display at DISPLAY_SYSCLK, each animation asks for what its frames
+     * need (anim_sysclk), live frames and accelerometer bursts get 48MHz */
+    sysclk_init();
+    sysclk_add_hook(charlie_set_timebase);
+    sysclk_add_hook(stream_set_timebase);
+    sysclk_add_hook(main_set_timebase);
+    if(motion_ok) sysclk_add_hook(sc7a20_set_timebase);
+    sysclk_request(SYSCLK_USER_DISPLAY, DISPLAY_SYSCLK);
+
     charlie_set_fast_pwm_mode(1);
-    charlie_set_brightness(40);  // Adjust brightness as needed
+    charlie_set_brightness(BRIGHTNESS);
     twinkle_init();
     
     /* Start with first random frame */
     charlie_enable_multiplex(twinkle_next_frame());
+
+    uint8_t anim = ANIM_TWINKLE;
+    uint8_t wait = 0;
+    uint8_t button = 0;
+
+    /* Auto-brightness, an LED of the star measures the ambient light */
+    ambient_state ambient;
+    uint16_t ambient_passes = 0;
+    uint16_t sense_ticks = 0;
+    uint8_t base_brightness = BRIGHTNESS;
+    uint8_t auto_brightness = BRIGHTNESS;
+    ambient_init(&ambient);
+
+    /* Passes paced by SysTick, the core sleeps for the rest of each */
+    main_systick_start();
+    uint32_t pass_start = SysTick->CNT;
     
-    /* Main loop - just keep changing frames randomly */
+    /* Main loop - animation frames, unless the host streams them */
     while(1) {
-        /* Get next random frame and display it */
-        charlie_update_multiplex_pattern(twinkle_next_frame());
+        stream_poll();
+
+        /* The display goes dark for the discharge time, up to 5ms every few
+         * seconds. Scales the brightness set last, at boot or over the stream */
+        if(++ambient_passes >= AMBIENT_PASSES){
+            ambient_passes = 0;
+            charlie_sense_start(AMBIENT_LED);
+        }
+        if(charlie_sense_read(&sense_ticks)){
+            uint8_t shown = charlie_get_brightness();
+
+            if(shown != auto_brightness) base_brightness = shown;
+            auto_brightness = fx_scale8(base_brightness, ambient_update(&ambient, sense_ticks));
+            charlie_set_brightness(auto_brightness);
+        }
+
+        if(stream_anim() != anim){
+            anim = stream_anim();
+            wait = 0;
+            if(anim == ANIM_SPARKLE) anim_sparkle_init(8, 128);
+            if(anim == ANIM_BREATHE) anim_breathe_init(3);
+#if ANIM_LAYOUT
+            /* Without led_layout of the pin list these ids show twinkle */
+            if(anim == ANIM_WAVE) anim_wave_init(4, 160);
+            if(anim == ANIM_LIFE) anim_life_init(0, 0);
+            if(anim == ANIM_FIRE) anim_fire_init(4, 24);
+            if(anim == ANIM_RIPPLE) anim_ripple_init(40);
+            if(anim == ANIM_MOTION) anim_motion_init();
+            if(anim == ANIM_SHOW) anim_show_init();
+#endif
+            if(anim != STREAM_ANIM_LIVE) set_all_levels(255);
+
+            sysclk_request(SYSCLK_USER_ANIM, anim_sysclk(anim));
+            sysclk_request(SYSCLK_USER_STREAM,
+                           anim == STREAM_ANIM_LIVE ? SYSCLK_HIGH : SYSCLK_LOW);
+        }
+
+        /* Button presses, not the time it is held: into the show, it runs
+         * on at the next frame, and the debug command below */
+        uint8_t pressed = is_button_pressed();
+        uint8_t press = pressed && !button;
+        button = pressed;
+#if ANIM_LAYOUT
+        if(anim == ANIM_SHOW && press) anim_show_trigger();
+#else
+        (void)press;
+#endif
+
+        if(anim != STREAM_ANIM_LIVE && wait-- == 0){
+            /* Get next frame and display it */
+            uint8_t *levels = charlie_levels_back_buffer();
+            uint32_t *frame;
+
+            PERF_START(frame_start);
+            if(anim == ANIM_MOTION && motion_ok && ++motion_frames >= MOTION_POLL_FRAMES){
+                motion_frames = 0;
+                sysclk_request(SYSCLK_USER_I2C, SYSCLK_HIGH);
+#ifdef MOTION_TRACE
+                /* Raw samples for sim/star_sim --motion trace.csv */
+                sc7a20_sample batch[MOTION_BATCH_MAX];
+                uint8_t n = sc7a20_read(batch, MOTION_BATCH_MAX);
+
+                for(uint8_t i = 0; i < n; i++){
+                    printf("%d,%d,%d\r\n", batch[i].x, batch[i].y, batch[i].z);
+                }
+                motion_update(batch, n, &motion);
+#else
+                motion_poll(&motion);
+#endif
+                sysclk_request(SYSCLK_USER_I2C, SYSCLK_LOW);
+            }
+            switch(anim){
+                case ANIM_SPARKLE: frame = anim_sparkle_update(); break;
+                case ANIM_BREATHE: frame = anim_breathe_update(levels); break;
+#if ANIM_LAYOUT
+                case ANIM_WAVE: frame = anim_wave_update(levels); break;
+                case ANIM_LIFE: frame = anim_life_update(levels); break;
+                case ANIM_FIRE: frame = anim_fire_update(levels); break;
+                case ANIM_RIPPLE: frame = anim_ripple_update(levels); break;
+                case ANIM_MOTION:
+                    /* shakes of a batch start their bursts once */
+                    frame = anim_motion_update(motion.tilt_x, motion.tilt_y, motion.intensity,
+                                               motion.shakes, levels);
+                    motion.shakes = 0;
+                    break;
+                case ANIM_SHOW: frame = anim_show_update(levels); break;
+#endif
+                default: frame = twinkle_next_frame(); break;
+            }
+            PERF_END(PERF_TASK_FRAME, frame_start);
+
+            PERF_START(update_start);
+            if(anim >= ANIM_BREATHE) charlie_present_levels();
+            charlie_update_multiplex_pattern(frame);
+            PERF_END(PERF_TASK_UPDATE, update_start);
+
+            /* twinkle every ~500ms, sparkle every ~50ms, smooth ones every ~20ms,
+             * automata every ~100ms (life ~200ms), motion every ~20ms with a
+             * sensor batch every MOTION_POLL_MS, the show's sequences every ~20ms */
+            switch(anim){
+                case ANIM_SPARKLE: wait = 4; break;
+                case ANIM_BREATHE: wait = 1; break;
+#if ANIM_LAYOUT
+                case ANIM_LIFE: wait = 19; break;
+                case ANIM_FIRE:
+                case ANIM_RIPPLE: wait = 9; break;
+                case ANIM_WAVE:
+                case ANIM_MOTION:
+                case ANIM_SHOW: wait = 1; break;
+#endif
+                default: wait = 49; break;
+            }
+        }
+
+#if defined(CHARLIE_PERF) || defined(CHARLIE_USAGE)
+        /* Debug command: a button press dumps the counters on USART1, or
+         * read them with `tools/star_stream.py PORT perf` / `... PORT usage`.
+         * Both start over after the report, the usage tick counter would
+         * wrap after about 3h */
+        if(press){
+#ifdef CHARLIE_PERF
+            perf_report();
+            perf_reset();
+            /* raw discharge time, for AMBIENT_BRIGHT_TICKS / AMBIENT_DARK_TICKS */
+            printf("ambient: %u ticks, light %u, scale %u\r\n", sense_ticks, ambient.light, ambient.scale);
+#endif
+#ifdef CHARLIE_USAGE
+            usage_report();
+            usage_reset();
+#endif
+        }
+#endif
         
-        /* Wait ~500ms between changes (adjust delay to taste) */
-        for(volatile uint32_t i = 0; i < 500000; i++);
+        pass_start = main_wait_tick(pass_start);
     }
     
 
     // set interrupts
-
-    // enable i2c
-
-    // init sc7a20
-
-    // set sleep
     
 }
 
@@ -0,0 +1,396 @@
+# Generates lib/led_charlie/charlie_topology.h from a charlieplex pin list.
+#
+# The pin list is the only description of the matrix, everything else
+# (LED table, bitmask size, port register masks) is derived from it here.
+#
+# Used as PlatformIO pre-script, reads `custom_charlie_pins` of the env:
+#   extra_scripts = pre:tools/gen_charlie_topology.py
+#   custom_charlie_pins = PC0 PC1 PC2 PC3 PC5 PC6 PC7
+#
+# Or standalone, -o writes another header (the sim builds a second pin list):
+#   python tools/gen_charlie_topology.py PC0 PC1 PC2 PC3 PC5 PC6 PC7
+#   python tools/gen_charlie_topology.py -o OUT.h PC0 PC1 ...
+
+import os
+import sys
+
+PORTS = "ACD"   # ports present on the CH32V003
+CFG_OUT_PP = 0x3  # MODE 50MHz, CNF push-pull
+CFG_FLOAT = 0x4   # MODE input, CNF floating
+CFG_AF_PP = 0xB   # MODE 50MHz, CNF alternate function push-pull
+
+# TIM1 output pins per AFIO remap (TIM1_RM in AFIO_PCFR1), used for the
+# hardware PWM mode: (port, bit) -> (channel 0-3, complementary output)
+TIM1_REMAPS = [
+    (None, {("D", 2): (0, False), ("A", 1): (1, False), ("C", 3): (2, False), ("C", 4): (3, False),
+           ("D", 0): (0, True), ("A", 2): (1, True), ("D", 1): (2, True)}),
+    ("GPIO_PartialRemap1_TIM1", {("C", 6): (0, False), ("C", 7): (1, False), ("C", 0): (2, False),
+                                 ("D", 3): (3, False), ("C", 3): (0, True), ("C", 4): (1, True),
+                                 ("D", 1): (2, True)}),
+    ("GPIO_FullRemap_TIM1", {("C", 4): (0, False), ("C", 7): (1, False), ("C", 5): (2, False),
+                             ("D", 4): (3, False), ("C", 3): (0, True), ("D", 2): (1, True),
+                             ("C", 6): (2, True)}),
+]
+HW_FALLBACK_CH = 3  # LEDs without a channel pin are switched off by the CH4 compare interrupt
+
+OUT_REL = os.path.join("lib", "led_charlie", "charlie_topology.h")
+
+
+def parse_pins(spec):
+    pins = []
+    for name in spec:
+        name = name.strip().upper()
+        if len(name) != 3 or name[0] != "P" or name[1] not in PORTS or not name[2].isdigit():
+            raise ValueError("bad charlie pin '%s', expected e.g. PC3" % name)
+        if int(name[2]) > 7:
+            raise ValueError("bad charlie pin '%s', only pins 0-7 exist" % name)
+        if (name[1], int(name[2])) in pins:
+            raise ValueError("charlie pin '%s' listed twice" % name)
+        pins.append((name[1], int(name[2])))
+    if len(pins) < 2:
+        raise ValueError("a charlieplex needs at least 2 pins")
+    return pins
+
+
+# Same order as the original hand-written table (and the schematic):
+# pin 0 against pins n-1..1, then pin 1 against n-1..2 and so on,
+# both polarities next to each other.
+def build_matrix(n):
+    leds = []
+    for low in range(n - 1):
+        for high in range(n - 1, low, -1):
+            leds.append((high, low))
+            leds.append((low, high))
+    return leds
+
+
+# Pin states while an LED is lit ("H" anode high, "L" cathode low)
+def lit_state(led):
+    return {led[0]: "H", led[1]: "L"}
+
+
+# Pin states once an LED went off in its slot. Software PWM floats all
+# pins, in scan by pins mode only the cathode.
+def sw_off_states(leds, keep_anode):
+    return [{anode: "H"} if keep_anode else {} for anode, cathode in leds]
+
+
+# With hardware PWM the channel pin turns inactive and the LED stays
+# driven: an anode channel pulls low, an inverted cathode channel high.
+# LEDs without a channel pin are switched off by the CC interrupt.
+def hw_off_states(leds, plan):
+    ends = []
+    for (anode, cathode), (idx, ch, ccer) in zip(leds, plan):
+        if idx is None:
+            ends.append({})
+        else:
+            level = "L" if idx == anode else "H"
+            ends.append({anode: level, cathode: level})
+    return ends
+
+
+def pin_changes(a, b):
+    return sum(1 for pin in set(a) | set(b) if a.get(pin) != b.get(pin))
+
+
+# Pin changes of one scan with every LED lit for part of its slot
+def scan_cost(leds, ends, order):
+    cost = 0
+    for i, led in enumerate(order):
+        cost += pin_changes(ends[order[i - 1]], lit_state(leds[led]))
+        cost += pin_changes(lit_state(leds[led]), ends[led])
+    return cost
+
+
+# Scan order for charlie_set_scan_order(CHARLIE_SCAN_PINS): greedy nearest
+# neighbour from LED 0 on the pin changes from the LED gone off to the
+# next one. With a kept anode that is anode by anode, each group entered
+# through the old anode.
+def build_scan_order(leds, ends):
+    order = [0]
+    left = set(range(1, len(leds)))
+    while left:
+        prev = ends[order[-1]]
+        nxt = min(left, key=lambda led: (pin_changes(prev, lit_state(leds[led])), led))
+        order.append(nxt)
+        left.remove(nxt)
+    return order
+
+
+def port_list(pins):
+    return [p for p in PORTS if any(pp == p for pp, _ in pins)]
+
+
+def nibble(bit, val):
+    return val << (bit * 4)
+
+
+def build_regs(pins, ports, leds):
+    cfg_mask = []
+    cfg_tri = []
+    for port in ports:
+        m = t = 0
+        for pp, bit in pins:
+            if pp == port:
+                m |= nibble(bit, 0xF)
+                t |= nibble(bit, CFG_FLOAT)
+        cfg_mask.append(m)
+        cfg_tri.append(t)
+
+    regs = []
+    for anode, cathode in leds:
+        cfg = []
+        bshr = []
+        for i, port in enumerate(ports):
+            c = cfg_tri[i]
+            b = 0
+            for idx, bit_set in ((anode, True), (cathode, False)):
+                pp, bit = pins[idx]
+                if pp != port:
+                    continue
+                c = (c & ~nibble(bit, 0xF)) | nibble(bit, CFG_OUT_PP)
+                b |= (1 << bit) if bit_set else (1 << (bit + 16))
+            cfg.append(c)
+            bshr.append(b)
+        regs.append((cfg, bshr))
+    return cfg_mask, cfg_tri, regs
+
+
+# Picks the TIM1 remap that puts a channel on the anode or cathode of the
+# most LEDs. Per LED: (pin index or None, channel, CCER bits). The channel
+# output lights the LED while the counter is below the compare value, so a
+# cathode channel runs with inverted polarity.
+def plan_hw_pwm(pins, leds):  # remap None = default mapping
+    best = None
+    for remap, chans in TIM1_REMAPS:
+        plan = []
+        for anode, cathode in leds:
+            entry = (None, HW_FALLBACK_CH, 0)
+            for idx, is_cathode in ((anode, False), (cathode, True)):
+                if pins[idx] in chans:
+                    ch, comp = chans[pins[idx]]
+                    enable = 0x4 if comp else 0x1
+                    entry = (idx, ch, (enable | (enable << 1 if is_cathode else 0)) << (ch * 4))
+                    break
+            plan.append(entry)
+        covered = sum(1 for idx, _, _ in plan if idx is not None)
+        if best is None or covered > best[2]:
+            best = (remap, plan, covered)
+    return best
+
+
+def build_hw_regs(pins, ports, leds, regs, plan):
+    hw = []
+    for (anode, cathode), (cfg, bshr), (idx, ch, ccer) in zip(leds, regs, plan):
+        cfg = list(cfg)
+        bshr = list(bshr)
+        if idx is not None:
+            port, bit = pins[idx]
+            i = ports.index(port)
+            cfg[i] = (cfg[i] & ~nibble(bit, 0xF)) | nibble(bit, CFG_AF_PP)
+            bshr[i] &= ~((1 << bit) | (1 << (bit + 16)))
+        hw.append((cfg, bshr, ccer, ch))
+    return hw
+
+
+def verify_hw(pins, ports, leds, regs, hw):
+    for (anode, cathode), (cfg, bshr), (hcfg, hbshr, ccer, ch) in zip(leds, regs, hw):
+        af = [(port, bit) for i, port in enumerate(ports) for bit in range(8)
+              if (hcfg[i] >> (bit * 4)) & 0xF == CFG_AF_PP]
+        if ccer == 0:
+            assert not af and hcfg == cfg and hbshr == bshr and ch == HW_FALLBACK_CH
+            continue
+        assert len(af) == 1 and af[0] in (pins[anode], pins[cathode])
+        assert ccer & ~(0xF << (ch * 4)) == 0
+        inverted = bool(ccer & (0xA << (ch * 4)))
+        assert inverted == (af[0] == pins[cathode])
+
+
+# Cheap sanity check of the generated tables, run on every generation
+def verify(pins, ports, leds, cfg_mask, cfg_tri, regs):
+    n = len(pins)
+    assert len(leds) == n * (n - 1)
+    assert len(set(leds)) == len(leds)
+    for (anode, cathode), (cfg, bshr) in zip(leds, regs):
+        assert anode != cathode
+        lit = 0
+        for i, port in enumerate(ports):
+            assert cfg[i] & ~cfg_mask[i] == 0
+            assert bshr[i] & (bshr[i] >> 16) == 0
+            for bit in range(8):
+                v = (cfg[i] >> (bit * 4)) & 0xF
+                if v == CFG_OUT_PP:
+                    lit += 1
+                    assert (port, bit) in (pins[anode], pins[cathode])
+        assert lit == 2
+        a_port, a_bit = pins[anode]
+        c_port, c_bit = pins[cathode]
+        assert bshr[ports.index(a_port)] & (1 << a_bit)
+        assert bshr[ports.index(c_port)] & (1 << (c_bit + 16))
+
+
+def render(pins, source):
+    n = len(pins)
+    leds = build_matrix(n)
+    ports = port_list(pins)
+    cfg_mask, cfg_tri, regs = build_regs(pins, ports, leds)
+    verify(pins, ports, leds, cfg_mask, cfg_tri, regs)
+    remap, plan, covered = plan_hw_pwm(pins, leds)
+    hw = build_hw_regs(pins, ports, leds, regs, plan)
+    verify_hw(pins, ports, leds, regs, hw)
+
+    # (by index, by pins) per driver, by pins is never worse
+    index = list(range(len(leds)))
+    orders = []
+    for ends, pin_ends in ((sw_off_states(leds, False), sw_off_states(leds, True)),
+                           (hw_off_states(leds, plan), hw_off_states(leds, plan))):
+        order = build_scan_order(leds, pin_ends)
+        if scan_cost(leds, pin_ends, order) > scan_cost(leds, ends, index):
+            order = index
+        assert sorted(order) == index
+        orders.append((order, scan_cost(leds, ends, index), scan_cost(leds, pin_ends, order)))
+
+    def arr(vals):
+        return "{" + ", ".join("0x%08X" % v for v in vals) + "}"
+
+    name = lambda i: "P%s%d" % pins[i]
+    out = []
+    w = out.append
+    w("/* Generated by tools/gen_charlie_topology.py - do not edit.")
+    w(" * Source: %s */" % source)
+    w("#ifndef CHARLIE_TOPOLOGY_H")
+    w("#define CHARLIE_TOPOLOGY_H")
+    w("")
+    w("#define CHARLIE_NUM_PINS        %d" % n)
+    w("#define CHARLIE_NUM_LEDS        %d" % len(leds))
+    w("#define CHARLIE_BITMASK_SIZE    %d" % ((len(leds) + 31) // 32))
+    w("#define CHARLIE_NUM_PORTS       %d" % len(ports))
+    w("")
+    w("#endif /* CHARLIE_TOPOLOGY_H */")
+    w("")
+    w("// Tables are only pulled in by the driver")
+    w("#if defined(CHARLIE_TOPOLOGY_TABLES) && !defined(CHARLIE_TOPOLOGY_TABLES_H)")
+    w("#define CHARLIE_TOPOLOGY_TABLES_H")
+    w("")
+    w("#define CHARLIE_RCC_PERIPH      (%s)" % " | ".join("RCC_APB2Periph_GPIO%s" % p for p in ports))
+    w("")
+    w("// Port tables read by the scan ISR every tick, the driver can place them in SRAM")
+    w("#ifndef CHARLIE_ISR_TABLE")
+    w("#define CHARLIE_ISR_TABLE(name)")
+    w("#endif")
+    w("")
+    w("typedef struct {")
+    w("    uint8_t port;       // index into charlie_ports")
+    w("    uint16_t pin;")
+    w("} charlie_pin_config;")
+    w("")
+    w("typedef struct {")
+    w("    uint8_t anode;      // index into charlie_pins")
+    w("    uint8_t cathode;")
+    w("} charlie_led_config;")
+    w("")
+    w("// Port register values to light one LED: CFGLR bits of all charlie pins")
+    w("// (anode + cathode push-pull, rest floating) and the BSHR write")
+    w("typedef struct {")
+    w("    uint32_t cfglr[CHARLIE_NUM_PORTS];")
+    w("    uint32_t bshr[CHARLIE_NUM_PORTS];")
+    w("} charlie_led_regs;")
+    w("")
+    w("static GPIO_TypeDef * const charlie_ports[CHARLIE_NUM_PORTS] CHARLIE_ISR_TABLE(ports) = {%s};" %
+      ", ".join("GPIO%s" % p for p in ports))
+    w("")
+    w("// CFGLR bits owned by charlie pins")
+    w("static const uint32_t charlie_cfg_mask[CHARLIE_NUM_PORTS] CHARLIE_ISR_TABLE(cfg_mask) = %s;" % arr(cfg_mask))
+    w("// CFGLR bits with all charlie pins floating")
+    w("static const uint32_t charlie_cfg_tri[CHARLIE_NUM_PORTS] CHARLIE_ISR_TABLE(cfg_tri) = %s;" % arr(cfg_tri))
+    w("")
+    w("static const charlie_pin_config charlie_pins[CHARLIE_NUM_PINS] = {")
+    for i, (port, bit) in enumerate(pins):
+        w("    {%d, GPIO_Pin_%d}, // CHARLIE_PIN_%d %s" % (ports.index(port), bit, i, name(i)))
+    w("};")
+    w("")
+    w("static const charlie_led_config full_charlie_matrix[CHARLIE_NUM_LEDS] = {")
+    for i, (anode, cathode) in enumerate(leds):
+        w("    {%d, %d}, // D%d,%d" % (anode, cathode, i * 2 + 1, i * 2 + 2))
+    w("};")
+    w("")
+    w("static const charlie_led_regs charlie_led_regs_table[CHARLIE_NUM_LEDS] = {")
+    for i, ((anode, cathode), (cfg, bshr)) in enumerate(zip(leds, regs)):
+        w("    {%s, %s}, // D%d,%d %s+ %s-" % (arr(cfg), arr(bshr), i * 2 + 1, i * 2 + 2,
+                                            name(anode), name(cathode)))
+    w("};")
+    w("")
+    w("// Scan by pins (charlie_set_scan_order): the next LED is the one with the")
+    w("// fewest pin changes from the last one gone off, software PWM keeps the")
+    w("// anode of a released LED driven. Pin changes per full scan:")
+    for i, (order, by_index, by_pins) in enumerate(orders):
+        w("#ifdef CHARLIE_HW_PWM" if i else "#ifndef CHARLIE_HW_PWM")
+        w("// %d in LED order, %d by pins" % (by_index, by_pins))
+        w("static const uint8_t charlie_scan_order[CHARLIE_NUM_LEDS] = {")
+        for j in range(0, len(order), 14):
+            w("    %s," % ", ".join("%d" % led for led in order[j:j + 14]))
+        w("};")
+        w("#endif")
+    w("// CFGLR bits of each charlie pin")
+    w("static const uint32_t charlie_pin_cfg[CHARLIE_NUM_PINS] CHARLIE_ISR_TABLE(pin_cfg) = %s;" %
+      arr(nibble(bit, 0xF) for _, bit in pins))
+    w("")
+    w("// Hardware PWM (CHARLIE_HW_PWM): TIM1 drives the on-time through a channel")
+    w("// pin of each LED, %d of %d LEDs have one with this remap. The others" % (covered, len(leds)))
+    w("// are lit as usual and switched off by the CH%d compare interrupt." % (HW_FALLBACK_CH + 1))
+    if remap:
+        w("#define CHARLIE_HW_REMAP        %s" % remap)
+    w("#define CHARLIE_HW_FALLBACK_CH  %d" % HW_FALLBACK_CH)
+    w("")
+    w("#ifdef CHARLIE_HW_PWM")
+    w("// Same as charlie_led_regs with the channel pin in alternate function mode,")
+    w("// ccer enables its output (0 = no channel pin) and ch picks the CHxCVR")
+    w("typedef struct {")
+    w("    uint32_t cfglr[CHARLIE_NUM_PORTS];")
+    w("    uint32_t bshr[CHARLIE_NUM_PORTS];")
+    w("    uint16_t ccer;")
+    w("    uint8_t ch;")
+    w("} charlie_hw_regs;")
+    w("")
+    w("static const charlie_hw_regs charlie_hw_regs_table[CHARLIE_NUM_LEDS] = {")
+    for i, ((anode, cathode), (cfg, bshr, ccer, ch), (idx, _, _)) in enumerate(zip(leds, hw, plan)):
+        how = "CH%d%s on %s" % (ch + 1, "N" if ccer & (0x4 << (ch * 4)) else "", name(idx)) if ccer else "CC%d irq" % (ch + 1)
+        w("    {%s, %s, 0x%04X, %d}, // D%d,%d %s+ %s- %s" % (arr(cfg), arr(bshr), ccer, ch, i * 2 + 1, i * 2 + 2,
+                                                       name(anode), name(cathode), how))
+    w("};")
+    w("#endif /* CHARLIE_HW_PWM */")
+    w("")
+    w("#endif /* CHARLIE_TOPOLOGY_TABLES */")
+    return "\n".join(out) + "\n"
+
+
+def generate(project_dir, spec, source, path=None):
+    text = render(parse_pins(spec), source)
+    path = path or os.path.join(project_dir, OUT_REL)
+    old = None
+    if os.path.exists(path):
+        with open(path) as f:
+            old = f.read()
+    if old != text:  # keep mtime stable, avoids full rebuilds
+        with open(path, "w") as f:
+            f.write(text)
+        print("charlie topology: wrote %s" % path)
+
+
+try:
+    Import("env")  # noqa: F821 (only defined when run by SCons)
+except NameError:
+    env = None
+
+if env is not None:
+    spec = env.GetProjectOption("custom_charlie_pins").split()
+    generate(env.subst("$PROJECT_DIR"), spec, "custom_charlie_pins = " + " ".join(spec))
+elif __name__ == "__main__":
+    args = sys.argv[1:]
+    out = None
+    if len(args) > 1 and args[0] == "-o":
+        out, args = args[1], args[2:]
+    if len(args) < 2:
+        sys.exit("usage: %s [-o OUT.h] PC0 PC1 ..." % sys.argv[0])
+    here = os.path.dirname(os.path.abspath(__file__))
+    generate(os.path.dirname(here), args, "custom_charlie_pins = " + " ".join(args), out)
@@ -0,0 +1,184 @@
+# Generates lib/led_charlie/led_layout.[ch] from the LED placement in the PCB.
+#
+# LED n of the charlie matrix is the D(2n+1)/D(2n+2) pair (top/bottom side,
+# same spot), see charlie_topology.h. Coordinates are scaled to 0..255 over
+# the LED bounding box, y grows downwards like in the PCB.
+#
+# Neighbours are LEDs closer than NEIGHBOUR_RANGE times the median nearest
+# neighbour distance. Besides a mask per LED the graph is emitted as a list
+# of index shifts with masks, so a cellular automaton can gather all
+# neighbour states word-parallel (see animations_ca.c).
+#
+# Run after moving LEDs on the board:
+#   python tools/gen_led_layout.py [../pcb/advent_star.kicad_pcb]
+
+import math
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+PROJECT = os.path.dirname(HERE)
+PCB_DEFAULT = os.path.join(PROJECT, "..", "pcb", "advent_star.kicad_pcb")
+OUT_DIR = os.path.join(PROJECT, "lib", "led_charlie")
+
+NEIGHBOUR_RANGE = 1.5
+
+
+def read_leds(path):
+    with open(path) as f:
+        text = f.read()
+    pos = {}
+    for fp in text.split("\n\t(footprint ")[1:]:
+        ref = re.search(r'\(property "Reference" "D(\d+)"', fp)
+        at = re.search(r'^\s*\(at ([-\d.]+) ([-\d.]+)', fp, re.M)
+        if ref and at:
+            pos[int(ref.group(1))] = (float(at.group(1)), float(at.group(2)))
+    leds = []
+    n = 1
+    while n in pos:  # top side LED of each pair
+        leds.append(pos[n])
+        n += 2
+    return leds
+
+
+def scale(leds):
+    xs = [x for x, _ in leds]
+    ys = [y for _, y in leds]
+    x0, y0 = min(xs), min(ys)
+    span = max(max(xs) - x0, max(ys) - y0)  # keep aspect ratio
+    q = lambda v, o: int(round((v - o) * 255 / span))
+    return [(q(x, x0), q(y, y0)) for x, y in leds]
+
+
+def polar(pts):
+    cx = sum(x for x, _ in pts) / len(pts)
+    cy = sum(y for _, y in pts) / len(pts)
+    rmax = max(math.hypot(x - cx, y - cy) for x, y in pts)
+    out = []
+    for x, y in pts:
+        a = math.atan2(y - cy, x - cx) % (2 * math.pi)
+        out.append((int(a * 256 / (2 * math.pi)) & 0xFF,
+                    int(round(math.hypot(x - cx, y - cy) * 255 / rmax))))
+    return out
+
+
+def neighbours(pts):
+    n = len(pts)
+    dist = lambda a, b: math.hypot(pts[a][0] - pts[b][0], pts[a][1] - pts[b][1])
+    nearest = sorted(min(dist(i, j) for j in range(n) if j != i) for i in range(n))
+    limit = nearest[n // 2] * NEIGHBOUR_RANGE
+    return [[j for j in range(n) if j != i and dist(i, j) <= limit] for i in range(n)]
+
+
+# Same graph as (shift, mask): LED i has LED i+shift as neighbour if bit i of mask is set
+def shifts(adj):
+    out = {}
+    for i, nb in enumerate(adj):
+        for j in nb:
+            out[j - i] = out.get(j - i, 0) | (1 << i)
+    return sorted(out.items())
+
+
+def verify(adj, sh):
+    n = len(adj)
+    for i, nb in enumerate(adj):
+        assert nb, "LED %d has no neighbours" % i
+        for j in nb:
+            assert i in adj[j]
+    back = [set() for _ in range(n)]
+    for s, mask in sh:
+        for i in range(n):
+            if mask >> i & 1:
+                back[i].add(i + s)
+    assert back == [set(nb) for nb in adj]
+
+
+def words(mask, n):
+    return "{" + ", ".join("0x%08X" % (mask >> (32 * w) & 0xFFFFFFFF) for w in range((n + 31) // 32)) + "}"
+
+
+def render(leds, pcb_name):
+    pts = scale(leds)
+    pol = polar(pts)
+    n = len(pts)
+    adj = neighbours(pts)
+    sh = shifts(adj)
+    verify(adj, sh)
+    hdr = """/* Generated by tools/gen_led_layout.py from %s - do not edit. */
+#ifndef LED_LAYOUT_H
+#define LED_LAYOUT_H
+#include <stdint.h>
+
+#define LED_LAYOUT_NUM_LEDS         %d
+#define LED_LAYOUT_WORDS            %d  // bitmask words, like CHARLIE_BITMASK_SIZE
+#define LED_LAYOUT_MAX_NEIGHBOURS   %d
+#define LED_LAYOUT_NUM_SHIFTS       %d
+
+typedef struct {
+    uint8_t x;      // 0..255 left to right
+    uint8_t y;      // 0..255 top to bottom
+} led_layout_pos;
+
+// LED i has LED i+shift as neighbour for every bit i set in mask
+typedef struct {
+    int8_t shift;
+    uint32_t mask[LED_LAYOUT_WORDS];
+} led_layout_shift;
+
+// Physical position of every LED, indexed like the charlie matrix
+extern const led_layout_pos led_layout[LED_LAYOUT_NUM_LEDS];
+// Angle around the star centre (0..255 = full turn, 0 = right, clockwise)
+extern const uint8_t led_layout_angle[LED_LAYOUT_NUM_LEDS];
+// Distance from the star centre (0..255 = outermost LED)
+extern const uint8_t led_layout_radius[LED_LAYOUT_NUM_LEDS];
+// Physical neighbours of every LED as a bitmask
+extern const uint32_t led_layout_neighbours[LED_LAYOUT_NUM_LEDS][LED_LAYOUT_WORDS];
+// The same graph as shifted copies of the pattern, sorted by shift
+extern const led_layout_shift led_layout_shifts[LED_LAYOUT_NUM_SHIFTS];
+
+#endif /* LED_LAYOUT_H */
+""" % (pcb_name, n, (n + 31) // 32, max(len(nb) for nb in adj), len(sh))
+    src = ["/* Generated by tools/gen_led_layout.py from %s - do not edit. */" % pcb_name,
+           '#include "led_layout.h"', "",
+           "const led_layout_pos led_layout[LED_LAYOUT_NUM_LEDS] = {"]
+    for i, (x, y) in enumerate(pts):
+        src.append("    {%3d, %3d}, // D%d,%d" % (x, y, i * 2 + 1, i * 2 + 2))
+    src.append("};")
+    src.append("")
+    src.append("const uint8_t led_layout_angle[LED_LAYOUT_NUM_LEDS] = {")
+    for i in range(0, n, 12):
+        src.append("    " + ", ".join("%3d" % a for a, _ in pol[i:i + 12]) + ",")
+    src.append("};")
+    src.append("")
+    src.append("const uint8_t led_layout_radius[LED_LAYOUT_NUM_LEDS] = {")
+    for i in range(0, n, 12):
+        src.append("    " + ", ".join("%3d" % r for _, r in pol[i:i + 12]) + ",")
+    src.append("};")
+    src.append("")
+    src.append("const uint32_t led_layout_neighbours[LED_LAYOUT_NUM_LEDS][LED_LAYOUT_WORDS] = {")
+    for i, nb in enumerate(adj):
+        src.append("    %s, // %d: %s" % (words(sum(1 << j for j in nb), n), i, " ".join(map(str, nb))))
+    src.append("};")
+    src.append("")
+    src.append("const led_layout_shift led_layout_shifts[LED_LAYOUT_NUM_SHIFTS] = {")
+    for shift, mask in sh:
+        src.append("    {%3d, %s}," % (shift, words(mask, n)))
+    src.append("};")
+    return hdr, "\n".join(src) + "\n"
+
+
+def main():
+    pcb = sys.argv[1] if len(sys.argv) > 1 else PCB_DEFAULT
+    leds = read_leds(pcb)
+    if not leds:
+        sys.exit("no LEDs (D1, D3, ...) found in %s" % pcb)
+    hdr, src = render(leds, os.path.basename(pcb))
+    for name, text in (("led_layout.h", hdr), ("led_layout.c", src)):
+        with open(os.path.join(OUT_DIR, name), "w") as f:
+            f.write(text)
+    print("led layout: %d LEDs from %s" % (len(leds), pcb))
+
+
+if __name__ == "__main__":
+    main()
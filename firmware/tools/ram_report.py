@@ -0,0 +1,76 @@
+# SRAM budget of a firmware build, from the symbols of ch32v003_star.ld.
+#
+# Used as PlatformIO post-script, runs after every link:
+#   extra_scripts = post:tools/ram_report.py
+#
+# Or standalone:
+#   python tools/ram_report.py .pio/build/star/firmware.elf [riscv-none-embed-nm]
+
+import subprocess
+import sys
+
+RAM_START = 0x20000000
+RAM_SIZE = 2048
+TOP = 8
+
+# (label, start symbol, end symbol), in address order
+REGIONS = [
+    ("ram code (.highcode)", "_highcode_start", "_highcode_end"),
+    ("isr tables", "_isr_tables_start", "_isr_tables_end"),
+    ("data", "_isr_tables_end", "_edata"),
+    ("bss", "_sbss", "_ebss"),
+    ("stack", "_susrstack", "_eusrstack"),
+]
+
+
+def read_symbols(elf, nm):
+    out = subprocess.run([nm, "-S", "-n", elf], check=True,
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout
+    syms = {}
+    sized = []
+    for line in out.splitlines():
+        f = line.split()
+        if len(f) == 3:
+            syms[f[2]] = int(f[0], 16)
+        elif len(f) == 4:
+            addr, size = int(f[0], 16), int(f[1], 16)
+            syms[f[3]] = addr
+            if RAM_START <= addr < RAM_START + RAM_SIZE:
+                sized.append((size, f[3], addr))
+    return syms, sized
+
+
+def report(elf, nm):
+    syms, sized = read_symbols(elf, nm)
+    missing = sorted({s for _, a, b in REGIONS for s in (a, b) if s not in syms})
+    if missing:
+        print("ram report: %s not linked with ch32v003_star.ld (no %s)" % (elf, ", ".join(missing)))
+        return
+    print("SRAM budget (%d bytes):" % RAM_SIZE)
+    used = 0
+    for label, a, b in REGIONS:
+        n = syms[b] - syms[a]
+        used += n
+        print("  %-22s %5d" % (label, n))
+    print("  %-22s %5d" % ("free", RAM_SIZE - used))
+    print("largest:")
+    # .data holds the RAM code too, so nm types are no help here
+    code = range(syms["_highcode_start"], syms["_highcode_end"])
+    for size, name, addr in sorted(sized, reverse=True)[:TOP]:
+        print("  %-22s %5d%s" % (name, size, "  code" if addr in code else ""))
+
+
+try:
+    Import("env")  # noqa: F821 (only defined when run by SCons)
+except NameError:
+    env = None
+
+if env is not None:
+    def _post_link(target, source, env):
+        report(str(target[0]), env.subst("$OBJCOPY").replace("objcopy", "nm"))
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", _post_link)
+elif __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.exit("usage: %s firmware.elf [nm]" % sys.argv[0])
+    report(sys.argv[1], sys.argv[2] if len(sys.argv) > 2 else "riscv-none-embed-nm")
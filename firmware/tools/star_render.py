@@ -0,0 +1,457 @@
+#!/usr/bin/env python3
+# Offline preview of an animation on the star outline, as a GIF or PNG frames.
+#
+#   make -C sim
+#   python tools/star_render.py fire --seconds 10 -o fire.gif
+#   python tools/star_render.py wave --fps 50 -o frames/     one PNG per frame
+#   sim/star_sim_hw --render ripple 5 > r.txt && python tools/star_render.py --frames r.txt -o r.gif
+#
+# The frames come from sim/star_sim_hw --render (sim/sim_render.c): the real
+# animation and driver code, with the on-time of every LED per video frame,
+# so PWM duty and multiplex dimming show like on the star. LEDs are drawn
+# at their PCB positions over pcb/shape.svg, the board outline.
+#
+# Light adds up linearly and is shown gamma encoded. --exposure is the
+# duty that saturates an LED, inverted: 8 = white at 1/8 on-time.
+# Only needs the standard library.
+
+import argparse
+import math
+import os
+import re
+import struct
+import subprocess
+import sys
+import zlib
+import xml.etree.ElementTree as ET
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+PROJECT = os.path.dirname(HERE)
+PCB = os.path.join(PROJECT, "..", "pcb", "advent_star.kicad_pcb")
+SHAPE = os.path.join(PROJECT, "..", "pcb", "shape.svg")
+SIM = os.path.join(PROJECT, "sim", "star_sim_hw")
+
+sys.path.insert(0, HERE)
+from gen_led_layout import read_leds  # noqa: E402
+
+DUTY_FULL = 65535       # sim_render.c duty scale
+GLOW_LEVELS = 80        # palette entries per background
+GLOW_RADIUS = 4.0       # mm, halo included
+CURVE_STEPS = 16        # line segments per curve
+
+PAGE = "000000"
+BOARD = "1c1c1c"
+OUTLINE = "808080"
+
+
+# --- Board outline ---
+
+def arc_points(x0, y0, rx, ry, phi, large, sweep, x1, y1):
+    # SVG endpoint arc to center form (SVG 1.1 appendix F.6.5)
+    if rx == 0 or ry == 0:
+        return [(x1, y1)]
+    rx, ry = abs(rx), abs(ry)
+    cp, sp = math.cos(math.radians(phi)), math.sin(math.radians(phi))
+    dx, dy = (x0 - x1) / 2, (y0 - y1) / 2
+    x1p, y1p = cp * dx + sp * dy, -sp * dx + cp * dy
+    lam = (x1p / rx) ** 2 + (y1p / ry) ** 2
+    if lam > 1:
+        rx, ry = rx * math.sqrt(lam), ry * math.sqrt(lam)
+    num = rx * rx * ry * ry - rx * rx * y1p * y1p - ry * ry * x1p * x1p
+    den = rx * rx * y1p * y1p + ry * ry * x1p * x1p
+    k = math.sqrt(max(0, num / den)) * (-1 if large == sweep else 1)
+    cxp, cyp = k * rx * y1p / ry, -k * ry * x1p / rx
+    cx = cp * cxp - sp * cyp + (x0 + x1) / 2
+    cy = sp * cxp + cp * cyp + (y0 + y1) / 2
+    a0 = math.atan2((y1p - cyp) / ry, (x1p - cxp) / rx)
+    a1 = math.atan2((-y1p - cyp) / ry, (-x1p - cxp) / rx)
+    da = a1 - a0
+    if sweep and da < 0:
+        da += 2 * math.pi
+    elif not sweep and da > 0:
+        da -= 2 * math.pi
+    out = []
+    for i in range(1, CURVE_STEPS + 1):
+        a = a0 + da * i / CURVE_STEPS
+        x, y = rx * math.cos(a), ry * math.sin(a)
+        out.append((cp * x - sp * y + cx, sp * x + cp * y + cy))
+    return out
+
+
+def cubic(p0, p1, p2, p3):
+    out = []
+    for s in range(1, CURVE_STEPS + 1):
+        t = s / CURVE_STEPS
+        u = 1 - t
+        out.append((u ** 3 * p0[0] + 3 * u * u * t * p1[0] + 3 * u * t * t * p2[0] + t ** 3 * p3[0],
+                    u ** 3 * p0[1] + 3 * u * u * t * p1[1] + 3 * u * t * t * p2[1] + t ** 3 * p3[1]))
+    return out
+
+
+def path_polys(d):
+    # Subpaths of an SVG path as point lists: M L H V C S Q A Z
+    tokens = re.findall(r"[A-Za-z]|[-+]?(?:\d*\.\d+|\d+)(?:[eE][-+]?\d+)?", d)
+    polys, cur = [], []
+    x = y = sx = sy = 0.0
+    cmd, i, ctrl = None, 0, None
+
+    def num():
+        nonlocal i
+        i += 1
+        return float(tokens[i - 1])
+
+    while i < len(tokens):
+        if tokens[i].isalpha():
+            cmd = tokens[i]
+            i += 1
+            if cmd in "Zz":
+                if cur:
+                    polys.append(cur)
+                cur, x, y = [], sx, sy
+                continue
+        rel = cmd.islower()
+        c = cmd.upper()
+        ox, oy = (x, y) if rel else (0.0, 0.0)
+        if c == "M":
+            if cur:
+                polys.append(cur)
+            x, y = num() + ox, num() + oy
+            sx, sy, cur = x, y, [(x, y)]
+            cmd = "l" if rel else "L"
+        elif c == "L":
+            x, y = num() + ox, num() + oy
+            cur.append((x, y))
+        elif c == "H":
+            x = num() + (x if rel else 0)
+            cur.append((x, y))
+        elif c == "V":
+            y = num() + (y if rel else 0)
+            cur.append((x, y))
+        elif c in "CS":
+            if c == "C":
+                p1 = (num() + ox, num() + oy)
+            else:
+                p1 = (2 * x - ctrl[0], 2 * y - ctrl[1]) if ctrl else (x, y)
+            p2 = (num() + ox, num() + oy)
+            p3 = (num() + ox, num() + oy)
+            cur += cubic((x, y), p1, p2, p3)
+            ctrl = p2
+            x, y = p3
+            continue
+        elif c == "Q":
+            q = (num() + ox, num() + oy)
+            p3 = (num() + ox, num() + oy)
+            cur += cubic((x, y), (x + 2 * (q[0] - x) / 3, y + 2 * (q[1] - y) / 3),
+                         (p3[0] + 2 * (q[0] - p3[0]) / 3, p3[1] + 2 * (q[1] - p3[1]) / 3), p3)
+            x, y = p3
+        elif c == "A":
+            rx, ry, phi, large, sweep = num(), num(), num(), num(), num()
+            nx, ny = num() + ox, num() + oy
+            cur += arc_points(x, y, rx, ry, phi, int(large), int(sweep), nx, ny)
+            x, y = nx, ny
+        ctrl = None
+    if cur:
+        polys.append(cur)
+    return polys
+
+
+def transform(polys, attr):
+    m = re.match(r"matrix\(([^)]*)\)", attr or "")
+    if not m:
+        return polys
+    a, b, c, d, e, f = (float(v) for v in re.split(r"[ ,]+", m.group(1).strip()))
+    return [[(a * x + c * y + e, b * x + d * y + f) for x, y in p] for p in polys]
+
+
+def read_shape(path):
+    # Outline (the path with the biggest extent) and the other strokes, in mm
+    root = ET.parse(path).getroot()
+    ns = "{http://www.w3.org/2000/svg}"
+    hidden = {id(el) for defs in root.iter(ns + "defs") for el in defs.iter()}
+    shapes = []
+    for el in root.iter():
+        if id(el) in hidden:
+            continue
+        if el.tag == ns + "path":
+            shapes.append(transform(path_polys(el.get("d")), el.get("transform")))
+        elif el.tag == ns + "circle":
+            cx, cy, r = (float(el.get(k)) for k in ("cx", "cy", "r"))
+            shapes.append([[(cx + r * math.cos(a * math.pi / 32), cy + r * math.sin(a * math.pi / 32))
+                            for a in range(65)]])
+    w, h = (float(v) for v in root.get("viewBox").split()[2:])
+    shapes.sort(key=lambda s: -extent(s))
+    return shapes[0], shapes[1:], (w, h)
+
+
+def extent(polys):
+    xs = [x for p in polys for x, _ in p]
+    ys = [y for p in polys for _, y in p]
+    return max(xs) - min(xs) + max(ys) - min(ys)
+
+
+def bbox(points):
+    xs = [x for x, _ in points]
+    ys = [y for _, y in points]
+    return min(xs), min(ys), max(xs), max(ys)
+
+
+def pcb_outline(path):
+    # Biggest Edge.Cuts polygon, the same star the svg draws
+    with open(path) as f:
+        text = f.read()
+    best = []
+    for m in re.finditer(r"\n\t\(gr_poly(.*?)\n\t\)", text, re.S):
+        if '(layer "Edge.Cuts")' in m.group(1):
+            pts = [(float(a), float(b)) for a, b in re.findall(r"\(xy ([-\d.]+) ([-\d.]+)\)", m.group(1))]
+            if len(pts) > len(best):
+                best = pts
+    return best
+
+
+def led_positions(pcb, outline):
+    # PCB millimetres to svg ones: the two outlines share their bounding box
+    leds = read_leds(pcb)
+    edge = pcb_outline(pcb)
+    if not edge:
+        return leds
+    px0, py0, px1, py1 = bbox(edge)
+    sx0, sy0, sx1, sy1 = bbox([pt for p in outline for pt in p])
+    kx, ky = (sx1 - sx0) / (px1 - px0), (sy1 - sy0) / (py1 - py0)
+    return [(sx0 + (x - px0) * kx, sy0 + (y - py0) * ky) for x, y in leds]
+
+
+# --- Raster ---
+
+def fill_mask(polys, w, h, scale):
+    # Even-odd scanline fill at pixel centres
+    mask = bytearray(w * h)
+    edges = [(p[i], p[(i + 1) % len(p)]) for p in polys for i in range(len(p))]
+    for row in range(h):
+        y = (row + 0.5) / scale
+        xs = sorted(a[0] + (y - a[1]) * (b[0] - a[0]) / (b[1] - a[1])
+                    for a, b in edges if (a[1] <= y) != (b[1] <= y))
+        for x0, x1 in zip(xs[::2], xs[1::2]):
+            c0 = max(0, int(math.ceil(x0 * scale - 0.5)))
+            c1 = min(w - 1, int(math.floor(x1 * scale - 0.5)))
+            mask[row * w + c0:row * w + c1 + 1] = b"\1" * max(0, c1 - c0 + 1)
+    return mask
+
+
+def stroke(base, polys, w, h, scale, value):
+    for p in polys:
+        for (x0, y0), (x1, y1) in zip(p, p[1:] + p[:1]):
+            n = int(max(abs(x1 - x0), abs(y1 - y0)) * scale * 2) + 1
+            for i in range(n + 1):
+                c = int((x0 + (x1 - x0) * i / n) * scale)
+                r = int((y0 + (y1 - y0) * i / n) * scale)
+                if 0 <= c < w and 0 <= r < h:
+                    base[r * w + c] = value
+
+
+def glow(r):
+    # LED package and the light it throws on the board, 1 in the middle
+    return math.exp(-(r / 0.8) ** 2) * 0.85 + math.exp(-(r / 2.0) ** 2) * 0.15
+
+
+def sprites(leds, w, h, scale):
+    out = []
+    rad = int(GLOW_RADIUS * scale)
+    for x, y in leds:
+        cx, cy = int(x * scale), int(y * scale)
+        sp = []
+        for r in range(max(0, cy - rad), min(h, cy + rad + 1)):
+            for c in range(max(0, cx - rad), min(w, cx + rad + 1)):
+                d = math.hypot((c + 0.5) / scale - x, (r + 0.5) / scale - y)
+                if d <= GLOW_RADIUS:
+                    sp.append((r * w + c, glow(d)))
+        out.append(sp)
+    return out
+
+
+def hex_rgb(s):
+    return tuple(int(s[i:i + 2], 16) / 255 for i in (0, 2, 4))
+
+
+def to_linear(v):
+    return v / 12.92 if v <= 0.04045 else ((v + 0.055) / 1.055) ** 2.4
+
+
+def to_srgb(v):
+    v = min(1.0, v)
+    return int(round(255 * (v * 12.92 if v <= 0.0031308 else 1.055 * v ** (1 / 2.4) - 0.055)))
+
+
+def palette(led):
+    # GLOW_LEVELS of LED light over each background, light steps gamma spaced
+    led = [to_linear(v) for v in hex_rgb(led)]
+    pal = []
+    for bg in (PAGE, BOARD, OUTLINE):
+        bg = [to_linear(v) for v in hex_rgb(bg)]
+        for q in range(GLOW_LEVELS):
+            light = (q / (GLOW_LEVELS - 1)) ** 2.2
+            pal += [to_srgb(b + light * l) for b, l in zip(bg, led)]
+    return bytes(pal + [0] * (768 - len(pal)))
+
+
+# --- Output ---
+
+def lzw(pixels, min_size=8):
+    clear, eoi = 1 << min_size, (1 << min_size) + 1
+    out = bytearray()
+    acc = bits = 0
+    size = min_size + 1
+    table = {}
+    next_code = eoi + 1
+
+    def emit(code):
+        nonlocal acc, bits
+        acc |= code << bits
+        bits += size
+        while bits >= 8:
+            out.append(acc & 0xFF)
+            acc >>= 8
+            bits -= 8
+
+    emit(clear)
+    prefix = pixels[0]
+    for px in pixels[1:]:
+        key = (prefix << 8) | px
+        code = table.get(key)
+        if code is not None:
+            prefix = code
+            continue
+        emit(prefix)
+        if next_code < 4095:
+            table[key] = next_code
+            if next_code == 1 << size:
+                size += 1
+            next_code += 1
+        else:
+            emit(clear)
+            table = {}
+            next_code = eoi + 1
+            size = min_size + 1
+        prefix = px
+    emit(prefix)
+    emit(eoi)
+    if bits:
+        out.append(acc & 0xFF)
+    blocks = bytearray([min_size])
+    for i in range(0, len(out), 255):
+        chunk = out[i:i + 255]
+        blocks += bytes([len(chunk)]) + chunk
+    return bytes(blocks + b"\0")
+
+
+def write_gif(path, frames, w, h, pal, fps):
+    delay = max(2, int(round(100 / fps)))
+    with open(path, "wb") as f:
+        f.write(b"GIF89a" + struct.pack("<HHBBB", w, h, 0xF7, 0, 0) + pal)
+        f.write(b"\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00")   # loop forever
+        for px in frames:
+            f.write(b"\x21\xF9\x04" + struct.pack("<BHBB", 0x04, delay, 0, 0))
+            f.write(b"\x2C" + struct.pack("<HHHHB", 0, 0, w, h, 0) + lzw(px))
+        f.write(b"\x3B")
+
+
+def png_chunk(kind, data):
+    return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data))
+
+
+def write_png(path, px, w, h, pal):
+    rows = b"".join(b"\0" + bytes(px[r * w:(r + 1) * w]) for r in range(h))
+    with open(path, "wb") as f:
+        f.write(b"\x89PNG\r\n\x1a\n")
+        f.write(png_chunk(b"IHDR", struct.pack(">IIBBBBB", w, h, 8, 3, 0, 0, 0)))
+        f.write(png_chunk(b"PLTE", pal[:3 * 3 * GLOW_LEVELS]))
+        f.write(png_chunk(b"IDAT", zlib.compress(rows, 9)))
+        f.write(png_chunk(b"IEND", b""))
+
+
+# --- Frames ---
+
+def read_frames(lines):
+    frames = []
+    for line in lines:
+        if line.startswith("frame "):
+            v = line.split()
+            frames.append((int(v[1]), [int(d) / DUTY_FULL for d in v[2:]]))
+    return frames
+
+
+def run_sim(sim, anim, seconds, fps):
+    if not os.path.exists(sim):
+        sys.exit("%s missing, build it with make -C sim" % sim)
+    res = subprocess.run([sim, "--render", anim, str(seconds), str(fps)],
+                         stdout=subprocess.PIPE, universal_newlines=True)
+    if res.returncode:
+        sys.exit(res.returncode)
+    return read_frames(res.stdout.splitlines())
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Render an animation over the star outline")
+    ap.add_argument("anim", nargs="?", help="animation name, see sim/star_sim_hw --render")
+    ap.add_argument("--seconds", type=float, default=10)
+    ap.add_argument("--fps", type=int, default=25)
+    ap.add_argument("--frames", help="sim --render output to use instead of running the sim")
+    ap.add_argument("-o", "--out", default="star.gif", help="a .gif, or a directory for PNG frames")
+    ap.add_argument("--scale", type=float, default=4, help="pixels per mm")
+    ap.add_argument("--exposure", type=float, default=8, help="1 / on-time that shows white")
+    ap.add_argument("--color", default="ffb040", help="LED colour")
+    ap.add_argument("--sim", default=SIM)
+    ap.add_argument("--pcb", default=PCB)
+    ap.add_argument("--shape", default=SHAPE)
+    args = ap.parse_args()
+
+    if args.frames:
+        with open(args.frames) as f:
+            frames = read_frames(f)
+        fps = 1000 / (frames[1][0] - frames[0][0]) if len(frames) > 1 else args.fps
+    elif args.anim:
+        frames = run_sim(args.sim, args.anim, args.seconds, args.fps)
+        fps = args.fps
+    else:
+        ap.error("an animation or --frames")
+    if not frames:
+        sys.exit("no frames")
+
+    outline, strokes, (mw, mh) = read_shape(args.shape)
+    leds = led_positions(args.pcb, outline)
+    if len(leds) != len(frames[0][1]):
+        sys.exit("%d LEDs on the PCB, %d in the frames" % (len(leds), len(frames[0][1])))
+
+    w, h = int(mw * args.scale), int(mh * args.scale)
+    base = bytearray(v * GLOW_LEVELS for v in fill_mask(outline, w, h, args.scale))
+    stroke(base, outline, w, h, args.scale, 2 * GLOW_LEVELS)
+    for s in strokes:
+        stroke(base, s, w, h, args.scale, 2 * GLOW_LEVELS)
+    glows = sprites(leds, w, h, args.scale)
+    pal = palette(args.color)
+    level = [int(round((GLOW_LEVELS - 1) * (i / 1023) ** (1 / 2.2))) for i in range(1024)]
+
+    images = []
+    for _, duty in frames:
+        light = {}
+        for d, sp in zip(duty, glows):
+            if d <= 0:
+                continue
+            d *= args.exposure
+            for p, g in sp:
+                light[p] = light.get(p, 0) + d * g
+        px = bytearray(base)
+        for p, l in light.items():
+            px[p] = base[p] + level[min(1023, int(l * 1023))]
+        images.append(px)
+
+    if args.out.lower().endswith(".gif"):
+        write_gif(args.out, images, w, h, pal, fps)
+    else:
+        os.makedirs(args.out, exist_ok=True)
+        for i, px in enumerate(images):
+            write_png(os.path.join(args.out, "frame_%04d.png" % i), px, w, h, pal)
+    print("%s: %d frames, %dx%d, %.1f fps" % (args.out, len(images), w, h, fps))
+
+
+if __name__ == "__main__":
+    main()
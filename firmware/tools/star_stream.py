@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+# Host side of the USART1 live stream (lib/uart_stream/uart_stream.h).
+#
+#   star_stream.py PORT pattern 0 5 12        light LEDs 0, 5 and 12
+#   star_stream.py PORT levels 255 128 ...    per LED brightness
+#   star_stream.py PORT masks --set 3 --toggle 7 8   change LEDs of the live pattern
+#   star_stream.py PORT brightness 40
+#   star_stream.py PORT anim 1                back to a built-in animation
+#   star_stream.py PORT perf                  read the perf counters (star_debug)
+#   star_stream.py PORT usage --ma 5          LED / pin on-time heatmap (star_usage),
+#                                             since the last --reset, read within 3h
+#   star_stream.py PORT demo --fps 100 --seconds 5
+#
+# PORT is a serial device or the pty printed by `sim/star_sim --pty`.
+# Only needs the standard library (termios), no pyserial.
+
+import argparse
+import os
+import re
+import select
+import struct
+import sys
+import termios
+import time
+
+SYNC = 0xA5
+CMD_PATTERN = 0x01
+CMD_LEVELS = 0x02
+CMD_BRIGHTNESS = 0x03
+CMD_ANIM = 0x04
+CMD_PERF = 0x05
+CMD_USAGE = 0x06
+CMD_MASKS = 0x07
+
+USAGE_RESET = 0xFF
+USAGE_HEADER = 12   # ticks, slots, first, count, num_leds, reserved
+PWM_TICK_S = 2.5e-6
+
+PERF_NAMES = ["isr", "scan", "frame", "update"]
+PERF_HIST_SHIFTS = [4, 16, 14, 8]   # PERF_HIST_SHIFTS in charlie_perf.h
+PERF_STAT = 48                      # perf_stat: 4 words, 8 bins of 32 bit
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TOPOLOGY = os.path.join(HERE, "..", "lib", "led_charlie", "charlie_topology.h")
+
+
+def charlie_pins():
+    try:
+        with open(TOPOLOGY) as f:
+            return re.search(r"custom_charlie_pins = (.*?) \*/", f.read()).group(1).split()
+    except (OSError, AttributeError):
+        return ["PC0", "PC1", "PC2", "PC3", "PC5", "PC6", "PC7"]
+
+
+def num_leds():
+    try:
+        with open(TOPOLOGY) as f:
+            return int(re.search(r"#define CHARLIE_NUM_LEDS\s+(\d+)", f.read()).group(1))
+    except (OSError, AttributeError):
+        return 42
+
+
+def open_port(path, baud):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    attr = termios.tcgetattr(fd)
+    attr[0] = 0                                         # iflag
+    attr[1] = 0                                         # oflag
+    attr[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+    attr[3] = 0                                         # lflag, raw
+    speed = getattr(termios, "B%d" % baud)
+    attr[4] = attr[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attr)
+    return fd
+
+
+def packet(cmd, payload=b""):
+    return bytes([SYNC, cmd, len(payload), sum(payload) & 0xFF]) + payload
+
+
+def pattern_payload(leds, n):
+    words = [0] * ((n + 31) // 32)
+    for led in leds:
+        if 0 <= led < n:
+            words[led // 32] |= 1 << (led % 32)
+    return struct.pack("<%dI" % len(words), *words)
+
+
+def read_reply(fd, timeout=1.0):
+    buf = b""
+    end = time.time() + timeout
+    while time.time() < end:
+        r, _, _ = select.select([fd], [], [], max(0, end - time.time()))
+        if not r:
+            break
+        buf += os.read(fd, 512)
+        i = buf.find(bytes([SYNC]))
+        if i >= 0 and len(buf) >= i + 4 and len(buf) >= i + 4 + buf[i + 2]:
+            cmd, n, s = buf[i + 1], buf[i + 2], buf[i + 3]
+            payload = buf[i + 4:i + 4 + n]
+            if sum(payload) & 0xFF != s:
+                raise IOError("reply checksum mismatch")
+            return cmd, payload
+    raise IOError("no reply")
+
+
+def print_perf(payload):
+    if not payload:
+        print("perf counters not compiled in (build the star_debug env)")
+        return
+    n_stats = (len(payload) - 20) // PERF_STAT
+    for i in range(n_stats):
+        count, mn, mx, total = struct.unpack_from("<4I", payload, i * PERF_STAT)
+        hist = struct.unpack_from("<8I", payload, i * PERF_STAT + 16)
+        if count:
+            name = PERF_NAMES[i] if i < len(PERF_NAMES) else str(i)
+            width = 1 << PERF_HIST_SHIFTS[i] if i < len(PERF_HIST_SHIFTS) else 0
+            print("%-8s n=%d min=%d avg=%d max=%d | %d: %s" %
+                  (name, count, mn, total // count, mx, width, " ".join(map(str, hist))))
+    isr, frames, dropped, scans, _ = struct.unpack_from("<5I", payload, n_stats * PERF_STAT)
+    print("isr=%d scans=%d frames=%d dropped=%d" % (isr, scans, frames, dropped))
+
+
+# All pages of the usage counters: ticks, slots, on[] per LED
+def read_usage(fd):
+    on = []
+    ticks = slots = 0
+    while True:
+        os.write(fd, packet(CMD_USAGE, bytes([len(on)])))
+        cmd, payload = read_reply(fd)
+        if cmd != CMD_USAGE or len(payload) < USAGE_HEADER:
+            return None
+        ticks, slots, first, count, n = struct.unpack_from("<2I3B", payload)
+        on += struct.unpack_from("<%dI" % count, payload, USAGE_HEADER)
+        if count == 0 or len(on) >= n:
+            return ticks, slots, on
+
+
+def bar(value, full, width=30):
+    return "#" * (int(round(width * value / full)) if full else 0)
+
+
+# Duty of every LED and of every pin as source (anode) and sink (cathode),
+# bars scaled to the hottest. Pins from the topology header, same matrix
+# as the generator.
+def print_usage(usage, ma):
+    sys.path.insert(0, HERE)
+    from gen_charlie_topology import build_matrix
+
+    if usage is None:
+        print("usage counters not compiled in (build the star_usage env)")
+        return
+    ticks, slots, on = usage
+    if not ticks:
+        print("no slots accounted yet")
+        return
+
+    pins = charlie_pins()
+    leds = build_matrix(len(pins))[:len(on)]
+    duty = [t / ticks for t in on]
+    source = [0.0] * len(pins)
+    sink = [0.0] * len(pins)
+    for (anode, cathode), d in zip(leds, duty):
+        source[anode] += d
+        sink[cathode] += d
+
+    print("%.2fs shown, %d slots, %.3f LEDs lit on average" % (ticks * PWM_TICK_S, slots, sum(duty)))
+    top = max(duty)
+    for i, d in enumerate(duty):
+        print("D%d,%d\t%s>%s %6.2f%% %s" % (i * 2 + 1, i * 2 + 2, pins[leds[i][0]], pins[leds[i][1]],
+                                            d * 100, bar(d, top)))
+    top = max(source + sink)
+    for i, name in enumerate(pins):
+        print("%s\tsource %6.2f%% %-30s sink %6.2f%% %s" % (name, source[i] * 100, bar(source[i], top),
+                                                           sink[i] * 100, bar(sink[i], top)))
+    unused = [i for i, t in enumerate(on) if not t]
+    print("never lit: %s" % (" ".join("D%d,%d" % (i * 2 + 1, i * 2 + 2) for i in unused) or "none"))
+    if ma:
+        # one LED at a time, the average current is the lit fraction times the LED current
+        print("average LED current %.3f mA at %.1f mA per lit LED" % (sum(duty) * ma, ma))
+
+
+# Chase around the star at a fixed frame rate, reports the rate achieved
+def demo(fd, n, fps, seconds):
+    period = 1.0 / fps
+    start = time.time()
+    sent = 0
+    nxt = start
+    while time.time() - start < seconds:
+        leds = [(sent + k * (n // 3)) % n for k in range(3)]
+        os.write(fd, packet(CMD_PATTERN, pattern_payload(leds, n)))
+        sent += 1
+        nxt += period
+        delay = nxt - time.time()
+        if delay > 0:
+            time.sleep(delay)
+    elapsed = time.time() - start
+    print("sent %d frames in %.2fs (%.1f fps)" % (sent, elapsed, sent / elapsed))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Drive the star over USART1")
+    ap.add_argument("port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--leds", type=int, default=num_leds())
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("pattern")
+    p.add_argument("led", type=int, nargs="*")
+    p = sub.add_parser("masks")
+    p.add_argument("--set", type=int, nargs="*", default=[])
+    p.add_argument("--clear", type=int, nargs="*", default=[])
+    p.add_argument("--toggle", type=int, nargs="*", default=[])
+    p = sub.add_parser("levels")
+    p.add_argument("level", type=int, nargs="+")
+    p = sub.add_parser("brightness")
+    p.add_argument("value", type=int)
+    p = sub.add_parser("anim")
+    p.add_argument("id", type=int)
+    sub.add_parser("perf")
+    p = sub.add_parser("usage")
+    p.add_argument("--reset", action="store_true", help="clear the counters")
+    p.add_argument("--ma", type=float, default=0, help="LED current when lit, for the average current")
+    p = sub.add_parser("demo")
+    p.add_argument("--fps", type=float, default=100)
+    p.add_argument("--seconds", type=float, default=5)
+    args = ap.parse_args()
+
+    fd = open_port(args.port, args.baud)
+    n = args.leds
+
+    if args.cmd == "pattern":
+        os.write(fd, packet(CMD_PATTERN, pattern_payload(args.led, n)))
+    elif args.cmd == "masks":
+        payload = b"".join(pattern_payload(leds, n) for leds in (args.set, args.clear, args.toggle))
+        os.write(fd, packet(CMD_MASKS, payload))
+    elif args.cmd == "levels":
+        levels = (args.level * n)[:n] if len(args.level) < n else args.level[:n]
+        os.write(fd, packet(CMD_LEVELS, bytes(v & 0xFF for v in levels)))
+    elif args.cmd == "brightness":
+        os.write(fd, packet(CMD_BRIGHTNESS, bytes([args.value & 0xFF])))
+    elif args.cmd == "anim":
+        os.write(fd, packet(CMD_ANIM, bytes([args.id & 0xFF])))
+    elif args.cmd == "perf":
+        os.write(fd, packet(CMD_PERF))
+        cmd, payload = read_reply(fd)
+        print_perf(payload)
+    elif args.cmd == "usage":
+        if args.reset:
+            os.write(fd, packet(CMD_USAGE, bytes([USAGE_RESET])))
+            read_reply(fd)
+        else:
+            print_usage(read_usage(fd), args.ma)
+    elif args.cmd == "demo":
+        demo(fd, n, args.fps, args.seconds)
+    os.close(fd)
+
+
+if __name__ == "__main__":
+    sys.exit(main())